@@ -44,5 +44,6 @@ cp vvcam/v4l2/sensor/ov2775/ov2775.ko modules
 cp vvcam/v4l2/sensor/os08a20/os08a20.ko modules
 #cp vvcam/v4l2/csi/samsung/vvcam-csis.ko modules
 cp vvcam/v4l2/vvcam-isp.ko modules
+cp vvcam/v4l2/vvcam-sensor.ko modules
 cp vvcam/v4l2/video/vvcam-video.ko modules
 cp vvcam/v4l2/sensor/camera-proxy-driver/basler-camera-driver-vvcam.ko modules
@@ -192,6 +192,23 @@ struct viv_caps_supports{
 	struct viv_caps_mode_info_s mode[VIV_CAPS_MODE_MAX_COUNT];
 };
 
+/* metadata capture format, one struct isp_stats_record per buffer */
+#define VIV_META_FMT_ISP_STATS	v4l2_fourcc('V', 'S', 'T', 'A')
+#define VIV_META_ISP_STATS_SIZE	(4*1024)
+
+/*
+ * mmap offset of the read-only struct isp_stats_ring on the stats node,
+ * clear of the offsets vb2 hands out for the node's buffers
+ */
+#define VIV_META_STATS_RING_OFFSET	0x70000000
+
+/* metadata output format, struct isp_params_header and its blocks */
+#define VIV_META_FMT_ISP_PARAMS	v4l2_fourcc('V', 'P', 'R', 'M')
+#define VIV_META_ISP_PARAMS_SIZE	(32*1024)
+
+/* planar RGB888, full size R, G and B planes one after the other */
+#define VIV_PIX_FMT_RGB888P	v4l2_fourcc('V', 'R', 'G', 'P')
+
 #define VIV_VIDEO_ISPIRQ_TYPE	(V4L2_EVENT_PRIVATE_START + 0x0)
 #define VIV_VIDEO_MIIRQ_TYPE	(V4L2_EVENT_PRIVATE_START + 0x1)
 #define VIV_VIDEO_EVENT_TYPE	(V4L2_EVENT_PRIVATE_START + 0x2000)
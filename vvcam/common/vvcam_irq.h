@@ -0,0 +1,103 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _VVCAM_IRQ_H_
+#define _VVCAM_IRQ_H_
+
+#include <linux/interrupt.h>
+#include <linux/sched.h>
+#include <linux/cpumask.h>
+#include <linux/version.h>
+#include <uapi/linux/sched/types.h>
+
+/*
+ * The isp and dwe irq threads run at the kernel default of SCHED_FIFO 50
+ * unless the module is loaded with an explicit priority.  The thread is
+ * created by request_threaded_irq() and not reachable from the driver, so
+ * it switches itself on its first run; prio 0 leaves it untouched.
+ */
+static inline void vvcam_irq_thread_prio(int prio)
+{
+	struct sched_attr attr = {
+		.size = sizeof(attr),
+		.sched_policy = SCHED_FIFO,
+	};
+
+	prio = min(prio, MAX_RT_PRIO - 1);
+	if (likely(prio <= 0 || current->rt_priority == prio))
+		return;
+	attr.sched_priority = prio;
+	if (sched_setattr_nocheck(current, &attr))
+		pr_warn_once("failed to set irq thread priority %d\n", prio);
+}
+
+/* pin the hard irq, and with it the irq thread, to one cpu; -1 keeps it */
+static inline void vvcam_irq_set_cpu(unsigned int irq, int cpu)
+{
+	int rc;
+
+	if (cpu < 0)
+		return;
+	if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+		pr_warn("irq %u: cpu %d is not online\n", irq, cpu);
+		return;
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+	rc = irq_set_affinity(irq, cpumask_of(cpu));
+#else
+	rc = irq_set_affinity_hint(irq, cpumask_of(cpu));
+#endif
+	if (rc)
+		pr_warn("irq %u: failed to set affinity to cpu %d\n", irq, cpu);
+}
+
+#endif /* _VVCAM_IRQ_H_ */
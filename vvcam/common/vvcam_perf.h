@@ -0,0 +1,116 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _VVCAM_PERF_H_
+#define _VVCAM_PERF_H_
+
+#include <linux/types.h>
+#include <linux/bitops.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+
+/*
+ * Log2 latency histogram in microseconds: bin 0 counts samples below 1us,
+ * bin n samples in [2^(n-1), 2^n) us, and the last bin everything longer.
+ * Updated from hard irq and irq thread context without a lock; a torn
+ * read in debugfs only skews one sample.
+ */
+#define VVCAM_HIST_BINS	16
+
+struct vvcam_hist {
+	u32 bin[VVCAM_HIST_BINS];
+	u32 count;
+	u32 max_us;
+};
+
+static inline void vvcam_hist_add(struct vvcam_hist *h, u64 ns)
+{
+	u32 us = (u32)min_t(u64, div_u64(ns, 1000), U32_MAX);
+
+	h->bin[min(fls(us), VVCAM_HIST_BINS - 1)]++;
+	h->count++;
+	if (us > h->max_us)
+		h->max_us = us;
+}
+
+/* remember when a deferred job was queued, keeping the oldest request */
+static inline void vvcam_hist_mark(u64 *ts)
+{
+	if (!READ_ONCE(*ts))
+		WRITE_ONCE(*ts, ktime_get_ns());
+}
+
+/* account the time since vvcam_hist_mark() once the job runs */
+static inline void vvcam_hist_since(struct vvcam_hist *h, u64 *ts)
+{
+	u64 start = READ_ONCE(*ts);
+
+	if (start) {
+		vvcam_hist_add(h, ktime_get_ns() - start);
+		WRITE_ONCE(*ts, 0);
+	}
+}
+
+/* one line: name, sample count, max, then "<lower bound us>:<count>" */
+static inline void vvcam_hist_show(struct seq_file *m, const char *name,
+		const struct vvcam_hist *h)
+{
+	int i;
+
+	seq_printf(m, "%s_us count %u max %u", name, h->count, h->max_us);
+	for (i = 0; i < VVCAM_HIST_BINS; ++i)
+		seq_printf(m, " %u:%u", i ? 1u << (i - 1) : 0, h->bin[i]);
+	seq_putc(m, '\n');
+}
+
+#endif /* _VVCAM_PERF_H_ */
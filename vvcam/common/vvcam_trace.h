@@ -0,0 +1,202 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+/*
+ * Capture pipeline tracepoints.  Every module that fires them defines
+ * VVCAM_TRACE_SYSTEM and CREATE_TRACE_POINTS in exactly one file before
+ * including this header, so each module registers its own copy under its
+ * own system (vvcam_isp, vvcam_dwe, vvcam_video): vvbuf.o is linked into
+ * all of them and the event names would clash otherwise.
+ */
+#undef TRACE_SYSTEM
+#ifdef VVCAM_TRACE_SYSTEM
+#define TRACE_SYSTEM VVCAM_TRACE_SYSTEM
+#else
+#define TRACE_SYSTEM vvcam
+#endif
+
+#if !defined(_VVCAM_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _VVCAM_TRACE_H_
+
+#include <linux/tracepoint.h>
+#include <media/media-entity.h>
+
+#define VVCAM_TRACE_NAME_LEN 32
+
+TRACE_EVENT(isp_irq,
+	TP_PROTO(u32 id, u32 isp_mis, u32 mi_mis, u32 seq),
+	TP_ARGS(id, isp_mis, mi_mis, seq),
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(u32, isp_mis)
+		__field(u32, mi_mis)
+		__field(u32, seq)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->isp_mis = isp_mis;
+		__entry->mi_mis = mi_mis;
+		__entry->seq = seq;
+	),
+	TP_printk("isp%u seq=%u isp_mis=0x%08x mi_mis=0x%08x",
+		  __entry->id, __entry->seq, __entry->isp_mis, __entry->mi_mis)
+);
+
+DECLARE_EVENT_CLASS(isp_mi_buf,
+	TP_PROTO(u32 id, int path, u32 seq, dma_addr_t dma),
+	TP_ARGS(id, path, seq, dma),
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(int, path)
+		__field(u32, seq)
+		__field(u64, dma)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->path = path;
+		__entry->seq = seq;
+		__entry->dma = dma;
+	),
+	TP_printk("isp%u path=%d seq=%u dma=0x%llx",
+		  __entry->id, __entry->path, __entry->seq, __entry->dma)
+);
+
+/* a finished buffer handed on at the mi frame end */
+DEFINE_EVENT(isp_mi_buf, isp_frame_done,
+	TP_PROTO(u32 id, int path, u32 seq, dma_addr_t dma),
+	TP_ARGS(id, path, seq, dma)
+);
+
+/* the next buffer written to the mi, seq is the frame it is meant for */
+DEFINE_EVENT(isp_mi_buf, isp_dma_update,
+	TP_PROTO(u32 id, int path, u32 seq, dma_addr_t dma),
+	TP_ARGS(id, path, seq, dma)
+);
+
+TRACE_EVENT(vvbuf_ready,
+	TP_PROTO(struct media_pad *src, struct media_pad *dst, u32 seq),
+	TP_ARGS(src, dst, seq),
+	TP_STRUCT__entry(
+		__array(char, src, VVCAM_TRACE_NAME_LEN)
+		__array(char, dst, VVCAM_TRACE_NAME_LEN)
+		__field(u16, src_pad)
+		__field(u16, dst_pad)
+		__field(u32, seq)
+	),
+	TP_fast_assign(
+		strscpy(__entry->src, src->entity->name, VVCAM_TRACE_NAME_LEN);
+		strscpy(__entry->dst, dst->entity->name, VVCAM_TRACE_NAME_LEN);
+		__entry->src_pad = src->index;
+		__entry->dst_pad = dst->index;
+		__entry->seq = seq;
+	),
+	TP_printk("%s:%u -> %s:%u seq=%u", __entry->src, __entry->src_pad,
+		  __entry->dst, __entry->dst_pad, __entry->seq)
+);
+
+DECLARE_EVENT_CLASS(dwe_job,
+	TP_PROTO(int index, u32 seq),
+	TP_ARGS(index, seq),
+	TP_STRUCT__entry(
+		__field(int, index)
+		__field(u32, seq)
+	),
+	TP_fast_assign(
+		__entry->index = index;
+		__entry->seq = seq;
+	),
+	TP_printk("dwe%d seq=%u", __entry->index, __entry->seq)
+);
+
+/* a source and destination were picked and programming starts */
+DEFINE_EVENT(dwe_job, dwe_job_start,
+	TP_PROTO(int index, u32 seq),
+	TP_ARGS(index, seq)
+);
+
+/* the job is programmed and the bus enabled */
+DEFINE_EVENT(dwe_job, dwe_job_end,
+	TP_PROTO(int index, u32 seq),
+	TP_ARGS(index, seq)
+);
+
+DEFINE_EVENT(dwe_job, dwe_frame_done,
+	TP_PROTO(int index, u32 seq),
+	TP_ARGS(index, seq)
+);
+
+TRACE_EVENT(video_buf_done,
+	TP_PROTO(int id, u32 index, u32 seq, u64 timestamp),
+	TP_ARGS(id, index, seq, timestamp),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, index)
+		__field(u32, seq)
+		__field(u64, timestamp)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->index = index;
+		__entry->seq = seq;
+		__entry->timestamp = timestamp;
+	),
+	TP_printk("video%d index=%u seq=%u sof_ts=%llu", __entry->id,
+		  __entry->index, __entry->seq, __entry->timestamp)
+);
+
+#endif /* _VVCAM_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE vvcam_trace
+#include <trace/define_trace.h>
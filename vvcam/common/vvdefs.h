@@ -86,9 +86,14 @@ typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
 
+/* may be predefined to silence a host build */
+#ifndef pr_info
 #define pr_info(...) printf(__VA_ARGS__)
+#endif
 #define pr_err(...) printf(__VA_ARGS__)
+#ifndef pr_debug
 #define pr_debug(...) printf(__VA_ARGS__)
+#endif
 #define __user
 #define __iomem
 #else /* __KERNEL__ */
@@ -110,6 +115,31 @@ enum STATE_CODE {
 };
 #endif
 
+/*
+ * ISPIOC_RW_REG_BATCH and DWEIOC_RW_REG_BATCH take a struct vv_reg_batch
+ * pointing to an array of struct vv_reg_op. The whole array is checked
+ * before any register is touched, reads return their value in val. With
+ * VV_REG_BATCH_NEXT_FRAME the batch may only hold writes and is applied
+ * at the next frame boundary while streaming, right away otherwise.
+ */
+#define VV_REG_OP_READ		0
+#define VV_REG_OP_WRITE		1
+
+#define VV_REG_BATCH_NEXT_FRAME	(1 << 0)
+#define VV_REG_BATCH_MAX	1024
+
+struct vv_reg_op {
+	u32 offset;
+	u32 val;
+	u32 op;
+};
+
+struct vv_reg_batch {
+	u64 ops;	/* user address of num struct vv_reg_op */
+	u32 num;
+	u32 flags;
+};
+
 #ifndef MIN
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #endif
@@ -129,7 +159,10 @@ enum STATE_CODE {
 #define DWE_DEVICE_NAME "vvcam-dwe"
 
 #define ISP_PAD_SOURCE      (0)
-#define ISP_PADS_NUM        (1)
+#define ISP_PAD_STATS       (1)
+#define ISP_PAD_PARAMS      (2)
+#define ISP_PAD_SOURCE_SP   (3)
+#define ISP_PADS_NUM        (4)
 
 #define DWE_PAD_SOURCE      (0)
 #define DWE_PAD_SINK        (1)
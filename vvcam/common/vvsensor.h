@@ -97,6 +97,8 @@ enum {
 	VVSENSORIOC_G_EXPAND_CURVE,
 	VVSENSORIOC_S_TEST_PATTERN,
 	VVSENSORIOC_G_LENS,
+	VVSENSORIOC_G_AE_SYNC,
+	VVSENSORIOC_S_AE_GROUP,
 	VVSENSORIOC_MAX,
 };
 
@@ -105,6 +107,9 @@ struct vvcam_clk_s {
 	unsigned long sensor_mclk;
 	unsigned long csi_max_pixel_clk;
 };
+/* {VVSENSOR_REG_DELAY, ms} in a register table waits before the next write */
+#define VVSENSOR_REG_DELAY 0xffff
+
 /* W/R registers */
 struct vvcam_sccb_data_s {
 	uint32_t addr;
@@ -270,4 +275,31 @@ typedef struct vvcam_lens_s {
 	char name[16];
 } vvcam_lens_t;
 
+/* exposure and gain in effect on the frame with the given sequence */
+typedef struct vvcam_ae_sync_s {
+	uint32_t sequence;
+	uint32_t long_exp;
+	uint32_t exp;
+	uint32_t vsexp;
+	uint32_t long_gain;
+	uint32_t gain;
+	uint32_t vsgain;
+} vvcam_ae_sync_t;
+
+#define VVCAM_AE_GROUP_EXP	(1 << 0)
+#define VVCAM_AE_GROUP_GAIN	(1 << 1)
+#define VVCAM_AE_GROUP_VSEXP	(1 << 2)
+#define VVCAM_AE_GROUP_VSGAIN	(1 << 3)
+#define VVCAM_AE_GROUP_FPS	(1 << 4)
+
+/* the controls set in mask, written to the sensor as one update */
+typedef struct vvcam_ae_group_s {
+	uint32_t mask;
+	uint32_t exp;
+	uint32_t gain;
+	uint32_t vsexp;
+	uint32_t vsgain;
+	uint32_t fps;
+} vvcam_ae_group_t;
+
 #endif
@@ -0,0 +1,157 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _VVSENSOR_I2C_H_
+#define _VVSENSOR_I2C_H_
+
+#include <linux/i2c.h>
+#include <linux/mutex.h>
+#include "vvsensor.h"
+
+/*
+ * Register tables compiled into i2c messages.  Runs of consecutive
+ * registers become one auto-increment write each, split at the adapter's
+ * maximum message length, so a mode table costs a few hundred transfers
+ * instead of one per register.  Tables known at probe are compiled once
+ * and reused.
+ *
+ * Mode switches write a diff against the mode programmed last when one
+ * was compiled for the pair, see vvsensor_i2c_add_diffs().
+ *
+ * Register values written or read are cached while the sensor keeps
+ * them, so reads of anything but volatile registers stay off the bus,
+ * see vvsensor_i2c_add_cache().
+ *
+ * Every call takes i2c->lock, so the ioctl path under the sensor lock and
+ * the vvsensor_sync worker may use the same sensor.
+ */
+
+#define VVSENSOR_I2C_MAX_LEN	256	/* bytes per message, address included */
+
+struct vvsensor_regs_op {
+	u32 offset;	/* into buf */
+	u16 len;	/* address and data bytes, 0 for a delay */
+	u16 delay_ms;
+};
+
+struct vvsensor_regs {
+	const struct vvcam_sccb_data_s *table;	/* the source, the lookup key */
+	u32 count;
+	bool mode;	/* a mode table, diffed against the others */
+	u8 *buf;
+	struct vvsensor_regs_op *ops;
+	u32 nops;
+	u32 bytes;	/* sent on the bus */
+};
+
+/* only the registers the new mode changes, from one mode to another */
+struct vvsensor_regs_diff {
+	const struct vvcam_sccb_data_s *from;
+	const struct vvcam_sccb_data_s *to;
+	struct vvcam_sccb_data_s *table;	/* owned */
+	struct vvsensor_regs regs;
+};
+
+#define VVSENSOR_REG_SWITCH	BIT(0)	/* written on every mode switch */
+#define VVSENSOR_REG_TRIGGER	BIT(1)	/* reset and the like, never diffed
+					 * nor cached */
+#define VVSENSOR_REG_VOLATILE	BIT(2)	/* changed by the sensor, never cached */
+
+struct vvsensor_reg_range {
+	u16 first;
+	u16 last;
+	u32 flags;
+};
+
+struct vvsensor_i2c {
+	struct mutex lock;	/* the transfers, the tables, mode and cache */
+	struct i2c_client *client;
+	u8 addr_bytes;
+	u8 data_bytes;		/* register width, 1 or 2 */
+	u32 max_len;
+	struct vvsensor_regs *tables;
+	u32 ntables;
+	/* stream control, plls and whatever the driver writes after the
+	 * mode table are VVSENSOR_REG_SWITCH, set before add_diffs */
+	const struct vvsensor_reg_range *ranges;
+	u32 nranges;
+	struct vvcam_sccb_data_s *defaults;	/* reset values, by address */
+	u32 ndefaults;
+	struct vvsensor_regs_diff *diffs;
+	u32 ndiffs;
+	const struct vvcam_sccb_data_s *mode;	/* programmed, NULL if unknown */
+	struct vvcam_sccb_data_s *cache;	/* by address */
+	unsigned long *cache_valid;
+	u32 ncache;
+};
+
+int vvsensor_i2c_init(struct vvsensor_i2c *i2c, struct i2c_client *client,
+		u8 addr_bytes, u8 data_bytes);
+void vvsensor_i2c_exit(struct vvsensor_i2c *i2c);
+int vvsensor_i2c_add_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count);
+int vvsensor_i2c_add_mode(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count);
+void vvsensor_i2c_add_modes(struct vvsensor_i2c *i2c,
+		const struct vvcam_mode_info_s *modes, u32 count);
+int vvsensor_i2c_add_diffs(struct vvsensor_i2c *i2c);
+int vvsensor_i2c_add_cache(struct vvsensor_i2c *i2c);
+int vvsensor_i2c_write(struct vvsensor_i2c *i2c, u32 addr, u32 val);
+int vvsensor_i2c_read(struct vvsensor_i2c *i2c, u32 addr, u32 *val);
+int vvsensor_i2c_write_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count);
+int vvsensor_i2c_write_mode(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *reset, u32 reset_count,
+		const struct vvcam_sccb_data_s *table, u32 count);
+void vvsensor_i2c_invalidate(struct vvsensor_i2c *i2c);
+
+#endif /* _VVSENSOR_I2C_H_ */
@@ -0,0 +1,164 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _VVSENSOR_SYNC_H_
+#define _VVSENSOR_SYNC_H_
+
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include "vvsensor.h"
+
+/*
+ * Exposure and gain writes timed on the start of frame of the isp the
+ * sensor feeds.  While the isp streams, VVSENSORIOC_S_*EXP/GAIN and
+ * VVSENSORIOC_S_AE_GROUP are queued and written from a worker right after
+ * the start of the frame that makes them take effect together,
+ * int_update_delay_frm and gain_update_delay_frm frames later.  Without
+ * frame starts they are written at once, as before.
+ */
+
+#define VVSENSOR_SYNC_HISTORY	8	/* applied values kept per control */
+
+/* VVSENSORIOC_S_LONG_EXP .. VVSENSORIOC_S_FPS */
+enum {
+	VVSENSOR_SYNC_LONG_EXP,
+	VVSENSOR_SYNC_EXP,
+	VVSENSOR_SYNC_VSEXP,
+	VVSENSOR_SYNC_LONG_GAIN,
+	VVSENSOR_SYNC_GAIN,
+	VVSENSOR_SYNC_VSGAIN,
+	VVSENSOR_SYNC_FPS,
+	VVSENSOR_SYNC_NUM,
+};
+
+/* queued writes, room for a batch partly written and the one after it */
+#define VVSENSOR_SYNC_WRITES	(2 * VVSENSOR_SYNC_NUM)
+
+struct vvsensor_sync;
+
+/* writes one VVSENSORIOC_S_*EXP/GAIN/FPS value, always under sync->mutex but
+ * not always under the sensor lock, so it must not take the latter; the
+ * driver state it uses is only touched under vvsensor_sync_lock() */
+typedef int (*vvsensor_sync_apply_t)(struct vvsensor_sync *sync,
+		u32 cmd, u32 value);
+
+struct vvsensor_sync_write {
+	u32 frame;	/* start of frame to write after */
+	u32 cmd;
+	u32 value;
+};
+
+/* optional, writes several controls inside one sensor group hold */
+typedef int (*vvsensor_sync_apply_group_t)(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w, u32 n);
+
+struct vvsensor_sync_history {
+	u32 sequence[VVSENSOR_SYNC_HISTORY];	/* first frame with value */
+	u32 value[VVSENSOR_SYNC_HISTORY];
+	u32 count;
+};
+
+struct vvsensor_sync {
+	struct list_head list;
+	struct work_struct work;
+	struct mutex mutex;	/* orders the register writes */
+	spinlock_t lock;
+	vvsensor_sync_apply_t apply;
+	vvsensor_sync_apply_group_t apply_group;
+	u32 isp_id;
+	u8 delay[VVSENSOR_SYNC_NUM];
+
+	/* under lock */
+	bool started;		/* following the isp */
+	bool synced;		/* a start of frame was seen */
+	bool open;		/* no write of the batch went out yet */
+	u32 sequence;		/* of the frame last started */
+	u32 batch;		/* frame the current target was set in */
+	u32 target;		/* frame the writes of the batch land on */
+	struct vvsensor_sync_write writes[VVSENSOR_SYNC_WRITES];
+	u32 nwrites;
+	struct vvsensor_sync_history history[VVSENSOR_SYNC_NUM];
+	u32 late;		/* writes done after their frame */
+};
+
+void vvsensor_sync_init(struct vvsensor_sync *sync, u32 isp_id,
+		vvsensor_sync_apply_t apply);
+void vvsensor_sync_start(struct vvsensor_sync *sync,
+		const vvcam_ae_info_t *ae_info);
+void vvsensor_sync_stop(struct vvsensor_sync *sync);
+void vvsensor_sync_exit(struct vvsensor_sync *sync);
+int vvsensor_sync_set(struct vvsensor_sync *sync, u32 cmd, u32 value);
+int vvsensor_sync_set_group(struct vvsensor_sync *sync,
+		struct vvsensor_sync_write *w, u32 n);
+int vvsensor_sync_set_ae(struct vvsensor_sync *sync,
+		const struct vvcam_ae_group_s *ae);
+int vvsensor_sync_get(struct vvsensor_sync *sync, void __user *arg);
+
+/* taken inside the sensor lock around the driver state the apply callbacks
+ * share, such as the frame length and integration limits of the mode */
+static inline void vvsensor_sync_lock(struct vvsensor_sync *sync)
+{
+	mutex_lock(&sync->mutex);
+}
+
+static inline void vvsensor_sync_unlock(struct vvsensor_sync *sync)
+{
+	mutex_unlock(&sync->mutex);
+}
+
+/* called by the isp at each start of frame, from its hard irq; vvcam-isp
+ * links against it, so vvcam-sensor has to be loaded first */
+void vvsensor_sync_frame(u32 isp_id, u32 sequence);
+
+#endif /* _VVSENSOR_SYNC_H_ */
@@ -0,0 +1,114 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+/*
+ * Sensor exposure/gain tracepoints.  Each sensor driver names its own
+ * system through VVSENSOR_TRACE_SYSTEM before including this header with
+ * CREATE_TRACE_POINTS, so several sensor modules can be loaded at once.
+ * Sensors do not see frames; line these events up with the isp ones by
+ * timestamp.
+ */
+#undef TRACE_SYSTEM
+#ifdef VVSENSOR_TRACE_SYSTEM
+#define TRACE_SYSTEM VVSENSOR_TRACE_SYSTEM
+#else
+#define TRACE_SYSTEM vvsensor
+#endif
+
+#if !defined(_VVSENSOR_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _VVSENSOR_TRACE_H_
+
+#include <linux/tracepoint.h>
+#include "vvsensor.h"
+
+#define VVSENSOR_TRACE_NAME_LEN 32
+
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_LONG_EXP);
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_EXP);
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_VSEXP);
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_LONG_GAIN);
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_GAIN);
+TRACE_DEFINE_ENUM(VVSENSORIOC_S_VSGAIN);
+
+TRACE_EVENT(sensor_ae,
+	TP_PROTO(const char *name, unsigned int cmd, u32 value, long ret),
+	TP_ARGS(name, cmd, value, ret),
+	TP_STRUCT__entry(
+		__array(char, name, VVSENSOR_TRACE_NAME_LEN)
+		__field(unsigned int, cmd)
+		__field(u32, value)
+		__field(long, ret)
+	),
+	TP_fast_assign(
+		strscpy(__entry->name, name, VVSENSOR_TRACE_NAME_LEN);
+		__entry->cmd = cmd;
+		__entry->value = value;
+		__entry->ret = ret;
+	),
+	TP_printk("%s %s=%u ret=%ld", __entry->name,
+		  __print_symbolic(__entry->cmd,
+			{ VVSENSORIOC_S_LONG_EXP, "long_exp" },
+			{ VVSENSORIOC_S_EXP, "exp" },
+			{ VVSENSORIOC_S_VSEXP, "vs_exp" },
+			{ VVSENSORIOC_S_LONG_GAIN, "long_gain" },
+			{ VVSENSORIOC_S_GAIN, "gain" },
+			{ VVSENSORIOC_S_VSGAIN, "vs_gain" }),
+		  __entry->value, __entry->ret)
+);
+
+#endif /* _VVSENSOR_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE vvsensor_trace
+#include <trace/define_trace.h>
@@ -54,6 +54,9 @@
 #define _DWE_DEV_H
 
 #include "vvdefs.h"
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+#include "vvcam_perf.h"
+#endif
 
 #ifndef __KERNEL__
 #define copy_from_user(a, b, c) dwe_copy_data(a, b, c)
@@ -93,6 +96,23 @@ enum BUF_ERR_TYPE {
 	BUF_ERR_WRONGSTATE = 1 << 4,
 };
 
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+/* counters since probe, exported through debugfs and never reset */
+struct dwe_perf_stats {
+	u32 frames[MAX_DWE_NUM];	/* dewarped buffers completed */
+	u32 dropped[MAX_DWE_NUM];	/* sources returned, no output queued */
+	u32 underflow;			/* BUF_ERR_UNDERFLOW */
+	u32 overflow;			/* BUF_ERR_OVERFLOW0/1 */
+	u32 hw_error;			/* any error status, incl. the above */
+	u32 no_dist_map;		/* BUF_ERR_NO_DIST_MAP0/1 */
+	u32 wrong_state;		/* BUF_ERR_WRONGSTATE */
+	struct vvcam_hist isr;		/* dwe_hw_isr() run time */
+	struct vvcam_hist thread_lat;	/* irq or kick to irq thread start */
+	struct vvcam_hist thread;	/* dwe_irq_thread() run time */
+	u64 thread_ts;
+};
+#endif
+
 enum HARDWARE_STATUS {
 	HARDWARE_IDLE = 0,
 	HARDWARE_BUSY,
@@ -115,7 +135,11 @@ struct dwe_ic_dev {
 	spinlock_t irqlock;
 	u32 error;
 	int (*get_index)(struct dwe_ic_dev *dev, struct vb2_dc_buf *buf);
-	struct tasklet_struct tasklet;
+	u32 irq_status;		/* acked by the hard irq, under irqlock */
+	int irq_prio;		/* SCHED_FIFO priority of the irq thread */
+	struct vv_reg_op *reg_batch;	/* writes waiting for the next frame */
+	u32 reg_batch_num;
+	struct dwe_perf_stats perf;
 #endif
 
 };
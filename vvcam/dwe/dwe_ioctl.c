@@ -298,6 +298,129 @@ int dwe_ioc_qcap(struct dwe_ic_dev *dev, void *args)
 	return 0;
 }
 
+#ifdef __KERNEL__
+static int dwe_check_reg_batch(const struct vv_reg_op *ops, u32 num, u32 flags)
+{
+	u32 i;
+
+	for (i = 0; i < num; i++) {
+		if (ops[i].offset >= REGISTER_NUM * 4 || (ops[i].offset & 3))
+			return -EINVAL;
+		if (ops[i].op == VV_REG_OP_WRITE)
+			continue;
+		if (ops[i].op != VV_REG_OP_READ ||
+		    (flags & VV_REG_BATCH_NEXT_FRAME))
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static void dwe_run_reg_batch(struct dwe_ic_dev *dev,
+		struct vv_reg_op *ops, u32 num)
+{
+	u32 i;
+
+	for (i = 0; i < num; i++) {
+		if (ops[i].op == VV_REG_OP_WRITE)
+			dwe_write_reg(dev, ops[i].offset, ops[i].val);
+		else
+			ops[i].val = dwe_read_reg(dev, ops[i].offset);
+	}
+}
+
+#ifdef ENABLE_IRQ
+/*
+ * Write the batch queued for the next frame, called without irqlock, which
+ * only covers taking the batch off the device.
+ */
+void dwe_apply_reg_batch(struct dwe_ic_dev *dev)
+{
+	struct vv_reg_op *ops;
+	unsigned long flags;
+	u32 num;
+
+	spin_lock_irqsave(&dev->irqlock, flags);
+	ops = dev->reg_batch;
+	num = dev->reg_batch_num;
+	dev->reg_batch = NULL;
+	spin_unlock_irqrestore(&dev->irqlock, flags);
+	if (!ops)
+		return;
+
+	dwe_run_reg_batch(dev, ops, num);
+	kfree(ops);
+}
+
+static bool dwe_is_streaming(struct dwe_ic_dev *dev)
+{
+	int active = (STATE_DRIVER_STARTED | STATE_STREAM_STARTED);
+	int i;
+
+	for (i = 0; i < MAX_DWE_NUM; i++)
+		if (dev->state[i] && *dev->state[i] == active)
+			return true;
+	return false;
+}
+#endif
+#endif
+
+static long dwe_ioc_rw_reg_batch(struct dwe_ic_dev *dev, void *args)
+{
+	long ret = 0;
+
+#ifdef __KERNEL__
+	struct vv_reg_batch batch;
+	struct vv_reg_op *ops;
+#ifdef ENABLE_IRQ
+	unsigned long flags;
+#endif
+
+	viv_check_retval(copy_from_user(&batch, args, sizeof(batch)));
+	if (!batch.num || batch.num > VV_REG_BATCH_MAX)
+		return -EINVAL;
+
+	ops = memdup_user(u64_to_user_ptr(batch.ops),
+			batch.num * sizeof(*ops));
+	if (IS_ERR(ops))
+		return PTR_ERR(ops);
+
+	ret = dwe_check_reg_batch(ops, batch.num, batch.flags);
+	if (ret)
+		goto out;
+
+	/*
+	 * Runs under the core mutex. A batch for the next frame is only
+	 * handed to the irq thread under irqlock, which it holds while it
+	 * programs a frame.
+	 */
+#ifdef ENABLE_IRQ
+	if ((batch.flags & VV_REG_BATCH_NEXT_FRAME) && dwe_is_streaming(dev)) {
+		spin_lock_irqsave(&dev->irqlock, flags);
+		if (dev->reg_batch) {
+			ret = -EBUSY;
+		} else {
+			dev->reg_batch = ops;
+			dev->reg_batch_num = batch.num;
+			ops = NULL;
+		}
+		spin_unlock_irqrestore(&dev->irqlock, flags);
+		goto out;
+	}
+#endif
+	dwe_run_reg_batch(dev, ops, batch.num);
+
+	if (copy_to_user(u64_to_user_ptr(batch.ops), ops,
+			batch.num * sizeof(*ops)))
+		ret = -EIO;
+out:
+	kfree(ops);
+#else
+	ret = -EINVAL;
+#endif
+
+	return ret;
+}
+
 long dwe_priv_ioctl(struct dwe_ic_dev *dev, unsigned int cmd, void *args)
 {
 	int ret = -1;
@@ -366,6 +489,9 @@ long dwe_priv_ioctl(struct dwe_ic_dev *dev, unsigned int cmd, void *args)
 #endif
 		break;
 	}
+	case DWEIOC_RW_REG_BATCH:
+		ret = dwe_ioc_rw_reg_batch(dev, args);
+		break;
 #ifdef __KERNEL__
 	case VIDIOC_QUERYCAP:
 		ret = dwe_ioc_qcap(dev, args);
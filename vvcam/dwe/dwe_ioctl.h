@@ -67,6 +67,7 @@ enum {
 	DWEIOC_START_DMA_READ,
 	DWEIOC_SET_BUFFER,
 	DWEIOC_SET_LUT,
+	DWEIOC_RW_REG_BATCH,
 };
 
 struct lut_info {
@@ -88,8 +89,9 @@ int dwe_set_buffer(struct dwe_ic_dev *dev, struct dwe_hw_info *info, u64 addr);
 int dwe_set_lut(struct dwe_ic_dev *dev, u64 addr);
 #ifdef __KERNEL__
 irqreturn_t dwe_hw_isr(int irq, void *data);
+irqreturn_t dwe_irq_thread(int irq, void *data);
 void dwe_clear_interrupts(struct dwe_ic_dev *dev);
-void dwe_isr_tasklet(unsigned long arg);
 void dwe_clean_src_memory(struct dwe_ic_dev *dev);
+void dwe_apply_reg_batch(struct dwe_ic_dev *dev);
 #endif
 #endif /* _DWE_IOC_H_ */
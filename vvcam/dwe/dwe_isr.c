@@ -56,16 +56,20 @@
 #endif
 #include "dwe_ioctl.h"
 #include "dwe_regs.h"
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+#include "vvcam_trace.h"
+#include "vvcam_irq.h"
+#endif
 
 #if defined(__KERNEL__) && defined(ENABLE_IRQ)
 
-void dwe_isr_tasklet(unsigned long arg)
+/* pick the next source with an output buffer and start the dewarp */
+static void dwe_start_job(struct dwe_ic_dev *dev)
 {
 	int which;
 	u32 dewarp_ctrl;
 	unsigned long flags;
 	unsigned long irq_flags;
-	struct dwe_ic_dev *dev = (struct dwe_ic_dev *)(arg);
 	struct vb2_dc_buf *sink_buf, *sink_next;
 
 	spin_lock_irqsave(&dev->irqlock, flags);
@@ -80,6 +84,7 @@ void dwe_isr_tasklet(unsigned long arg)
 
 		dev->index = dev->get_index(dev, dev->src);
 		if ( *dev->state[dev->index]  != (STATE_DRIVER_STARTED | STATE_STREAM_STARTED) ) {
+			dev->perf.wrong_state++;
 			vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
 			dev->src = NULL;
 			spin_lock_irqsave(&dev->sink_bctx->irqlock, irq_flags);
@@ -94,27 +99,47 @@ void dwe_isr_tasklet(unsigned long arg)
 		}
 		which = dev->which[dev->index];
 		if (dev->dist_map[dev->index][which] == (dma_addr_t)NULL) {
+			dev->perf.no_dist_map++;
 			vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
 			dev->src = NULL;
 			continue;
 		}
 		dev->dst = vvbuf_pull_buf(dev->src_bctx[dev->index]);
 		if (dev->dst == NULL) {
+			dev->perf.dropped[dev->index]++;
 			vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
 			dev->src = NULL;
 			continue;
 		}
 	} while (dev->dst == NULL);
 
+	trace_dwe_job_start(dev->index, dev->src->vb.sequence);
+
+	/* the dewarped frame keeps the capture time of its source */
+	dev->dst->vb.sequence = dev->src->vb.sequence;
+	dev->dst->vb.vb2_buf.timestamp = dev->src->vb.vb2_buf.timestamp;
+
 	dwe_s_params(dev, &dev->info[dev->index][which]);
 	dwe_set_buffer(dev, &dev->info[dev->index][which], dev->dst->dma);
 	dwe_set_lut(dev, dev->dist_map[dev->index][which]);
 	dwe_start_dma_read(dev, &dev->info[dev->index][which], dev->src->dma);
+	if (dev->reg_batch) {
+		/* the batch goes in after the job's own parameters */
+		spin_unlock_irqrestore(&dev->irqlock, flags);
+		dwe_apply_reg_batch(dev);
+		spin_lock_irqsave(&dev->irqlock, flags);
+		/* stopped meanwhile, dwe_clean_src_memory() took the job */
+		if (!dev->dst) {
+			spin_unlock_irqrestore(&dev->irqlock, flags);
+			return;
+		}
+	}
 	dewarp_ctrl = dwe_read_reg(dev, DEWARP_CTRL);
 	dwe_write_reg(dev, DEWARP_CTRL, dewarp_ctrl | 2);
 	dwe_write_reg(dev, DEWARP_CTRL, dewarp_ctrl);
 	dwe_write_reg(dev, INTERRUPT_STATUS, INT_MSK_STATUS_MASK);
 	dwe_enable_bus(dev, 1);
+	trace_dwe_job_end(dev->index, dev->dst->vb.sequence);
 	spin_unlock_irqrestore(&dev->irqlock, flags);
 }
 
@@ -127,54 +152,108 @@ void dwe_clear_interrupts(struct dwe_ic_dev *dev)
 	dwe_write_reg(dev, INTERRUPT_STATUS, clr);
 }
 
+/* hard irq: ack, count errors and leave the buffer hand-over to the thread */
 irqreturn_t dwe_hw_isr(int irq, void *data)
 {
 	struct dwe_ic_dev *dev = (struct dwe_ic_dev *)data;
-	u32 status;
+	u32 status, err;
 	u32 clr;
-	unsigned long flags;
+	u64 start;
+	bool wake = false;
 	int dwe_status_active = (STATE_DRIVER_STARTED | STATE_STREAM_STARTED);
 
 	if (!dev)
 		return IRQ_HANDLED;
 
+	start = ktime_get_ns();
 	status = dwe_read_reg(dev, INTERRUPT_STATUS);
 	clr = (status & 0xFF) << 24;
 	dwe_write_reg(dev, INTERRUPT_STATUS, clr);
 
+	err = (status & INT_ERR_STATUS_MASK) >> INT_ERR_STATUS_SHIFT;
+	if (err) {
+		dev->perf.hw_error++;
+		if (err & BUF_ERR_UNDERFLOW)
+			dev->perf.underflow++;
+		if (err & (BUF_ERR_OVERFLOW0 | BUF_ERR_OVERFLOW1))
+			dev->perf.overflow++;
+	}
+
 	if ((dev->state[0] && (*dev->state[0] == dwe_status_active)) ||
 	    (dev->state[1] && (*dev->state[1] == dwe_status_active))) {
-		if (status & INT_FRAME_DONE) {
-			spin_lock_irqsave(&dev->irqlock, flags);
-			if (dev->src) {
-				vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
-				dev->src = NULL;
-			}
-			if (dev->dst) {
-				vvbuf_ready(dev->src_bctx[dev->index], dev->dst->pad, dev->dst);
-				dev->dst = NULL;
-			}
-			spin_unlock_irqrestore(&dev->irqlock, flags);
-			tasklet_schedule(&dev->tasklet);
-		} else {
-			spin_lock_irqsave(&dev->irqlock, flags);
-			if (dev->src) {
-				vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
-				dev->src = NULL;
-			}
-			if (dev->dst) {
-				vvbuf_push_buf(dev->src_bctx[dev->index], dev->dst);
-				dev->dst = NULL;
-			}
-			dwe_enable_bus(dev, 0);
-			dev->hardware_status = HARDWARE_IDLE;
-			spin_unlock_irqrestore(&dev->irqlock, flags);
-		}
+		spin_lock(&dev->irqlock);
+		dev->irq_status |= status & 0xFF;
+		vvcam_hist_mark(&dev->perf.thread_ts);
+		spin_unlock(&dev->irqlock);
+		wake = true;
 	}
 	else {
 		dev->hardware_status = HARDWARE_IDLE;
 	}
 
+	vvcam_hist_add(&dev->perf.isr, ktime_get_ns() - start);
+	return wake ? IRQ_WAKE_THREAD : IRQ_HANDLED;
+}
+
+/*
+ * Hands the finished frame on and starts the next one.  Also woken without
+ * a pending status when a source buffer is queued to an idle core.
+ */
+irqreturn_t dwe_irq_thread(int irq, void *data)
+{
+	struct dwe_ic_dev *dev = (struct dwe_ic_dev *)data;
+	unsigned long flags;
+	bool start_job;
+	u32 status;
+	u64 start;
+
+	if (!dev)
+		return IRQ_HANDLED;
+
+	vvcam_irq_thread_prio(dev->irq_prio);
+	start = ktime_get_ns();
+
+	spin_lock_irqsave(&dev->irqlock, flags);
+	vvcam_hist_since(&dev->perf.thread_lat, &dev->perf.thread_ts);
+	status = dev->irq_status;
+	dev->irq_status = 0;
+
+	if (status & INT_FRAME_DONE) {
+		if (dev->dst)
+			trace_dwe_frame_done(dev->index,
+					dev->dst->vb.sequence);
+		if (dev->src) {
+			vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
+			dev->src = NULL;
+		}
+		if (dev->dst) {
+			vvbuf_ready(dev->src_bctx[dev->index], dev->dst->pad, dev->dst);
+			dev->dst = NULL;
+			dev->perf.frames[dev->index]++;
+		}
+		start_job = true;
+	} else if (status) {
+		if (dev->src) {
+			vvbuf_ready(dev->sink_bctx, dev->src->pad, dev->src);
+			dev->src = NULL;
+		}
+		if (dev->dst) {
+			vvbuf_push_buf(dev->src_bctx[dev->index], dev->dst);
+			dev->dst = NULL;
+		}
+		dwe_enable_bus(dev, 0);
+		dev->hardware_status = HARDWARE_IDLE;
+		start_job = false;
+	} else {
+		/* kicked by a queued source, unless a job is still running */
+		start_job = !dev->dst;
+	}
+	spin_unlock_irqrestore(&dev->irqlock, flags);
+
+	if (start_job)
+		dwe_start_job(dev);
+
+	vvcam_hist_add(&dev->perf.thread, ktime_get_ns() - start);
 	return IRQ_HANDLED;
 }
 
@@ -196,6 +275,8 @@ void dwe_clean_src_memory(struct dwe_ic_dev *dev)
 	}
 	dev->dst = NULL;
 	spin_unlock_irqrestore(&dev->irqlock, flags);
+	/* no frame left to carry a queued batch */
+	dwe_apply_reg_batch(dev);
 }
 
 #endif
@@ -55,6 +55,8 @@
 
 #ifndef __KERNEL__
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -71,6 +73,9 @@ void isp_ic_set_hal(HalHandle_t hal);
 
 #include "isp_version.h"
 #include "vvdefs.h"
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+#include "vvcam_perf.h"
+#endif
 
 #define REG_ADDR(x)  ((uint32_t)(uintptr_t)&all_regs->x)
 
@@ -86,6 +91,9 @@ void isp_ic_set_hal(HalHandle_t hal);
 # define MI_PATH_NUM            (2)
 #endif
 
+/* buffers held per mi path: programmed, shadow and preloaded ones */
+#define ISP_MI_DEPTH_MAX        (8)
+
 struct isp_reg_t {
 	u32 offset;
 	u32 val;
@@ -498,6 +506,50 @@ struct isp_vsm_result {
 	u32 x, y;
 };
 
+#ifdef ISP_HIST256
+#define HIST_BIN_TOTAL 256
+#else
+#define HIST_BIN_TOTAL 16
+#endif
+
+#define ISP_STATS_AWB		(1 << 0)
+#define ISP_STATS_EXP		(1 << 1)
+#define ISP_STATS_HIST		(1 << 2)
+#define ISP_STATS_AFM		(1 << 3)
+#define ISP_STATS_VSM		(1 << 4)
+
+#define ISP_STATS_RING_NUM	8
+#define ISP_STATS_HIST_MAX	256
+
+/* measurement results of one frame, captured in the isp irq thread */
+struct isp_stats_record {
+	u32 sequence;
+	u32 valid;		/* ISP_STATS_* blocks captured for this frame */
+	u64 timestamp;		/* ns, CLOCK_MONOTONIC at its start of frame */
+	struct isp_awb_mean awb;
+	u8 exp_mean[28];	/* 25 zones */
+	u32 hist_bins;
+	u32 hist[ISP_STATS_HIST_MAX];
+	struct isp_afm_result afm;
+	struct isp_vsm_result vsm;
+};
+
+/*
+ * Mapped read-only by userspace through the stats node, at the offset
+ * ISPIOC_G_STATS_RING reports (VIV_META_STATS_RING_OFFSET). head counts the
+ * published records, the newest one is record[(head - 1) % num]. The
+ * driver fills record[head % num] for the frame in flight, so a copy of
+ * record h - 1 is only valid if head has advanced by less than num - 1
+ * when the copy is done.
+ */
+struct isp_stats_ring {
+	u32 head;
+	u32 num;
+	u32 record_size;
+	u32 reserved;
+	struct isp_stats_record record[ISP_STATS_RING_NUM];
+};
+
 struct isp_vsm_context {
 	bool enable;
 	struct ic_window window;
@@ -713,14 +765,108 @@ struct isp_irq_data {
 typedef struct isp_wdr_context
 {
 	bool	enabled;
-	bool	changed;	//the wdr ctrl && reb shift does not have shandow 
-						//register,need to change after frame end irq.
+	bool	changed;	//unused, isp_s_module() defers the wdr ctrl and
+						//rgb shift to frame end, they have no shadow.
 	u16 	LumOffset;
 	u16 	RgbOffset;
 	u16 	Ym[33];
 	u8		dY[33];
 } isp_wdr_context_t;
 
+/*
+ * Parameter buffers queued on the isp params (meta output) node. A buffer
+ * holds an isp_params_header followed by isp_params_block entries, each
+ * one carrying the context struct of a module (struct isp_bls_context for
+ * ISP_PARAMS_BLS, ...) and padded to ISP_PARAMS_ALIGN. All blocks of a
+ * buffer are programmed together at the next frame end.
+ *
+ * The type is also the bit of the module in isp_ic_dev.dirty. While the
+ * isp is running, setters only mark their module dirty and the frame end
+ * irq commits all dirty modules in type order.
+ */
+#define ISP_PARAMS_VERSION	1
+#define ISP_PARAMS_ALIGN	8
+
+enum isp_params_type {
+	ISP_PARAMS_BLS = 1,
+	ISP_PARAMS_AWB,
+	ISP_PARAMS_DGAIN,
+	ISP_PARAMS_CC,
+	ISP_PARAMS_XTALK,
+	ISP_PARAMS_GAMMA_OUT,
+	ISP_PARAMS_FLT,
+	ISP_PARAMS_CPROC,
+	ISP_PARAMS_EE,
+	ISP_PARAMS_DPCC,
+	ISP_PARAMS_DPF,
+	ISP_PARAMS_CNR,
+	ISP_PARAMS_2DNR,
+	ISP_PARAMS_WDR3,
+	ISP_PARAMS_WDR,
+	ISP_PARAMS_MAX,
+};
+
+struct isp_params_header {
+	u32 version;		/* ISP_PARAMS_VERSION */
+	u32 size;		/* header and blocks, in bytes */
+};
+
+struct isp_params_block {
+	u32 type;		/* enum isp_params_type */
+	u32 size;		/* this header and the context, unpadded */
+};
+
+/* mi buffer hand-over statistics, reset when the dma queue is cleaned */
+struct isp_dma_stats {
+	u32 frames;	/* mi frame end interrupts while streaming */
+	u32 updates;	/* next buffers programmed */
+	u32 late;	/* programmed after the next frame already started */
+	u32 empty;	/* no queued buffer at frame end */
+};
+
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+/* counters since probe, exported through debugfs and never reset */
+struct isp_perf_stats {
+	u32 frames[MI_PATH_NUM];	/* buffers completed per mi path */
+	u32 dropped[MI_PATH_NUM];	/* no buffer programmed, or before 1st sof */
+	u32 scratch[MI_PATH_NUM];	/* frames written to the scratch buffer */
+	u32 fifo_full;
+	u32 wrap;
+	u32 fill;
+	u32 commit_late;	/* frame end commits put off to the next frame */
+	struct vvcam_hist isr;		/* isp_hw_isr() run time */
+	struct vvcam_hist thread_lat;	/* hard irq to irq thread start */
+	struct vvcam_hist thread;	/* isp_irq_thread() run time */
+	u64 thread_ts;
+};
+
+/* interrupts acked by the hard irq, handled by the irq thread */
+struct isp_irq_frame {
+	u32 isp_mis;
+	u32 mi_mis;
+	u32 sof;	/* sof_count when the frame ended */
+	u64 ts;		/* start of frame time of that frame */
+};
+#endif
+
+#define ISP_REG_SHADOW_NUM	32
+
+/* write-through copy of the registers only the driver changes */
+struct isp_reg_shadow {
+	u8 *slot;		/* register index -> 1 + entry, 0 if not shadowed */
+	unsigned long valid;	/* entries holding the hw value */
+	u32 val[ISP_REG_SHADOW_NUM];
+};
+
+/* register reads that reached the bus, reset when the dma queue is cleaned */
+struct isp_mmio_stats {
+	u32 reads;
+	u32 isr_calls;
+	u32 isr_reads;
+	u32 mi_start_calls;
+	u32 mi_start_reads;
+};
+
 struct isp_ic_dev {
 	void __iomem *base;
 	void __iomem *reset;
@@ -730,14 +876,44 @@ struct isp_ic_dev {
 	struct regmap *mix_gpr;
 #endif 
 #if defined(__KERNEL__) && defined(ENABLE_IRQ)
-	struct vvbuf_ctx *bctx;
+	struct vvbuf_ctx *bctx[MI_PATH_NUM];	/* per path, may be shared */
+	struct vvbuf_ctx *sp_bctx;	/* queue of the self path node */
+	struct isp_mi_data_path_context sp_req;	/* asked for by that node */
+	bool sp_merged;		/* self path filled in from sp_req */
 	struct vb2_dc_buf *mi_buf[MI_PATH_NUM];
 	struct vb2_dc_buf *mi_buf_shd[MI_PATH_NUM];
+	u32 mi_depth;		/* buffers held per path, above 2 preloads */
+	bool irq_dma_update;	/* reprogram from the hard irq at any depth */
+	struct list_head mi_ready[MI_PATH_NUM];	/* preloaded, under lock */
+	u32 mi_ready_num[MI_PATH_NUM];
+	struct list_head mi_done[MI_PATH_NUM];	/* finished in the hard irq */
 	int (*alloc)(struct isp_ic_dev *dev, struct isp_buffer_context *buf);
 	int (*free)(struct isp_ic_dev *dev, struct vb2_dc_buf *buf);
 	int *state;
-	struct tasklet_struct tasklet;
 	spinlock_t lock;
+	int irq_prio;		/* SCHED_FIFO priority of the irq thread */
+	struct isp_irq_frame irq_pending;	/* under lock */
+	struct isp_irq_frame irq_frame;		/* owned by the irq thread */
+	u32 commit_deferred;	/* frame end commits put off in a row */
+	struct isp_dma_stats dma_stats;
+	struct vvbuf_ctx *stats_bctx;
+	struct vvbuf_ctx *params_bctx;
+	struct isp_stats_ring *stats_ring;
+	phys_addr_t stats_ring_phys;
+	u32 sof_count;		/* start of frame irqs since stream on */
+	u64 sof_ts;		/* monotonic ns of the latest start of frame */
+	u32 mi_end_sof;		/* sof_count at the latest mi frame end */
+	struct vv_reg_op *reg_batch;	/* writes waiting for frame end */
+	u32 reg_batch_num;
+	struct isp_perf_stats perf;
+	struct device *scratch_dev;	/* allocates the scratch, NULL for none */
+	struct vb2_dc_buf scratch;	/* flags 0, never freed through ->free */
+	void *scratch_cookie;
+	u32 scratch_size;
+#endif
+#ifdef __KERNEL__
+	struct isp_reg_shadow *shadow;
+	struct isp_mmio_stats mmio;
 #endif
 	void (*post_event)(struct isp_ic_dev *dev, void *data, size_t size);
 
@@ -786,6 +962,7 @@ struct isp_ic_dev {
 	bool streaming;
 	bool update_lsc_tbl;
 	bool update_gamma_en;
+	unsigned long dirty;	/* ISP_PARAMS_* modules to commit at frame end */
 };
 
 struct isp_extmem_info {
@@ -795,5 +972,10 @@ struct isp_extmem_info {
 
 void isp_write_reg(struct isp_ic_dev *dev, u32 offset, u32 val);
 u32 isp_read_reg(struct isp_ic_dev *dev, u32 offset);
+#ifdef __KERNEL__
+int isp_reg_shadow_init(struct isp_ic_dev *dev);
+void isp_reg_shadow_free(struct isp_ic_dev *dev);
+void isp_reg_shadow_invalidate(struct isp_ic_dev *dev);
+#endif
 
 #endif /* _ISP_DEV_H_ */
@@ -58,6 +58,7 @@
 #ifdef __KERNEL__
 #include <linux/regmap.h>
 #include <linux/of_reserved_mem.h>
+#include "viv_video_kevent.h"
 #endif
 
 #ifdef __clang__
@@ -113,21 +114,121 @@ long isp_copy_data(void *dst, void *src, int size)
 	return 0;
 }
 #else
+struct isp_shadow_reg {
+	u32 offset;
+	u32 selfclear;	/* bits the hw clears after a write, never shadowed */
+};
+
+#define ISP_SHADOW_REG(reg, selfclear) \
+	{ offsetof(MrvAllRegister_t, reg), selfclear }
+
+/*
+ * Control registers that only the driver writes. Status, interrupt,
+ * measurement and *_shd registers are left out and always read the hw.
+ */
+static const struct isp_shadow_reg isp_shadow_regs[] = {
+	ISP_SHADOW_REG(vi_iccl, 0),
+	ISP_SHADOW_REG(vi_dpcl, 0),
+	ISP_SHADOW_REG(isp_ctrl, MRV_ISP_ISP_CFG_UPD_MASK |
+			MRV_ISP_ISP_GEN_CFG_UPD_MASK),
+	ISP_SHADOW_REG(isp_acq_prop, 0),
+	ISP_SHADOW_REG(isp_demosaic, 0),
+	ISP_SHADOW_REG(isp_imsc, 0),
+	ISP_SHADOW_REG(isp_awb_prop, 0),
+	ISP_SHADOW_REG(isp_gamma_out_mode, 0),
+	ISP_SHADOW_REG(isp_bls_ctrl, 0),
+	ISP_SHADOW_REG(isp_dpcc_mode, 0),
+	ISP_SHADOW_REG(isp_filt_mode, 0),
+	ISP_SHADOW_REG(cproc_ctrl, 0),
+	ISP_SHADOW_REG(isp_wdr_ctrl, 0),
+	ISP_SHADOW_REG(isp_wdr_offset, 0),
+	ISP_SHADOW_REG(isp_ee_ctrl, 0),
+	ISP_SHADOW_REG(isp_denoise2d_control, 0),
+	ISP_SHADOW_REG(isp_denoise2d_strength, 0),
+	ISP_SHADOW_REG(isp_denoise3d_ctrl, 0),
+	ISP_SHADOW_REG(isp_denoise3d_strength, 0),
+#ifdef ISP_MIV1
+	ISP_SHADOW_REG(mi_imsc, 0),
+#elif defined(ISP_MIV2)
+	ISP_SHADOW_REG(miv2_imsc, 0),
+	ISP_SHADOW_REG(miv2_ctrl, MCM_RAW_RDMA_START_MASK),
+#endif
+};
+
+int isp_reg_shadow_init(struct isp_ic_dev *dev)
+{
+	struct isp_reg_shadow *shadow;
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(isp_shadow_regs) > ISP_REG_SHADOW_NUM);
+	shadow = kzalloc(sizeof(*shadow), GFP_KERNEL);
+	if (!shadow)
+		return -ENOMEM;
+	shadow->slot = kzalloc(ISP_REG_SIZE / 4, GFP_KERNEL);
+	if (!shadow->slot) {
+		kfree(shadow);
+		return -ENOMEM;
+	}
+	for (i = 0; i < ARRAY_SIZE(isp_shadow_regs); i++)
+		shadow->slot[isp_shadow_regs[i].offset / 4] = i + 1;
+	dev->shadow = shadow;
+	return 0;
+}
+
+void isp_reg_shadow_free(struct isp_ic_dev *dev)
+{
+	if (!dev->shadow)
+		return;
+	kfree(dev->shadow->slot);
+	kfree(dev->shadow);
+	dev->shadow = NULL;
+}
+
+/* the registers went back to their reset values, reload on next read */
+void isp_reg_shadow_invalidate(struct isp_ic_dev *dev)
+{
+	if (dev->shadow)
+		dev->shadow->valid = 0;
+}
+
+static inline int isp_reg_shadow_slot(struct isp_ic_dev *dev, u32 offset)
+{
+	if (!dev->shadow || (offset & 3))
+		return -1;
+	return (int)dev->shadow->slot[offset / 4] - 1;
+}
+
 void isp_write_reg(struct isp_ic_dev *dev, u32 offset, u32 val)
 {
+	int i;
+
 	if (offset >= ISP_REG_SIZE)
 		return;
 	__raw_writel(val, dev->base + offset);
+	i = isp_reg_shadow_slot(dev, offset);
+	if (i >= 0) {
+		dev->shadow->val[i] = val & ~isp_shadow_regs[i].selfclear;
+		set_bit(i, &dev->shadow->valid);
+	}
 //	  isp_info("%s	addr 0x%08x val 0x%08x\n", __func__, offset, val);
 }
 
 u32 isp_read_reg(struct isp_ic_dev *dev, u32 offset)
 {
 	u32 val = 0;
+	int i;
 
 	if (offset >= ISP_REG_SIZE)
 		return 0;
+	i = isp_reg_shadow_slot(dev, offset);
+	if (i >= 0 && test_bit(i, &dev->shadow->valid))
+		return dev->shadow->val[i];
 	val = __raw_readl(dev->base + offset);
+	dev->mmio.reads++;
+	if (i >= 0) {
+		dev->shadow->val[i] = val;
+		set_bit(i, &dev->shadow->valid);
+	}
 //	  isp_info("%s	addr 0x%08x val 0x%08x\n", __func__, offset, val);
 	return val;
 }
@@ -141,6 +242,9 @@ int isp_reset(struct isp_ic_dev *dev)
 	mdelay(2);
 #endif
 	isp_write_reg(dev, REG_ADDR(vi_ircl), 0x0);
+#ifdef __KERNEL__
+	isp_reg_shadow_invalidate(dev);
+#endif
 	return 0;
 }
 
@@ -207,6 +311,10 @@ int isp_enable(struct isp_ic_dev *dev)
 	isp_info("enter %s\n", __func__);
 	isp_imsc = isp_read_reg(dev, REG_ADDR(isp_imsc));
 	isp_imsc |= (MRV_ISP_IMSC_ISP_OFF_MASK | MRV_ISP_IMSC_FRAME_MASK);
+#ifdef ENABLE_IRQ
+	/* start of frame timestamps the mi buffers */
+	isp_imsc |= MRV_ISP_IMSC_V_START_MASK;
+#endif
 	isp_write_reg(dev, REG_ADDR(isp_imsc), isp_imsc);
 	isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
 	REG_SET_SLICE(isp_ctrl, MRV_ISP_ISP_INFORM_ENABLE, 1);
@@ -784,6 +892,9 @@ int isp_start_stream(struct isp_ic_dev *dev, u32 numFrames)
 		(MRV_ISP_IMSC_ISP_OFF_MASK | MRV_ISP_IMSC_FRAME_MASK |
 		 MRV_ISP_IMSC_FRAME_IN_MASK);
 	/* isp_imsc |= (MRV_ISP_IMSC_FRAME_MASK | MRV_ISP_IMSC_DATA_LOSS_MASK | MRV_ISP_IMSC_FRAME_IN_MASK); */
+#ifdef ENABLE_IRQ
+	isp_imsc |= MRV_ISP_IMSC_V_START_MASK;
+#endif
 	isp_write_reg(dev, REG_ADDR(isp_icr), 0xFFFFFFFF);
 	isp_write_reg(dev, REG_ADDR(isp_imsc), isp_imsc);
 	isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
@@ -808,6 +919,13 @@ int isp_stop_stream(struct isp_ic_dev *dev)
 	isp_info("enter %s\n", __func__);
 	isp_write_reg(dev, REG_ADDR(isp_imsc), 0);
 	isp_disable(dev);
+#ifdef __KERNEL__
+	/* no frame end irq will pick up modules set during the last frame */
+#ifdef ENABLE_IRQ
+	isp_apply_reg_batch(dev);
+#endif
+	isp_commit_dirty(dev);
+#endif
 	return 0;
 }
 
@@ -887,18 +1005,14 @@ int isp_s_gamma_out(struct isp_ic_dev *dev)
 	u32 isp_gamma_out_mode;
 	int i;
 	struct isp_gamma_out_context *gamma = &dev->gamma_out;
-	if(gamma->changed || !is_isp_enable(dev)) {
-		isp_gamma_out_mode = isp_read_reg(dev, REG_ADDR(isp_gamma_out_mode));
-		REG_SET_SLICE(isp_gamma_out_mode, MRV_ISP_EQU_SEGM, gamma->mode);
-		isp_write_reg(dev, REG_ADDR(isp_gamma_out_mode), isp_gamma_out_mode);
-
-		for (i = 0; i < 17; i++) {
-			isp_write_reg(dev, REG_ADDR(gamma_out_y_block_arr[i]),
-					  MRV_ISP_ISP_GAMMA_OUT_Y_MASK & gamma->curve[i]);
-		}
-		gamma->changed = false;
-	} else {
-		gamma->changed = true;
+
+	isp_gamma_out_mode = isp_read_reg(dev, REG_ADDR(isp_gamma_out_mode));
+	REG_SET_SLICE(isp_gamma_out_mode, MRV_ISP_EQU_SEGM, gamma->mode);
+	isp_write_reg(dev, REG_ADDR(isp_gamma_out_mode), isp_gamma_out_mode);
+
+	for (i = 0; i < 17; i++) {
+		isp_write_reg(dev, REG_ADDR(gamma_out_y_block_arr[i]),
+				  MRV_ISP_ISP_GAMMA_OUT_Y_MASK & gamma->curve[i]);
 	}
 
 	return 0;
@@ -1017,6 +1131,120 @@ int isp_ioc_write_reg(struct isp_ic_dev *dev, void *__user args)
 	return 0;
 }
 
+#ifdef __KERNEL__
+static int isp_check_reg_batch(const struct vv_reg_op *ops, u32 num, u32 flags)
+{
+	u32 i;
+
+	for (i = 0; i < num; i++) {
+		if (ops[i].offset >= ISP_REG_SIZE || (ops[i].offset & 3))
+			return -EINVAL;
+		if (ops[i].op == VV_REG_OP_WRITE)
+			continue;
+		if (ops[i].op != VV_REG_OP_READ ||
+		    (flags & VV_REG_BATCH_NEXT_FRAME))
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static void isp_run_reg_batch(struct isp_ic_dev *dev,
+		struct vv_reg_op *ops, u32 num)
+{
+	u32 i;
+
+	for (i = 0; i < num; i++) {
+		if (ops[i].op == VV_REG_OP_WRITE)
+			isp_write_reg(dev, ops[i].offset, ops[i].val);
+		else
+			ops[i].val = isp_read_reg(dev, ops[i].offset);
+	}
+}
+
+#ifdef ENABLE_IRQ
+/*
+ * Write the batch queued for the next frame, from the irq thread at frame
+ * end or on stop. dev->lock only covers taking the batch off the device.
+ */
+void isp_apply_reg_batch(struct isp_ic_dev *dev)
+{
+	struct vv_reg_op *ops;
+	unsigned long flags;
+	u32 isp_ctrl, num;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	ops = dev->reg_batch;
+	num = dev->reg_batch_num;
+	dev->reg_batch = NULL;
+	spin_unlock_irqrestore(&dev->lock, flags);
+	if (!ops)
+		return;
+
+	isp_run_reg_batch(dev, ops, num);
+	isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
+	REG_SET_SLICE(isp_ctrl, MRV_ISP_ISP_GEN_CFG_UPD, 1);
+	isp_write_reg(dev, REG_ADDR(isp_ctrl), isp_ctrl);
+	kfree(ops);
+}
+#endif
+#endif
+
+static long isp_ioc_rw_reg_batch(struct isp_ic_dev *dev, void *__user args)
+{
+	long ret = 0;
+
+#ifdef __KERNEL__
+	struct vv_reg_batch batch;
+	struct vv_reg_op *ops;
+#ifdef ENABLE_IRQ
+	unsigned long flags;
+#endif
+
+	viv_check_retval(copy_from_user(&batch, args, sizeof(batch)));
+	if (!batch.num || batch.num > VV_REG_BATCH_MAX)
+		return -EINVAL;
+
+	ops = memdup_user(u64_to_user_ptr(batch.ops),
+			batch.num * sizeof(*ops));
+	if (IS_ERR(ops))
+		return PTR_ERR(ops);
+
+	ret = isp_check_reg_batch(ops, batch.num, batch.flags);
+	if (ret)
+		goto out;
+
+	/*
+	 * Runs under the ioctl mutex. A batch for the next frame is only
+	 * handed to the irq thread under dev->lock, so it sees all or nothing.
+	 */
+#ifdef ENABLE_IRQ
+	if ((batch.flags & VV_REG_BATCH_NEXT_FRAME) && is_isp_enable(dev)) {
+		spin_lock_irqsave(&dev->lock, flags);
+		if (dev->reg_batch) {
+			ret = -EBUSY;
+		} else {
+			dev->reg_batch = ops;
+			dev->reg_batch_num = batch.num;
+			ops = NULL;
+		}
+		spin_unlock_irqrestore(&dev->lock, flags);
+		goto out;
+	}
+#endif
+	isp_run_reg_batch(dev, ops, batch.num);
+
+	if (copy_to_user(u64_to_user_ptr(batch.ops), ops,
+			batch.num * sizeof(*ops)))
+		ret = -EIO;
+out:
+	kfree(ops);
+#else
+	ret = -EINVAL;
+#endif
+
+	return ret;
+}
+
 int isp_ioc_disable_isp_off(struct isp_ic_dev *dev, void *args)
 {
 	u32 isp_imsc;
@@ -1130,12 +1358,6 @@ int isp_g_expmean(struct isp_ic_dev *dev, u8 *mean)
 	return 0;
 }
 
-#ifdef ISP_HIST256
-#define HIST_BIN_TOTAL 256
-#else
-#define HIST_BIN_TOTAL 16
-#endif
-
 int isp_s_hist(struct isp_ic_dev *dev)
 {
 	struct isp_hist_context *hist = &dev->hist;
@@ -1431,56 +1653,51 @@ int isp_s_flt(struct isp_ic_dev *dev)
 	};
 
 	struct isp_flt_context *flt = &dev->flt;
-	if(flt->changed || !is_isp_enable(dev))
-	{
-		u32 isp_flt_mode = isp_read_reg(dev, REG_ADDR(isp_filt_mode));
-		if (!flt->enable) {
-			REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_ENABLE, 0);
-			isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
-			dev->flt.changed = false;
-			return 0;
-		}
+	u32 isp_flt_mode = isp_read_reg(dev, REG_ADDR(isp_filt_mode));
 
-		if (flt->denoise >= 0) {
-			isp_write_reg(dev, REG_ADDR(isp_filt_thresh_sh0),
-					  denoise_tbl[flt->denoise].thresh_sh0);
-			isp_write_reg(dev, REG_ADDR(isp_filt_thresh_sh1),
-					  denoise_tbl[flt->denoise].thresh_sh1);
-			isp_write_reg(dev, REG_ADDR(isp_filt_thresh_bl0),
-					  denoise_tbl[flt->denoise].thresh_bl0);
-			isp_write_reg(dev, REG_ADDR(isp_filt_thresh_bl1),
-					  denoise_tbl[flt->denoise].thresh_bl1);
-			REG_SET_SLICE(isp_flt_mode, MRV_FILT_STAGE1_SELECT,
-					  denoise_tbl[flt->denoise].stage_select);
-			REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_CHR_V_MODE,
-					  denoise_tbl[flt->denoise].vmode);
-			REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_CHR_H_MODE,
-					  denoise_tbl[flt->denoise].hmode);
-		}
+	if (!flt->enable) {
+		REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_ENABLE, 0);
+		isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
+		return 0;
+	}
 
-		if (flt->sharpen >= 0) {
-			isp_write_reg(dev, REG_ADDR(isp_filt_fac_sh0),
-					  sharpen_tbl[flt->sharpen].fac_sh0);
-			isp_write_reg(dev, REG_ADDR(isp_filt_fac_sh1),
-					  sharpen_tbl[flt->sharpen].fac_sh1);
-			isp_write_reg(dev, REG_ADDR(isp_filt_fac_mid),
-					  sharpen_tbl[flt->sharpen].fac_mid);
-			isp_write_reg(dev, REG_ADDR(isp_filt_fac_bl0),
-					  sharpen_tbl[flt->sharpen].fac_bl0);
-			isp_write_reg(dev, REG_ADDR(isp_filt_fac_bl1),
-					  sharpen_tbl[flt->sharpen].fac_bl1);
-		}
+	if (flt->denoise >= 0) {
+		isp_write_reg(dev, REG_ADDR(isp_filt_thresh_sh0),
+				  denoise_tbl[flt->denoise].thresh_sh0);
+		isp_write_reg(dev, REG_ADDR(isp_filt_thresh_sh1),
+				  denoise_tbl[flt->denoise].thresh_sh1);
+		isp_write_reg(dev, REG_ADDR(isp_filt_thresh_bl0),
+				  denoise_tbl[flt->denoise].thresh_bl0);
+		isp_write_reg(dev, REG_ADDR(isp_filt_thresh_bl1),
+				  denoise_tbl[flt->denoise].thresh_bl1);
+		REG_SET_SLICE(isp_flt_mode, MRV_FILT_STAGE1_SELECT,
+				  denoise_tbl[flt->denoise].stage_select);
+		REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_CHR_V_MODE,
+				  denoise_tbl[flt->denoise].vmode);
+		REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_CHR_H_MODE,
+				  denoise_tbl[flt->denoise].hmode);
+	}
 
-		REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_MODE,
-				  MRV_FILT_FILT_MODE_DYNAMIC);
-		isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
-		REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_ENABLE, 1);
-		isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
-		isp_write_reg(dev, REG_ADDR(isp_filt_lum_weight), 0x00032040);
-		flt->changed = false;
-	} else {
-		flt->changed = true;
+	if (flt->sharpen >= 0) {
+		isp_write_reg(dev, REG_ADDR(isp_filt_fac_sh0),
+				  sharpen_tbl[flt->sharpen].fac_sh0);
+		isp_write_reg(dev, REG_ADDR(isp_filt_fac_sh1),
+				  sharpen_tbl[flt->sharpen].fac_sh1);
+		isp_write_reg(dev, REG_ADDR(isp_filt_fac_mid),
+				  sharpen_tbl[flt->sharpen].fac_mid);
+		isp_write_reg(dev, REG_ADDR(isp_filt_fac_bl0),
+				  sharpen_tbl[flt->sharpen].fac_bl0);
+		isp_write_reg(dev, REG_ADDR(isp_filt_fac_bl1),
+				  sharpen_tbl[flt->sharpen].fac_bl1);
 	}
+
+	REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_MODE,
+			  MRV_FILT_FILT_MODE_DYNAMIC);
+	isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
+	REG_SET_SLICE(isp_flt_mode, MRV_FILT_FILT_ENABLE, 1);
+	isp_write_reg(dev, REG_ADDR(isp_filt_mode), isp_flt_mode);
+	isp_write_reg(dev, REG_ADDR(isp_filt_lum_weight), 0x00032040);
+
 	return 0;
 }
 
@@ -1950,48 +2167,33 @@ int isp_s_cproc(struct isp_ic_dev *dev)
 	u32 vi_iccl = isp_read_reg(dev, REG_ADDR(vi_iccl));
 	u32 cproc_ctrl = isp_read_reg(dev, REG_ADDR(cproc_ctrl));
 
-	//if there is no shd register. should update cporc register in isp frame end irq.
-#ifndef ISP_CPROC_SHD
-	if(dev->cproc.changed || !is_isp_enable(dev))
-	{
-#endif
-		//isp_info("enter %s %d\n", __func__, cproc->enable);
-		//REG_SET_SLICE(vi_ircl, MRV_VI_CP_SOFT_RST, 1);
-		//isp_write_reg(dev, REG_ADDR(vi_ircl), vi_ircl);
-
-		if (!cproc->enable) {
-			REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_ENABLE, 0);
-			/*		REG_SET_SLICE(vi_iccl, MRV_VI_CP_CLK_ENABLE, 0); */
-			/*		isp_write_reg(dev, REG_ADDR(vi_iccl), vi_iccl); */
-			isp_write_reg(dev, REG_ADDR(cproc_ctrl), cproc_ctrl);
-#ifndef ISP_CPROC_SHD
-			dev->cproc.changed = false;
-#endif
-			return 0;
-		}
+	//isp_info("enter %s %d\n", __func__, cproc->enable);
+	//REG_SET_SLICE(vi_ircl, MRV_VI_CP_SOFT_RST, 1);
+	//isp_write_reg(dev, REG_ADDR(vi_ircl), vi_ircl);
 
-		//REG_SET_SLICE(vi_ircl, MRV_VI_CP_SOFT_RST, 0);
-		//isp_write_reg(dev, REG_ADDR(vi_ircl), vi_ircl);
-		isp_write_reg(dev, REG_ADDR(cproc_contrast), cproc->contrast);
-		isp_write_reg(dev, REG_ADDR(cproc_brightness), cproc->brightness);
-		isp_write_reg(dev, REG_ADDR(cproc_saturation), cproc->saturation);
-		isp_write_reg(dev, REG_ADDR(cproc_hue), cproc->hue);
-		REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_ENABLE, 1);
-		REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_C_OUT_RANGE,
-				  cproc->c_out_full);
-		REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_Y_OUT_RANGE,
-				  cproc->y_out_full);
-		REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_Y_IN_RANGE, cproc->y_in_full);
-		REG_SET_SLICE(vi_iccl, MRV_VI_CP_CLK_ENABLE, 1);
-		isp_write_reg(dev, REG_ADDR(vi_iccl), vi_iccl);
+	if (!cproc->enable) {
+		REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_ENABLE, 0);
+		/*		REG_SET_SLICE(vi_iccl, MRV_VI_CP_CLK_ENABLE, 0); */
+		/*		isp_write_reg(dev, REG_ADDR(vi_iccl), vi_iccl); */
 		isp_write_reg(dev, REG_ADDR(cproc_ctrl), cproc_ctrl);
-
-#ifndef ISP_CPROC_SHD
-		dev->cproc.changed = false;
-	} else {
-		dev->cproc.changed = true;
+		return 0;
 	}
-#endif
+
+	//REG_SET_SLICE(vi_ircl, MRV_VI_CP_SOFT_RST, 0);
+	//isp_write_reg(dev, REG_ADDR(vi_ircl), vi_ircl);
+	isp_write_reg(dev, REG_ADDR(cproc_contrast), cproc->contrast);
+	isp_write_reg(dev, REG_ADDR(cproc_brightness), cproc->brightness);
+	isp_write_reg(dev, REG_ADDR(cproc_saturation), cproc->saturation);
+	isp_write_reg(dev, REG_ADDR(cproc_hue), cproc->hue);
+	REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_ENABLE, 1);
+	REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_C_OUT_RANGE,
+			  cproc->c_out_full);
+	REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_Y_OUT_RANGE,
+			  cproc->y_out_full);
+	REG_SET_SLICE(cproc_ctrl, MRV_CPROC_CPROC_Y_IN_RANGE, cproc->y_in_full);
+	REG_SET_SLICE(vi_iccl, MRV_VI_CP_CLK_ENABLE, 1);
+	isp_write_reg(dev, REG_ADDR(vi_iccl), vi_iccl);
+	isp_write_reg(dev, REG_ADDR(cproc_ctrl), cproc_ctrl);
 
 	return 0;
 }
@@ -2146,26 +2348,40 @@ static long isp_get_extmem(struct isp_ic_dev *dev, void *args)
 	return ret;
 }
 
+static long isp_get_stats_ring(struct isp_ic_dev *dev, void *args)
+{
+	long ret = 0;
+
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+	struct isp_extmem_info ring;
+
+	if (!dev->stats_ring)
+		return -ENOMEM;
+
+	/* an mmap offset on the stats node, not a physical address */
+	ring.addr = VIV_META_STATS_RING_OFFSET;
+	ring.size = PAGE_ALIGN(sizeof(struct isp_stats_ring));
+	viv_check_retval(copy_to_user(args, &ring, sizeof(ring)));
+#else
+	ret = -EINVAL;
+#endif
+
+	return ret;
+}
+
 int isp_s_wdr(struct isp_ic_dev *dev)
 {
 	isp_wdr_context_t* wdr = &dev->wdr;
+	uint32_t isp_wdr_offset, isp_wdr_ctrl;
 
-	/*update wdr configuration	after frame end when isp enable*/
-	if (!is_isp_enable(dev) || wdr->changed) {
-		uint32_t isp_wdr_offset, isp_wdr_ctrl;
+	isp_wdr_offset = isp_read_reg(dev, REG_ADDR(isp_wdr_offset));
+	REG_SET_SLICE( isp_wdr_offset, MRV_WDR_LUM_OFFSET, wdr->LumOffset );
+	REG_SET_SLICE( isp_wdr_offset, MRV_WDR_RGB_OFFSET, wdr->RgbOffset );
+	isp_write_reg(dev, REG_ADDR(isp_wdr_offset), isp_wdr_offset);
 
-		isp_wdr_offset = isp_read_reg(dev, REG_ADDR(isp_wdr_offset));
-		REG_SET_SLICE( isp_wdr_offset, MRV_WDR_LUM_OFFSET, wdr->LumOffset );
-		REG_SET_SLICE( isp_wdr_offset, MRV_WDR_RGB_OFFSET, wdr->RgbOffset );
-		isp_write_reg(dev, REG_ADDR(isp_wdr_offset), isp_wdr_offset);
-
-		isp_wdr_ctrl = isp_read_reg(dev, REG_ADDR(isp_wdr_ctrl));
-		REG_SET_SLICE(isp_wdr_ctrl, MRV_WDR_ENABLE, wdr->enabled);
-		isp_write_reg(dev, REG_ADDR(isp_wdr_ctrl), isp_wdr_ctrl);
-		wdr->changed = false;
-	} else {
-		wdr->changed = true;
-	}
+	isp_wdr_ctrl = isp_read_reg(dev, REG_ADDR(isp_wdr_ctrl));
+	REG_SET_SLICE(isp_wdr_ctrl, MRV_WDR_ENABLE, wdr->enabled);
+	isp_write_reg(dev, REG_ADDR(isp_wdr_ctrl), isp_wdr_ctrl);
 
 	return 0;
 }
@@ -2244,6 +2460,9 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 	case ISPIOC_READ_REG:
 		ret = isp_ioc_read_reg(dev, args);
 		break;
+	case ISPIOC_RW_REG_BATCH:
+		ret = isp_ioc_rw_reg_batch(dev, args);
+		break;
 	case ISPIOC_ENABLE_TPG:
 		ret = isp_enable_tpg(dev);
 		break;
@@ -2291,9 +2510,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_disable_lsc(dev);
 		break;
 	case ISPIOC_S_DIGITAL_GAIN:
-		viv_check_retval(copy_from_user
-				 (&dev->dgain, args, sizeof(dev->dgain)));
-		ret = isp_s_digital_gain(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_DGAIN, args);
 		break;
 #ifdef ISP_DEMOSAIC2
 	case ISPIOC_S_DMSC_INTP:
@@ -2366,14 +2583,10 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_raw_is(dev);
 		break;
 	case ISPIOC_S_CC:
-		viv_check_retval(copy_from_user
-				 (&dev->cc, args, sizeof(dev->cc)));
-		ret = isp_s_cc(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_CC, args);
 		break;
 	case ISPIOC_S_EE:
-		viv_check_retval(copy_from_user
-				 (&dev->ee, args, sizeof(dev->ee)));
-		ret = isp_s_ee(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_EE, args);
 		break;
 	case ISPIOC_S_IE:
 		viv_check_retval(copy_from_user
@@ -2386,9 +2599,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_tpg(dev);
 		break;
 	case ISPIOC_S_BLS:
-		viv_check_retval(copy_from_user
-				 (&dev->bls, args, sizeof(dev->bls)));
-		ret = isp_s_bls(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_BLS, args);
 		break;
 	case ISPIOC_S_MCM:
 		viv_check_retval(copy_from_user
@@ -2401,9 +2612,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_mux(dev);
 		break;
 	case ISPIOC_S_AWB:
-		viv_check_retval(copy_from_user
-				 (&dev->awb, args, sizeof(dev->awb)));
-		ret = isp_s_awb(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_AWB, args);
 		break;
 	case ISPIOC_S_LSC_TBL:
 		viv_check_retval(copy_from_user
@@ -2416,9 +2625,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_lsc_sec(dev);
 		break;
 	case ISPIOC_S_DPF:
-		viv_check_retval(copy_from_user
-				 (&dev->dpf, args, sizeof(dev->dpf)));
-		ret = isp_s_dpf(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_DPF, args);
 		break;
 	case ISPIOC_S_EXP:
 		viv_check_retval(copy_from_user
@@ -2426,15 +2633,11 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_exp(dev);
 		break;
 	case ISPIOC_S_CNR:
-		viv_check_retval(copy_from_user
-				 (&dev->cnr, args, sizeof(dev->cnr)));
-		ret = isp_s_cnr(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_CNR, args);
 		break;
 	case ISPIOC_S_FLT:
 	{
-		viv_check_retval(copy_from_user
-				 (&dev->flt, args, sizeof(dev->flt)));
-		ret = isp_s_flt(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_FLT, args);
 		break;
 	}
 	case ISPIOC_S_CAC:
@@ -2478,9 +2681,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_hist(dev);
 		break;
 	case ISPIOC_S_DPCC:
-		viv_check_retval(copy_from_user
-				 (&dev->dpcc, args, sizeof(dev->dpcc)));
-		ret = isp_s_dpcc(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_DPCC, args);
 		break;
 	case ISPIOC_ENABLE_WDR3:
 		ret = isp_enable_wdr3(dev);
@@ -2494,9 +2695,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_u_wdr3(dev);
 		break;
 	case ISPIOC_S_WDR3:
-		viv_check_retval(copy_from_user
-				 (&dev->wdr3, args, sizeof(dev->wdr3)));
-		ret = isp_s_wdr3(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_WDR3, args);
 		break;
 	case ISPIOC_S_EXP2:
 		viv_check_retval(copy_from_user
@@ -2504,9 +2703,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_exp2(dev);
 		break;
 	case ISPIOC_S_2DNR:
-		viv_check_retval(copy_from_user
-				 (&dev->dnr2, args, sizeof(dev->dnr2)));
-		ret = isp_s_2dnr(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_2DNR, args);
 		break;
 	case ISPIOC_S_3DNR:
 		viv_check_retval(copy_from_user
@@ -2524,14 +2721,10 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_s_comp(dev);
 		break;
 	case ISPIOC_S_CPROC:
-		viv_check_retval(copy_from_user
-				 (&dev->cproc, args, sizeof(dev->cproc)));
-		ret = isp_s_cproc(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_CPROC, args);
 		break;
 	case ISPIOC_S_XTALK:
-		viv_check_retval(copy_from_user
-				 (&dev->xtalk, args, sizeof(dev->xtalk)));
-		ret = isp_s_xtalk(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_XTALK, args);
 		break;
 	case ISPIOC_S_ELAWB:
 		viv_check_retval(copy_from_user
@@ -2548,11 +2741,22 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 				 (&dev->ctx, args, sizeof(dev->ctx)));
 		ret = isp_s_demosaic(dev);
 		break;
-	case ISPIOC_MI_START:
+	case ISPIOC_MI_START:{
+#ifdef __KERNEL__
+		u32 reads = dev->mmio.reads;
+#endif
 		viv_check_retval(copy_from_user
 				 (&dev->mi, args, sizeof(dev->mi)));
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+		isp_mi_merge_sp(dev);
+#endif
 		ret = isp_mi_start(dev);
+#ifdef __KERNEL__
+		dev->mmio.mi_start_calls++;
+		dev->mmio.mi_start_reads += dev->mmio.reads - reads;
+#endif
 		break;
+	}
 	case ISPIOC_S_HDR_WB:
 		viv_check_retval(copy_from_user
 				 (&dev->hdr, args, sizeof(dev->hdr)));
@@ -2569,10 +2773,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		//		 ret = isp_s_hdr_digal_gain(dev);
 		break;
 	case ISPIOC_S_GAMMA_OUT:{
-			viv_check_retval(copy_from_user
-					 (&dev->gamma_out, args,
-					  sizeof(dev->gamma_out)));
-			ret = isp_s_gamma_out(dev);
+			ret = isp_s_module(dev, ISP_PARAMS_GAMMA_OUT, args);
 			break;
 		}
 	case ISPIOC_SET_BUFFER:{
@@ -2668,9 +2869,7 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 		ret = isp_ioc_g_feature_veresion(dev, args);
 		break;
 	case ISPIOC_WDR_CONFIG:
-		viv_check_retval(copy_from_user
-				 (&dev->wdr, args, sizeof(dev->wdr)));
-		ret = isp_s_wdr(dev);
+		ret = isp_s_module(dev, ISP_PARAMS_WDR, args);
 		break;
 	case ISPIOC_S_WDR_CURVE:
 		viv_check_retval(copy_from_user
@@ -2763,6 +2962,9 @@ long isp_priv_ioctl(struct isp_ic_dev *dev, unsigned int cmd, void *args)
 	case ISPIOC_G_QUERY_EXTMEM:
 		ret = isp_get_extmem(dev, args);
 		break;
+	case ISPIOC_G_STATS_RING:
+		ret = isp_get_stats_ring(dev, args);
+		break;
 	default:
 		isp_err("unsupported command %d", cmd);
 		break;
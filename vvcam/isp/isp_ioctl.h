@@ -152,6 +152,8 @@ enum {
 	ISPIOC_S_COLOR_ADJUST		= 0x15E,
 	ISPIOC_S_DIGITAL_GAIN		= 0x15F,
 	ISPIOC_G_QUERY_EXTMEM		= 0x160,
+	ISPIOC_G_STATS_RING 		= 0x161,
+	ISPIOC_RW_REG_BATCH 		= 0x162,
 
 	ISPIOC_WDR_CONFIG			= 0x16C,
 	ISPIOC_S_WDR_CURVE			= 0x16D,
@@ -177,6 +179,7 @@ int isp_s_tpg(struct isp_ic_dev *dev);
 int isp_s_mcm(struct isp_ic_dev *dev);
 int isp_s_mux(struct isp_ic_dev *dev);
 int isp_s_bls(struct isp_ic_dev *dev);
+int isp_s_digital_gain(struct isp_ic_dev *dev);
 int isp_enable_awb(struct isp_ic_dev *dev);
 int isp_disable_awb(struct isp_ic_dev *dev);
 int isp_s_awb(struct isp_ic_dev *dev);
@@ -244,6 +247,8 @@ void isp_reset_mi_irq(struct isp_ic_dev *dev, u32 icr);
 int isp_ioc_start_dma_read(struct isp_ic_dev *dev, void *args);
 int isp_mi_start(struct isp_ic_dev *dev);
 int isp_mi_stop(struct isp_ic_dev *dev);
+int isp_mi_sp_stop(struct isp_ic_dev *dev);
+u32 isp_mi_raw_llength(int id, struct isp_mi_data_path_context *path);
 int isp_set_buffer(struct isp_ic_dev *dev, struct isp_buffer_context *buf);
 int isp_set_bp_buffer(struct isp_ic_dev *dev,
 		      struct isp_bp_buffer_context *buf);
@@ -260,12 +265,23 @@ int isp_s_ge(struct isp_ic_dev *dev);
 int isp_s_color_adjust(struct isp_ic_dev *dev);
 int isp_config_dummy_hblank(struct isp_ic_dev *dev);
 int isp_s_wdr(struct isp_ic_dev *dev);
+int isp_s_module(struct isp_ic_dev *dev, u32 type, void *args);
 
 #ifdef __KERNEL__
+struct vvbuf_ctx;
+
 int clean_dma_buffer(struct isp_ic_dev *dev);
 irqreturn_t isp_hw_isr(int irq, void *data);
+irqreturn_t isp_irq_thread(int irq, void *data);
 void isp_clear_interrupts(struct isp_ic_dev *dev);
 int update_dma_buffer(struct isp_ic_dev *dev);
-void isp_isr_tasklet(unsigned long arg);
+int isp_scratch_prepare(struct isp_ic_dev *dev);
+void isp_scratch_release(struct isp_ic_dev *dev);
+void isp_mi_merge_sp(struct isp_ic_dev *dev);
+void isp_mi_release_sp(struct isp_ic_dev *dev);
+void isp_meta_release(struct isp_ic_dev *dev, struct vvbuf_ctx *ctx);
+int isp_params_apply(struct isp_ic_dev *dev, const void *data, u32 size);
+void isp_commit_dirty(struct isp_ic_dev *dev);
+void isp_apply_reg_batch(struct isp_ic_dev *dev);
 #endif
 #endif /* _ISP_IOC_H_ */
@@ -52,11 +52,17 @@
  *****************************************************************************/
 #ifdef ENABLE_IRQ
 
+#include <linux/delay.h>
+#include <linux/dma-mapping.h>
 #include "isp_ioctl.h"
 #include "isp_types.h"
 #include "mrv_all_bits.h"
 #include "video/vvbuf.h"
 #include "isp_driver.h"
+#include "viv_video_kevent.h"
+#include "vvcam_trace.h"
+#include "vvcam_irq.h"
+#include "vvsensor_sync.h"
 
 extern MrvAllRegister_t *all_regs;
 
@@ -91,12 +97,31 @@ static int config_dma_buf(struct isp_mi_data_path_context *path,
 		} else
 			return -1;
 		break;
+	case IC_MI_DATAMODE_YUV400:
+		/* luma only, the mi writes no chroma planes */
+		buf->size_y = size + ISP_BUF_GAP;
+		buf->addr_cb = buf->addr_cr = 0;
+		buf->size_cb = buf->size_cr = 0;
+		break;
+	case IC_MI_DATAMODE_RGB888:
+		if (path->data_layout == IC_MI_DATASTORAGE_PLANAR) {
+			buf->size_y = size + ISP_BUF_GAP;
+			buf->addr_cb = buf->addr_y + size;
+			buf->size_cb = size + ISP_BUF_GAP;
+			buf->addr_cr = buf->addr_cb + size;
+			buf->size_cr = size + ISP_BUF_GAP;
+		} else {
+			buf->size_y = size * 3 + ISP_BUF_GAP;
+		}
+		break;
 	case IC_MI_DATAMODE_RAW8:
 		buf->size_y = size + ISP_BUF_GAP;
 		break;
 	case IC_MI_DATAMODE_RAW10:
 	case IC_MI_DATAMODE_RAW12:
-		buf->size_y = (size << 1) + ISP_BUF_GAP;
+		/* packed or in 16 bit containers, as the mi of the path writes */
+		buf->size_y = isp_mi_raw_llength(buf->path, path) *
+			path->out_height + ISP_BUF_GAP;
 		break;
 	default:
 		pr_err("unsupported out mode:%d\n", path->out_mode);
@@ -109,66 +134,337 @@ static int config_dma_buf(struct isp_mi_data_path_context *path,
 #endif
 	return 0;
 }
+
+/* bytes the mi writes for one frame of the path, planes and gaps included */
+static u32 dma_buf_span(int id, struct isp_mi_data_path_context *path)
+{
+	struct isp_buffer_context buf = { 0 };
+	u32 span;
+
+	buf.path = id;
+	if (config_dma_buf(path, 0, &buf))
+		return 0;
+#ifdef ISP_MP_34BIT
+	buf.addr_cb <<= 2;
+	buf.addr_cr <<= 2;
 #endif
+	span = buf.size_y;
+	if (buf.size_cb)
+		span = max(span, buf.addr_cb + buf.size_cb);
+	if (buf.size_cr)
+		span = max(span, buf.addr_cr + buf.size_cr);
+	return span;
+}
 
-int update_dma_buffer(struct isp_ic_dev *dev)
+/*
+ * Size the scratch buffer for the enabled paths before the mi starts.  It
+ * is programmed whenever a path has no queued buffer, so the frame lands
+ * in memory nobody reads instead of over a buffer already handed on.  All
+ * paths share it, its content is never looked at.
+ */
+int isp_scratch_prepare(struct isp_ic_dev *dev)
+{
+	struct vb2_dc_buf *scratch = &dev->scratch;
+	unsigned long flags;
+	void *cookie;
+	dma_addr_t dma;
+	u32 size = 0;
+	int i;
+
+	if (!dev->scratch_dev)
+		return 0;
+
+	for (i = 0; i < MI_PATH_NUM; ++i)
+		if (dev->mi.path[i].enable)
+			size = max(size, dma_buf_span(i, &dev->mi.path[i]));
+	if (!size || size <= dev->scratch_size)
+		return 0;
+
+	size = PAGE_ALIGN(size);
+	cookie = dma_alloc_attrs(dev->scratch_dev, size, &dma, GFP_KERNEL,
+			DMA_ATTR_NO_KERNEL_MAPPING);
+	if (!cookie) {
+		pr_warn("isp%d: no %u byte scratch buffer, a dry queue will overwrite delivered frames\n",
+			dev->id, size);
+		return -ENOMEM;
+	}
+
+	/* the mi is stopped, but drop any stale reference to the old one */
+	spin_lock_irqsave(&dev->lock, flags);
+	for (i = 0; i < MI_PATH_NUM; ++i) {
+		if (dev->mi_buf[i] == scratch)
+			dev->mi_buf[i] = NULL;
+		if (dev->mi_buf_shd[i] == scratch)
+			dev->mi_buf_shd[i] = NULL;
+	}
+	swap(cookie, dev->scratch_cookie);
+	swap(size, dev->scratch_size);
+	swap(dma, scratch->dma);
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (cookie)
+		dma_free_attrs(dev->scratch_dev, size, cookie, dma,
+				DMA_ATTR_NO_KERNEL_MAPPING);
+	return 0;
+}
+
+void isp_scratch_release(struct isp_ic_dev *dev)
+{
+	if (dev->scratch_cookie)
+		dma_free_attrs(dev->scratch_dev, dev->scratch_size,
+				dev->scratch_cookie, dev->scratch.dma,
+				DMA_ATTR_NO_KERNEL_MAPPING);
+	dev->scratch_cookie = NULL;
+	dev->scratch_size = 0;
+	dev->scratch.dma = 0;
+}
+#else
+int isp_scratch_prepare(struct isp_ic_dev *dev)
+{
+	return 0;
+}
+
+void isp_scratch_release(struct isp_ic_dev *dev)
+{
+}
+#endif
+
+/*
+ * With a preload depth above 2 every path keeps up to mi_depth - 2 buffers
+ * reserved besides the programmed and the shadow one, so the frame end can
+ * be reprogrammed from the hard irq without touching the queue.
+ */
+static bool mi_preload_enabled(struct isp_ic_dev *dev)
+{
+	return dev->mi_depth > 2;
+}
+
+/*
+ * The hard irq rotates the buffers at frame end when preloading, or with
+ * irq_dma_update at any depth, pulling straight from the queue at depth 2.
+ * The irq thread then only delivers and retries the paths that ran dry.
+ */
+static bool mi_irq_rotate(struct isp_ic_dev *dev)
+{
+	return dev->irq_dma_update || mi_preload_enabled(dev);
+}
+
+/* next buffer for a path, called with dev->lock held */
+static struct vb2_dc_buf *mi_next_buf(struct isp_ic_dev *dev, int path)
+{
+	struct vb2_dc_buf *buf;
+
+	if (!mi_preload_enabled(dev))
+		return vvbuf_pull_buf(dev->bctx[path]);
+
+	buf = list_first_entry_or_null(&dev->mi_ready[path],
+			struct vb2_dc_buf, irqlist);
+	if (buf) {
+		list_del(&buf->irqlist);
+		dev->mi_ready_num[path]--;
+	}
+	return buf;
+}
+
+/* top up the reserve of every enabled path, called with dev->lock held */
+static void mi_preload(struct isp_ic_dev *dev)
 {
+	struct vb2_dc_buf *buf;
+	int i;
+
+	for (i = 0; i < MI_PATH_NUM; ++i) {
+		if (!dev->mi.path[i].enable)
+			continue;
+		while (dev->mi_ready_num[i] < dev->mi_depth - 2) {
+			buf = vvbuf_pull_buf(dev->bctx[i]);
+			if (!buf)
+				break;
+			list_add_tail(&buf->irqlist, &dev->mi_ready[i]);
+			dev->mi_ready_num[i]++;
+		}
+	}
+}
+
+/* hand reserved and finished buffers back, called with dev->lock held */
+static void mi_preload_flush(struct isp_ic_dev *dev, bool free)
+{
+	struct vb2_dc_buf *buf, *next;
+	int i;
+
+	for (i = 0; i < MI_PATH_NUM; ++i) {
+		list_for_each_entry_safe(buf, next, &dev->mi_ready[i], irqlist) {
+			list_del(&buf->irqlist);
+			if (free)
+				dev->free(dev, buf);
+		}
+		list_for_each_entry_safe(buf, next, &dev->mi_done[i], irqlist) {
+			list_del(&buf->irqlist);
+			if (free)
+				dev->free(dev, buf);
+		}
+		dev->mi_ready_num[i] = 0;
+	}
+}
+
+/*
+ * Program the next buffer of every enabled path, called with dev->lock held.
+ * Returns the number of enabled paths left without a queued buffer.
+ */
+static int __update_dma_buffer(struct isp_ic_dev *dev)
+{
+	int missing = 0;
 #ifdef CONFIG_VIDEOBUF2_DMA_CONTIG
 	int i;
-	unsigned long flags;
 	struct isp_mi_context *mi = &dev->mi;
 	struct vb2_dc_buf *buf = NULL;
 	struct isp_buffer_context dmabuf;
+	bool updated = false;
+
+	if (mi_preload_enabled(dev))
+		mi_preload(dev);
 
-	spin_lock_irqsave(&dev->lock, flags);
 	for (i = 0; i < MI_PATH_NUM; ++i) {
 		if (!mi->path[i].enable)
 			continue;
 
-		buf = vvbuf_pull_buf(dev->bctx);
-		if (buf == NULL)
+		/* already programmed for this frame */
+		if (dev->mi_buf_shd[i])
 			continue;
+
+		buf = mi_next_buf(dev, i);
+		if (buf == NULL) {
+			missing++;
+			if (!dev->scratch.dma)
+				continue;
+			buf = &dev->scratch;
+		}
 		dmabuf.path = i;
 		if (config_dma_buf(&mi->path[i], buf->dma, &dmabuf)){
-			vvbuf_push_buf(dev->bctx,buf);
+			if (buf != &dev->scratch)
+				vvbuf_requeue_buf(dev->bctx[i], buf);
 			continue;
 		}
 		isp_set_buffer(dev, &dmabuf);
+		trace_isp_dma_update(dev->id, i, dev->sof_count, buf->dma);
 		dev->mi_buf_shd[i] = dev->mi_buf[i];
 		dev->mi_buf[i] = buf;
+		updated = true;
 	}
-	spin_unlock_irqrestore(&dev->lock, flags);
 
+	if (updated && dev->dma_stats.frames) {
+		dev->dma_stats.updates++;
+		/* a start of frame since the mi frame end, handled or still
+		 * pending, means the next frame began before its buffer
+		 * address was written */
+		if (dev->sof_count != dev->mi_end_sof ||
+		    (isp_read_reg(dev, REG_ADDR(isp_ris)) & MRV_ISP_RIS_V_START_MASK))
+			dev->dma_stats.late++;
+	}
 #endif
-	return 0;
+	return missing;
 }
 
-static void isr_process_frame(struct isp_ic_dev *dev)
+int update_dma_buffer(struct isp_ic_dev *dev)
 {
-	int i;
 	unsigned long flags;
-	struct isp_mi_context *mi = &dev->mi;
 
 	spin_lock_irqsave(&dev->lock, flags);
+	__update_dma_buffer(dev);
+	spin_unlock_irqrestore(&dev->lock, flags);
+	return 0;
+}
+
+/*
+ * Sequence of the frame that ended, counted from the first V_START.  A
+ * frame ending before it (frame->sof == 0) has neither a sequence nor a
+ * start of frame time; its buffer and statistics are dropped.
+ */
+static inline u32 isr_frame_seq(const struct isp_irq_frame *frame)
+{
+	return frame->sof - 1;
+}
+
+/* stamp a finished mi buffer with the start of the frame it holds */
+static void isr_stamp_buf(struct vb2_dc_buf *buf,
+		const struct isp_irq_frame *frame)
+{
+	buf->vb.sequence = isr_frame_seq(frame);
+	buf->vb.vb2_buf.timestamp = frame->ts;
+}
+
+static void isr_deliver_buf(struct isp_ic_dev *dev, int path,
+		struct vb2_dc_buf *buf)
+{
+	trace_isp_frame_done(dev->id, path, buf->vb.sequence, buf->dma);
+	vvbuf_ready(dev->bctx[path], buf->pad, buf);
+}
+
+/*
+ * Take the finished buffer off every enabled path and program the next
+ * ones, called with dev->lock held.  With defer the buffers are parked on
+ * mi_done for the irq thread instead of being handed on right away.
+ */
+static void isr_rotate_bufs(struct isp_ic_dev *dev,
+		const struct isp_irq_frame *frame, bool defer)
+{
+	struct isp_mi_context *mi = &dev->mi;
+	struct vb2_dc_buf *buf;
+	int i;
+
+	dev->dma_stats.frames++;
+	dev->mi_end_sof = frame->sof;
 	for (i = 0; i < MI_PATH_NUM; ++i) {
 		if (!mi->path[i].enable)
 			continue;
 
-		if (dev->mi_buf_shd[i]) {
-			vvbuf_ready(dev->bctx, dev->mi_buf_shd[i]->pad, dev->mi_buf_shd[i]);
-			dev->mi_buf_shd[i] = NULL;
+		buf = dev->mi_buf_shd[i];
+		dev->mi_buf_shd[i] = NULL;
+		if (buf == &dev->scratch) {
+			/* consumer too slow, the frame went to scratch */
+			dev->perf.scratch[i]++;
+		} else if (buf && !frame->sof) {
+			/* started before the stream was seen, back to the queue */
+			vvbuf_requeue_buf(dev->bctx[i], buf);
+			dev->perf.dropped[i]++;
+		} else if (buf) {
+			isr_stamp_buf(buf, frame);
+			if (defer)
+				list_add_tail(&buf->irqlist, &dev->mi_done[i]);
+			else
+				isr_deliver_buf(dev, i, buf);
+			dev->perf.frames[i]++;
+		} else {
+			dev->perf.dropped[i]++;
 		}
 	}
-	spin_unlock_irqrestore(&dev->lock, flags);
-	tasklet_schedule(&dev->tasklet);
-	return;
+
+	if (__update_dma_buffer(dev))
+		dev->dma_stats.empty++;
 }
 
-void isp_isr_tasklet(unsigned long arg)
+/* hand the finished buffers on and program the next ones, irq thread */
+static void isr_process_frame(struct isp_ic_dev *dev)
 {
-	struct isp_ic_dev *dev = (struct isp_ic_dev *)arg;
-	update_dma_buffer(dev);
-	return;
+	struct vb2_dc_buf *buf, *next;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (!mi_irq_rotate(dev)) {
+		isr_rotate_bufs(dev, &dev->irq_frame, false);
+	} else {
+		/* already rotated by the hard irq */
+		for (i = 0; i < MI_PATH_NUM; ++i) {
+			list_for_each_entry_safe(buf, next, &dev->mi_done[i], irqlist) {
+				list_del(&buf->irqlist);
+				isr_deliver_buf(dev, i, buf);
+			}
+		}
+		/* slow path: a path left without a buffer at frame end takes
+		 * one queued since, and the reserve is topped up */
+		__update_dma_buffer(dev);
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
 }
 
 int clean_dma_buffer(struct isp_ic_dev *dev)
@@ -183,28 +479,48 @@ int clean_dma_buffer(struct isp_ic_dev *dev)
 	if (!dev->free)
 		return 0;
 
+	if (dev->dma_stats.frames)
+		pr_debug("isp%d dma: %u frames, %u updates, %u late, %u empty\n",
+			 dev->id, dev->dma_stats.frames, dev->dma_stats.updates,
+			 dev->dma_stats.late, dev->dma_stats.empty);
+	memset(&dev->dma_stats, 0, sizeof(dev->dma_stats));
+
+	if (dev->mmio.isr_calls)
+		pr_debug("isp%d mmio: %u reads in %u irqs, %u reads in %u mi starts%s\n",
+			 dev->id, dev->mmio.isr_reads, dev->mmio.isr_calls,
+			 dev->mmio.mi_start_reads, dev->mmio.mi_start_calls,
+			 dev->shadow ? " (shadowed)" : "");
+	memset(&dev->mmio, 0, sizeof(dev->mmio));
+
 	isp_dev = container_of(dev, struct isp_device, ic_dev);
 	remote_pad = media_entity_remote_pad(&isp_dev->pads[ISP_PAD_SOURCE]);
 	if (remote_pad && is_media_entity_v4l2_video_device(remote_pad->entity)) {
 		/*if isp connect to video, the buf free by video,isp maybe not access by isp,so just empty queue*/
-		dev->mi_buf[i] = NULL;
-		dev->mi_buf_shd[i] = NULL;
+		for (i = 0; i < MI_PATH_NUM; ++i) {
+			dev->mi_buf[i] = NULL;
+			dev->mi_buf_shd[i] = NULL;
+		}
 
-		spin_lock_irqsave(&dev->bctx->irqlock, flags);
-		if (!list_empty(&dev->bctx->dmaqueue))
-			list_del_init(&dev->bctx->dmaqueue);
-		spin_unlock_irqrestore(&dev->bctx->irqlock, flags);
+		spin_lock_irqsave(&dev->lock, flags);
+		mi_preload_flush(dev, false);
+		/* the self path node keeps its queue until it stops */
+		for (i = 0; i < MI_PATH_NUM; ++i)
+			if (dev->bctx[i] != dev->sp_bctx)
+				vvbuf_ctx_flush(dev->bctx[i]);
+		spin_unlock_irqrestore(&dev->lock, flags);
 
 		return 0;
 	} else {
 		/*if isp connect to subdev, isp buf alloc by isp driver,need free memory*/
 		spin_lock_irqsave(&dev->lock, flags);
-		do {
-			buf = vvbuf_pull_buf(dev->bctx);
-			dev->free(dev, buf);
-		} while(buf);
-
+		mi_preload_flush(dev, true);
 		for (i = 0; i < MI_PATH_NUM; ++i) {
+			do {
+				buf = dev->bctx[i] == dev->sp_bctx ? NULL :
+						vvbuf_pull_buf(dev->bctx[i]);
+				dev->free(dev, buf);
+			} while(buf);
+
 			if (dev->mi_buf[i]) {
 				dev->free(dev, dev->mi_buf[i]);
 				dev->mi_buf[i] = NULL;
@@ -221,6 +537,192 @@ int clean_dma_buffer(struct isp_ic_dev *dev)
 	return 0;
 }
 
+/*
+ * The self path node asks for its output through the isp sp pad.  The
+ * daemon programs the mi for the main path only, so fill the self path in
+ * from that request before the mi starts and route it to the node's queue.
+ * A self path the daemon configured itself is left alone.
+ */
+void isp_mi_merge_sp(struct isp_ic_dev *dev)
+{
+	struct isp_mi_data_path_context *mp = &dev->mi.path[IC_MI_PATH_MAIN];
+	struct isp_mi_data_path_context *sp = &dev->mi.path[IC_MI_PATH_SELF];
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	dev->sp_merged = false;
+	dev->bctx[IC_MI_PATH_SELF] = dev->bctx[IC_MI_PATH_MAIN];
+	if (dev->sp_req.enable && mp->enable && !sp->enable) {
+		*sp = dev->sp_req;
+		sp->in_width = mp->in_width;
+		sp->in_height = mp->in_height;
+		sp->hscale = sp->in_width != sp->out_width;
+		sp->vscale = sp->in_height != sp->out_height;
+		dev->bctx[IC_MI_PATH_SELF] = dev->sp_bctx;
+		dev->sp_merged = true;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+/*
+ * Drop the self path request.  If the mi runs it, stop the path and wait
+ * out the frame still being written, so the node can hand its buffers back
+ * while the main path keeps streaming.
+ */
+void isp_mi_release_sp(struct isp_ic_dev *dev)
+{
+	unsigned long flags;
+	bool merged;
+	u32 sof;
+	int i;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	dev->sp_req.enable = false;
+	merged = dev->sp_merged;
+	dev->sp_merged = false;
+	if (merged) {
+		dev->mi.path[IC_MI_PATH_SELF].enable = false;
+		dev->mi_buf[IC_MI_PATH_SELF] = NULL;
+		dev->mi_buf_shd[IC_MI_PATH_SELF] = NULL;
+		INIT_LIST_HEAD(&dev->mi_ready[IC_MI_PATH_SELF]);
+		INIT_LIST_HEAD(&dev->mi_done[IC_MI_PATH_SELF]);
+		dev->mi_ready_num[IC_MI_PATH_SELF] = 0;
+		dev->bctx[IC_MI_PATH_SELF] = dev->bctx[IC_MI_PATH_MAIN];
+	}
+	sof = dev->sof_count;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (!merged || !(*dev->state & STATE_DRIVER_STARTED))
+		return;
+
+	isp_mi_sp_stop(dev);
+	/* the disable latches at the next frame end, let one more pass */
+	for (i = 0; i < 20 && READ_ONCE(dev->sof_count) - sof < 2; ++i)
+		msleep(10);
+}
+
+/*
+ * Hand a meta node its queued buffers back. The irq thread only pulls and
+ * completes meta buffers with dev->lock held, so once the queue has been
+ * emptied under the lock no buffer of the node is left in the isp and the
+ * node can return the rest itself.
+ */
+void isp_meta_release(struct isp_ic_dev *dev, struct vvbuf_ctx *ctx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	vvbuf_ctx_flush(ctx);
+	spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+/*
+ * Hand the finished record to a queued meta capture buffer, if any. The
+ * buffer is pulled and completed under dev->lock, see isp_meta_release().
+ */
+static void isr_fill_stats_buf(struct isp_ic_dev *dev,
+		struct isp_stats_record *rec)
+{
+	struct vb2_dc_buf *buf;
+	unsigned long flags;
+	void *vaddr;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	buf = vvbuf_pull_buf(dev->stats_bctx);
+	if (!buf) {
+		spin_unlock_irqrestore(&dev->lock, flags);
+		return;
+	}
+
+	BUILD_BUG_ON(sizeof(*rec) > VIV_META_ISP_STATS_SIZE);
+	vaddr = vb2_plane_vaddr(&buf->vb.vb2_buf, 0);
+	if (vaddr)
+		memcpy(vaddr, rec, sizeof(*rec));
+	vb2_set_plane_payload(&buf->vb.vb2_buf, 0, vaddr ? sizeof(*rec) : 0);
+	buf->vb.sequence = rec->sequence;
+	buf->vb.vb2_buf.timestamp = rec->timestamp;
+	vvbuf_ready(dev->stats_bctx, buf->pad, buf);
+	spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+/*
+ * Load the oldest queued params buffer for the commit, then hand it back.
+ * Like the stats buffers it is only held with dev->lock taken, loading it
+ * just copies into the module contexts.
+ */
+static void isr_apply_params(struct isp_ic_dev *dev)
+{
+	struct vb2_dc_buf *buf;
+	unsigned long flags;
+	void *vaddr;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	buf = vvbuf_pull_buf(dev->params_bctx);
+	if (!buf) {
+		spin_unlock_irqrestore(&dev->lock, flags);
+		return;
+	}
+
+	vaddr = vb2_plane_vaddr(&buf->vb.vb2_buf, 0);
+	if (vaddr)
+		isp_params_apply(dev, vaddr,
+				vb2_get_plane_payload(&buf->vb.vb2_buf, 0));
+	/* the commit lands on the next frame to start, which is the one after
+	 * the frame just ended unless the commit was put off */
+	buf->vb.sequence = READ_ONCE(dev->sof_count);
+	vvbuf_ready(dev->params_bctx, buf->pad, buf);
+	spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+static void isr_capture_stats(struct isp_ic_dev *dev, u32 isp_mis)
+{
+	struct isp_stats_ring *ring = dev->stats_ring;
+	struct isp_stats_record *rec;
+	u32 head;
+
+	if (!ring)
+		return;
+
+	head = ring->head;
+	rec = &ring->record[head % ISP_STATS_RING_NUM];
+
+	if (isp_mis & MRV_ISP_MIS_AWB_DONE_MASK) {
+		isp_g_awbmean(dev, &rec->awb);
+		rec->valid |= ISP_STATS_AWB;
+	}
+	if (isp_mis & MRV_ISP_MIS_EXP_END_MASK) {
+		isp_g_expmean(dev, rec->exp_mean);
+		rec->valid |= ISP_STATS_EXP;
+	}
+	if (isp_mis & MRV_ISP_MIS_HIST_MEASURE_RDY_MASK) {
+		isp_g_histmean(dev, rec->hist);
+		rec->hist_bins = HIST_BIN_TOTAL;
+		rec->valid |= ISP_STATS_HIST;
+	}
+	if (isp_mis & MRV_ISP_MIS_AFM_FIN_MASK) {
+		isp_g_afm(dev, &rec->afm);
+		rec->valid |= ISP_STATS_AFM;
+	}
+	if (isp_mis & MRV_ISP_MIS_VSM_END_MASK) {
+		isp_g_vsm(dev, &rec->vsm);
+		rec->valid |= ISP_STATS_VSM;
+	}
+
+	if (isp_mis & MRV_ISP_MIS_FRAME_MASK) {
+		if (!dev->irq_frame.sof) {
+			/* no sequence to publish the record under */
+			rec->valid = 0;
+			return;
+		}
+		rec->sequence = isr_frame_seq(&dev->irq_frame);
+		rec->timestamp = dev->irq_frame.ts;
+		isr_fill_stats_buf(dev, rec);
+		/* record contents must be visible before the new head */
+		smp_store_release(&ring->head, head + 1);
+		ring->record[(head + 1) % ISP_STATS_RING_NUM].valid = 0;
+	}
+}
+
 void isp_clear_interrupts(struct isp_ic_dev *dev)
 {
 	u32 isp_mis, mi_mis;
@@ -239,9 +741,13 @@ void isp_clear_interrupts(struct isp_ic_dev *dev)
 #endif
 }
 
+/*
+ * Hard irq: ack, count errors and stamp the start of frame, everything
+ * else is left to isp_irq_thread() so the time spent with interrupts off
+ * stays short.
+ */
 irqreturn_t isp_hw_isr(int irq, void *data)
 {
-	u32 isp_ctrl;
 	struct isp_ic_dev *dev = (struct isp_ic_dev *)data;
 	static const u32 frameendmask = MRV_MI_MP_FRAME_END_MASK |
 #ifdef ISP_MI_BP
@@ -268,11 +774,17 @@ irqreturn_t isp_hw_isr(int irq, void *data)
 			MRV_MI_SP_CB_FIFO_FULL_MASK |
 			MRV_MI_SP_CR_FIFO_FULL_MASK;
 	u32 isp_mis, mi_mis, mi_status;
-	struct isp_irq_data irq_data;
+	struct isp_irq_frame *pending;
+	bool wake;
+	u32 reads, sof;
+	u64 start;
 
 	if (!dev)
 		return IRQ_HANDLED;
 
+	start = ktime_get_ns();
+	reads = dev->mmio.reads;
+
 	isp_mis = isp_read_reg(dev, REG_ADDR(isp_mis));
 	isp_write_reg(dev, REG_ADDR(isp_icr), isp_mis);
 
@@ -286,17 +798,110 @@ irqreturn_t isp_hw_isr(int irq, void *data)
 	mi_mis = 0;
 #endif
 
+	trace_isp_irq(dev->id, isp_mis, mi_mis, dev->sof_count);
+
 	mi_status = isp_read_reg(dev, REG_ADDR(mi_status));
 	if (mi_status & fifofullmask) {
 		isp_write_reg(dev, REG_ADDR(mi_status), mi_status);
+		dev->perf.fifo_full++;
 		pr_debug("MI FIFO full: 0x%x\n", mi_status);
 	}
 
-	if (mi_mis & errormask)
+	if (mi_mis & errormask) {
+		if (mi_mis & errormask & ~MRV_MI_FILL_MP_Y_MASK)
+			dev->perf.wrap++;
+		if (mi_mis & MRV_MI_FILL_MP_Y_MASK)
+			dev->perf.fill++;
 		pr_debug("MI mis error: 0x%x\n", mi_mis);
+	}
+
+	spin_lock(&dev->lock);
+	pending = &dev->irq_pending;
+	/* the ending frame started at the latest start of frame so far */
+	if ((mi_mis & frameendmask) || (isp_mis & MRV_ISP_MIS_FRAME_MASK)) {
+		pending->sof = dev->sof_count;
+		pending->ts = dev->sof_ts;
+	}
+	pending->mi_mis |= mi_mis & frameendmask;
+	/* the next address is latched at this frame end already, so a late
+	 * thread only delays delivery (while the reserve lasts, if any) */
+	if (mi_irq_rotate(dev) && (mi_mis & frameendmask) &&
+	    *dev->state == (STATE_DRIVER_STARTED | STATE_STREAM_STARTED))
+		isr_rotate_bufs(dev, pending, true);
+	/* the start of frame is consumed here, not reported to userspace */
+	pending->isp_mis |= isp_mis & ~MRV_ISP_MIS_V_START_MASK;
+
+	/* last, so a previous frame ending in the same irq keeps its own
+	 * sequence and timestamp */
+	if (isp_mis & MRV_ISP_MIS_V_START_MASK) {
+		dev->sof_ts = start;
+		dev->sof_count++;
+	}
+
+	wake = pending->isp_mis || pending->mi_mis;
+	if (wake)
+		vvcam_hist_mark(&dev->perf.thread_ts);
+	sof = dev->sof_count;
+	spin_unlock(&dev->lock);
+
+	/* sensor exposure and gain writes due on the frame starting */
+	if (isp_mis & MRV_ISP_MIS_V_START_MASK)
+		vvsensor_sync_frame(dev->id, sof - 1);
+
+	dev->mmio.isr_calls++;
+	dev->mmio.isr_reads += dev->mmio.reads - reads;
+	vvcam_hist_add(&dev->perf.isr, ktime_get_ns() - start);
+	return wake ? IRQ_WAKE_THREAD : IRQ_HANDLED;
+}
+
+/*
+ * The frame end commit has to land in the vertical blanking: modules
+ * without shadow registers (wdr, gamma_out, cproc on non ISP_SHD builds)
+ * take a write at once. Once the next frame has started it waits for that
+ * frame's end instead, dirty modules, queued params and the register
+ * batch all stay pending. ISP_COMMIT_DEFER_MAX frames in a row and it goes
+ * in regardless, so a thread that is always late still applies them.
+ */
+#define ISP_COMMIT_DEFER_MAX	4
+
+static bool isr_commit_in_time(struct isp_ic_dev *dev)
+{
+	if (READ_ONCE(dev->sof_count) == dev->irq_frame.sof ||
+	    dev->commit_deferred >= ISP_COMMIT_DEFER_MAX) {
+		dev->commit_deferred = 0;
+		return true;
+	}
+	dev->commit_deferred++;
+	dev->perf.commit_late++;
+	return false;
+}
+
+/* buffer rotation, statistics and the frame end register commit */
+irqreturn_t isp_irq_thread(int irq, void *data)
+{
+	struct isp_ic_dev *dev = (struct isp_ic_dev *)data;
+	struct isp_irq_data irq_data;
+	unsigned long flags;
+	u32 isp_mis, isp_ctrl;
+	u32 reads;
+	u64 start;
+
+	if (!dev)
+		return IRQ_HANDLED;
+
+	vvcam_irq_thread_prio(dev->irq_prio);
+	start = ktime_get_ns();
+	reads = dev->mmio.reads;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	vvcam_hist_since(&dev->perf.thread_lat, &dev->perf.thread_ts);
+	dev->irq_frame = dev->irq_pending;
+	memset(&dev->irq_pending, 0, sizeof(dev->irq_pending));
+	spin_unlock_irqrestore(&dev->lock, flags);
+	isp_mis = dev->irq_frame.isp_mis;
 
 #ifdef CONFIG_VIDEOBUF2_DMA_CONTIG
-	if (mi_mis & frameendmask) {
+	if (dev->irq_frame.mi_mis) {
 		if (*dev->state == (STATE_DRIVER_STARTED | STATE_STREAM_STARTED)) {
 			isr_process_frame(dev);
 		}
@@ -304,24 +909,11 @@ irqreturn_t isp_hw_isr(int irq, void *data)
 #endif
 
 	if (isp_mis) {
-		if (isp_mis & MRV_ISP_MIS_FRAME_MASK) {
+		isr_capture_stats(dev, isp_mis);
+		if ((isp_mis & MRV_ISP_MIS_FRAME_MASK) &&
+		    isr_commit_in_time(dev)) {
+			isr_apply_params(dev);
 			awb_set_gain(dev);
-			if (dev->flt.changed) {
-				isp_s_flt(dev);
-			}
-
-			if (dev->wdr.changed) {
-				isp_s_wdr(dev);
-			}
-
-			if (dev->cproc.changed) {
-				isp_s_cproc(dev);
-			}
-
-			if (dev->gamma_out.changed) {
-				isp_s_gamma_out(dev);
-			}
-
 			if(dev->update_gamma_en) {
 				isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
 				REG_SET_SLICE(isp_ctrl, MRV_ISP_ISP_GAMMA_OUT_ENABLE,
@@ -329,6 +921,8 @@ irqreturn_t isp_hw_isr(int irq, void *data)
 				isp_write_reg(dev, REG_ADDR(isp_ctrl), isp_ctrl);
 				dev->update_gamma_en = false;
 			}
+			isp_apply_reg_batch(dev);
+			isp_commit_dirty(dev);
 		}
 
 		memset(&irq_data, 0, sizeof(irq_data));
@@ -336,6 +930,9 @@ irqreturn_t isp_hw_isr(int irq, void *data)
 		if (dev->post_event)
 			dev->post_event(dev, &irq_data, sizeof(irq_data));
 	}
+
+	dev->mmio.isr_reads += dev->mmio.reads - reads;
+	vvcam_hist_add(&dev->perf.thread, ktime_get_ns() - start);
 	return IRQ_HANDLED;
 }
 
@@ -230,6 +230,61 @@ int set_scaling(int id, struct isp_ic_dev *dev, bool stabilization)
 	return 0;
 }
 
+/* bytes per line the mi writes for a raw path */
+u32 isp_mi_raw_llength(int id, struct isp_mi_data_path_context *path)
+{
+	u32 lval;
+
+	/* the main path has no packed write format, raw10/12 land in 16 bit
+	 * containers whatever the align mode says */
+	if (id != IC_MI_PATH_SELF2)
+		return path->out_mode == IC_MI_DATAMODE_RAW8 ?
+		    path->out_width : path->out_width * 2;
+
+	lval = path->out_width;
+	if (path->data_alignMode == ISP_MI_DATA_ALIGN_16BIT_MODE) {
+		if ((path->out_mode == IC_MI_DATAMODE_RAW10) ||
+		    (path->out_mode == IC_MI_DATAMODE_RAW12) ||
+		    (path->out_mode == IC_MI_DATAMODE_RAW14)) {
+			lval = (path->out_width + 3) / 4;
+		}
+	} else if (path->data_alignMode == ISP_MI_DATA_ALIGN_128BIT_MODE) {
+		if ((path->out_mode == IC_MI_DATAMODE_RAW10)
+		    || (path->out_mode == IC_MI_DATAMODE_RAW12)
+		    || (path->out_mode == IC_MI_DATAMODE_RAW14)) {
+			lval = (path->out_width * 2 + 126) / 128;
+		}
+	} else {
+		if (path->out_mode == IC_MI_DATAMODE_RAW10) {
+			lval = (path->out_width * 10 + 63) / 64;
+		} else if (path->out_mode == IC_MI_DATAMODE_RAW12) {
+			lval = (path->out_width * 12 + 63) / 64;
+		} else if (path->out_mode == IC_MI_DATAMODE_RAW14) {
+			lval = (path->out_width * 14 + 63) / 64;
+		} else if (path->out_mode == IC_MI_DATAMODE_RAW16) {
+			lval = (path->out_width * 16 + 63) / 64;
+		} else {
+			lval = (path->out_width * 8 + 63) / 64;
+		}
+	}
+	return lval << 3;
+}
+
+/* the self path codes yuv like the main path, and rgb above it */
+static u32 sp_output_format(u32 out_mode)
+{
+	switch (out_mode) {
+	case IC_MI_DATAMODE_RGB888:
+		return MRV_MI_SP_OUTPUT_FORMAT_RGB888;
+	case IC_MI_DATAMODE_RGB666:
+		return MRV_MI_SP_OUTPUT_FORMAT_RGB666;
+	case IC_MI_DATAMODE_RGB565:
+		return MRV_MI_SP_OUTPUT_FORMAT_RGB565;
+	default:
+		return IC_MI_DATAMODE_YUV400 - out_mode;
+	}
+}
+
 #ifdef ISP_MI_BP
 int isp_bppath_start(struct isp_ic_dev *dev)
 {
@@ -241,38 +296,11 @@ int isp_bppath_start(struct isp_ic_dev *dev)
 
 	pr_info("enter %s\n", __func__);
 	bp_ctrl = 0;
-	lval = path->out_width;
 
 	if (mi.path[2].enable) {
 		bp_ctrl &= ~MRV_MI_BP_WRITE_RAWBIT_MASK;
 
-		if (path->data_alignMode == ISP_MI_DATA_ALIGN_16BIT_MODE) {
-			if ((path->out_mode == IC_MI_DATAMODE_RAW10) ||
-			    (path->out_mode == IC_MI_DATAMODE_RAW12) ||
-			    (path->out_mode == IC_MI_DATAMODE_RAW14)) {
-				lval = (path->out_width + 3) / 4;
-			}
-		} else if (path->data_alignMode ==
-			   ISP_MI_DATA_ALIGN_128BIT_MODE) {
-			if ((path->out_mode == IC_MI_DATAMODE_RAW10)
-			    || (path->out_mode == IC_MI_DATAMODE_RAW12)
-			    || (path->out_mode == IC_MI_DATAMODE_RAW14)) {
-				lval = (path->out_width * 2 + 126) / 128;
-			}
-		} else {
-			if (path->out_mode == IC_MI_DATAMODE_RAW10) {
-				lval = (path->out_width * 10 + 63) / 64;
-			} else if (path->out_mode == IC_MI_DATAMODE_RAW12) {
-				lval = (path->out_width * 12 + 63) / 64;
-			} else if (path->out_mode == IC_MI_DATAMODE_RAW14) {
-				lval = (path->out_width * 14 + 63) / 64;
-			} else if (path->out_mode == IC_MI_DATAMODE_RAW16) {
-				lval = (path->out_width * 16 + 63) / 64;
-			} else {
-				lval = (path->out_width * 8 + 63) / 64;
-			}
-		}
-		lval <<= 3;
+		lval = isp_mi_raw_llength(IC_MI_PATH_SELF2, path);
 		REG_SET_SLICE(bp_ctrl, BP_WR_RAW_ALIGNED, path->data_alignMode);
 		switch (mi.path[2].out_mode) {
 		case (IC_MI_DATAMODE_RAW8):
@@ -341,6 +369,7 @@ int isp_mi_start(struct isp_ic_dev *dev)
 
 	isp_write_reg(dev, REG_ADDR(mrsz_ctrl), 0);
 	isp_write_reg(dev, REG_ADDR(mrsz_ctrl_shd), 0);
+	isp_write_reg(dev, REG_ADDR(srsz_ctrl), 0);
 
 	for (i = 0; i < 2; i++) {
 		if (mi.path[i].hscale || mi.path[i].vscale) {
@@ -446,9 +475,9 @@ int isp_mi_start(struct isp_ic_dev *dev)
 		/* setup mi for self-path */
 		mi_ctrl &= ~(MRV_MI_SP_WRITE_FORMAT_MASK);
 		REG_SET_SLICE(mi_ctrl, MRV_MI_SP_INPUT_FORMAT,
-			      mi.path[1].in_mode - 1);
+			      IC_MI_DATAMODE_YUV400 - mi.path[1].in_mode);
 		REG_SET_SLICE(mi_ctrl, MRV_MI_SP_OUTPUT_FORMAT,
-			      mi.path[1].out_mode - 1);
+			      sp_output_format(mi.path[1].out_mode));
 
 		switch (mi.path[1].out_mode) {
 		case (IC_MI_DATAMODE_RGB888):
@@ -503,6 +532,10 @@ int isp_mi_start(struct isp_ic_dev *dev)
 		out_stride = mi.path[1].data_layout ==
 		    IC_MI_DATASTORAGE_INTERLEAVED ?
 		    mi.path[1].out_width * 2 : mi.path[1].out_width;
+		/* rgb line length is counted in pixels */
+		if (mi.path[1].out_mode >= IC_MI_DATAMODE_RGB888 &&
+		    mi.path[1].out_mode <= IC_MI_DATAMODE_RGB565)
+			out_stride = mi.path[1].out_width;
 		REG_SET_SLICE(mi_ctrl, MRV_MI_SP_ENABLE, 1);
 		isp_write_reg(dev, REG_ADDR(mi_sp_y_pic_width), out_stride);
 		isp_write_reg(dev, REG_ADDR(mi_sp_y_llength), out_stride);
@@ -536,6 +569,7 @@ int isp_mi_start(struct isp_ic_dev *dev)
 #endif
 
 #if defined(__KERNEL__) && defined(ENABLE_IRQ)
+	isp_scratch_prepare(dev);
 	/*set memory for first frame, need set MRV_MI_MI_CFG_UPD bit to update memory to mi shadow address*/
 	update_dma_buffer(dev);
 #endif
@@ -577,6 +611,23 @@ int isp_mi_stop(struct isp_ic_dev *dev)
 	return 0;
 }
 
+/* stop writing the self path, the main path keeps streaming */
+int isp_mi_sp_stop(struct isp_ic_dev *dev)
+{
+	u32 mi_ctrl, mi_imsc;
+
+	mi_imsc = isp_read_reg(dev, REG_ADDR(mi_imsc));
+	mi_imsc &= ~(MRV_MI_SP_FRAME_END_MASK | MRV_MI_WRAP_SP_Y_MASK |
+		     MRV_MI_WRAP_SP_CB_MASK | MRV_MI_WRAP_SP_CR_MASK);
+	isp_write_reg(dev, REG_ADDR(mi_imsc), mi_imsc);
+
+	/* latched at the next frame end like the base addresses */
+	mi_ctrl = isp_read_reg(dev, REG_ADDR(mi_ctrl));
+	REG_SET_SLICE(mi_ctrl, MRV_MI_SP_ENABLE, 0);
+	isp_write_reg(dev, REG_ADDR(mi_ctrl), mi_ctrl);
+	return 0;
+}
+
 int isp_set_buffer(struct isp_ic_dev *dev, struct isp_buffer_context *buf)
 {
 	u32 addr;
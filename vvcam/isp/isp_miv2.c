@@ -339,7 +339,9 @@ int set_scaling(int id, struct isp_ic_dev *dev, bool stabilization)
 
 int calc_raw_lval(int width, int out_mode, int align_mode)
 {
-	u32 lval;
+	/* raw8 and raw16 take no padding, they only depend on the width */
+	u32 lval = out_mode == IC_MI_DATAMODE_RAW16 ?
+	    (width + 7) / 8 : (width + 15) / 16;
 
 	if (align_mode == ISP_MI_DATA_ALIGN_16BIT_MODE) {
 		if ((out_mode == IC_MI_DATAMODE_RAW10) ||
@@ -370,6 +372,13 @@ int calc_raw_lval(int width, int out_mode, int align_mode)
 	return lval;
 }
 
+/* bytes per line the mi writes for a raw path, whole 128 bit words */
+u32 isp_mi_raw_llength(int id, struct isp_mi_data_path_context *path)
+{
+	return calc_raw_lval(path->out_width, path->out_mode,
+			     path->data_alignMode) << 4;
+}
+
 #define PATHNUM 3  // hw related
 
 // only config write bits,  SP2 read bit at 3dnr.c
@@ -586,10 +595,7 @@ void set_data_path(int id, struct isp_mi_data_path_context *path,
 
 	if ((id == 0 && (miv2_ctrl & MP_RAW_PATH_ENABLE_MASK))
 	    || (id == 2 && (miv2_ctrl & SP2_RAW_PATH_ENABLE_MASK))) {
-		lval =
-		    calc_raw_lval(path->out_width, path->out_mode,
-				  path->data_alignMode);
-		lval <<= 4;
+		lval = isp_mi_raw_llength(id, path);
 		isp_write_reg(dev, path_list[id].raw_llength, lval);
 		isp_write_reg(dev, path_list[id].raw_pic_width, path->out_width);
 		isp_write_reg(dev, path_list[id].raw_pic_height, path->out_height);
@@ -684,6 +690,12 @@ int isp_mi_stop(struct isp_ic_dev *dev)
 	return 0;
 }
 
+int isp_mi_sp_stop(struct isp_ic_dev *dev)
+{
+	/* miv2 buffers are not driven from the irq, nothing to stop */
+	return 0;
+}
+
 u32 isp_read_mi_irq(struct isp_ic_dev *dev)
 {
 	return isp_read_reg(dev, REG_ADDR(miv2_mis));
@@ -0,0 +1,237 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifdef __KERNEL__
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#endif
+#include "mrv_all_bits.h"
+#include "isp_ioctl.h"
+#include "isp_types.h"
+
+extern MrvAllRegister_t *all_regs;
+
+struct isp_params_entry {
+	size_t offset;		/* context inside struct isp_ic_dev */
+	size_t size;
+	int (*set)(struct isp_ic_dev *dev);
+};
+
+#define ISP_PARAMS_ENTRY(type, member, func) \
+	[type] = { offsetof(struct isp_ic_dev, member), \
+		   sizeof(((struct isp_ic_dev *)0)->member), func }
+
+/*
+ * 3dnr is left out, its setter logs and re-inits the hw on every call.
+ * Modules this isp is built without have no entry, so setting one fails
+ * in the ioctl instead of being dropped at the commit.
+ */
+static const struct isp_params_entry isp_params_table[ISP_PARAMS_MAX] = {
+#ifdef ISP_BLS
+	ISP_PARAMS_ENTRY(ISP_PARAMS_BLS, bls, isp_s_bls),
+#endif
+	ISP_PARAMS_ENTRY(ISP_PARAMS_AWB, awb, isp_s_awb),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_DGAIN, dgain, isp_s_digital_gain),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_CC, cc, isp_s_cc),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_XTALK, xtalk, isp_s_xtalk),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_GAMMA_OUT, gamma_out, isp_s_gamma_out),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_FLT, flt, isp_s_flt),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_CPROC, cproc, isp_s_cproc),
+#ifdef ISP_EE
+	ISP_PARAMS_ENTRY(ISP_PARAMS_EE, ee, isp_s_ee),
+#endif
+	ISP_PARAMS_ENTRY(ISP_PARAMS_DPCC, dpcc, isp_s_dpcc),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_DPF, dpf, isp_s_dpf),
+	ISP_PARAMS_ENTRY(ISP_PARAMS_CNR, cnr, isp_s_cnr),
+#ifdef ISP_2DNR
+	ISP_PARAMS_ENTRY(ISP_PARAMS_2DNR, dnr2, isp_s_2dnr),
+#endif
+#ifdef ISP_WDR_V3
+	ISP_PARAMS_ENTRY(ISP_PARAMS_WDR3, wdr3, isp_s_wdr3),
+#endif
+	ISP_PARAMS_ENTRY(ISP_PARAMS_WDR, wdr, isp_s_wdr),
+};
+
+/*
+ * Load a module context from args and program it. While the isp is running
+ * the module is only marked dirty, isp_commit_dirty() writes it at the next
+ * frame end so the registers never change in the middle of a frame.
+ *
+ * The irq thread reads the contexts while it commits, so the user copy is
+ * staged first and only swapped in with dev->lock held.
+ */
+int isp_s_module(struct isp_ic_dev *dev, u32 type, void *args)
+{
+	const struct isp_params_entry *entry;
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+	unsigned long flags;
+	void *stage;
+	int ret = 0;
+#endif
+
+	if (type >= ISP_PARAMS_MAX || !isp_params_table[type].set)
+		return -EINVAL;
+	entry = &isp_params_table[type];
+
+#if defined(__KERNEL__) && defined(ENABLE_IRQ)
+	stage = memdup_user(args, entry->size);
+	if (IS_ERR(stage))
+		return PTR_ERR(stage);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	memcpy((void *)dev + entry->offset, stage, entry->size);
+	if (is_isp_enable(dev))
+		set_bit(type, &dev->dirty);
+	else
+		ret = entry->set(dev);
+	spin_unlock_irqrestore(&dev->lock, flags);
+	kfree(stage);
+	return ret;
+#else
+	viv_check_retval(copy_from_user((void *)dev + entry->offset, args,
+			entry->size));
+#ifdef __KERNEL__
+	if (is_isp_enable(dev)) {
+		set_bit(type, &dev->dirty);
+		return 0;
+	}
+#endif
+	return entry->set(dev);
+#endif
+}
+
+#ifdef __KERNEL__
+/*
+ * Write every dirty module in type order and latch them all with one
+ * GEN_CFG_UPD. Called from the isp irq thread at frame end and when the
+ * isp stops. dev->lock keeps isp_s_module() from swapping a context while
+ * its setter reads it.
+ */
+void isp_commit_dirty(struct isp_ic_dev *dev)
+{
+	unsigned long dirty;
+	unsigned int type;
+	u32 isp_ctrl;
+#ifdef ENABLE_IRQ
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+#endif
+	dirty = xchg(&dev->dirty, 0);
+	for_each_set_bit(type, &dirty, ISP_PARAMS_MAX) {
+		if (isp_params_table[type].set(dev))
+			pr_debug("%s: module %u not applied\n", __func__, type);
+	}
+
+	if (dirty) {
+		isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
+		REG_SET_SLICE(isp_ctrl, MRV_ISP_ISP_GEN_CFG_UPD, 1);
+		isp_write_reg(dev, REG_ADDR(isp_ctrl), isp_ctrl);
+	}
+#ifdef ENABLE_IRQ
+	spin_unlock_irqrestore(&dev->lock, flags);
+#endif
+}
+
+/*
+ * Load every block of a params buffer into the module contexts and mark
+ * them dirty. Called from the isp irq thread at frame end with dev->lock
+ * held, right before isp_commit_dirty(), so the whole buffer lands on the
+ * same frame. A malformed block stops the walk, blocks before it stay
+ * applied.
+ *
+ * The buffer stays mapped to userspace, so every header field is read
+ * once into a local and only the local is checked and used.
+ */
+int isp_params_apply(struct isp_ic_dev *dev, const void *data, u32 size)
+{
+	const struct isp_params_header *hdr = data;
+	const struct isp_params_block *src;
+	const struct isp_params_entry *entry;
+	struct isp_params_block blk;
+	u32 version, total, offset;
+
+	if (!data || size < sizeof(*hdr))
+		return -EINVAL;
+
+	version = READ_ONCE(hdr->version);
+	total = READ_ONCE(hdr->size);
+	if (version != ISP_PARAMS_VERSION || total > size) {
+		pr_debug("%s: bad header %u/%u\n", __func__, version, total);
+		return -EINVAL;
+	}
+
+	offset = sizeof(*hdr);
+	while (offset + sizeof(blk) <= total) {
+		src = data + offset;
+		blk.type = READ_ONCE(src->type);
+		blk.size = READ_ONCE(src->size);
+		if (blk.size < sizeof(blk) || blk.size > total - offset)
+			return -EINVAL;
+
+		entry = blk.type < ISP_PARAMS_MAX ?
+				&isp_params_table[blk.type] : NULL;
+		if (entry && entry->set &&
+		    blk.size - sizeof(blk) == entry->size) {
+			memcpy((void *)dev + entry->offset, src + 1, entry->size);
+			set_bit(blk.type, &dev->dirty);
+		} else {
+			pr_debug("%s: skip block %u size %u\n", __func__,
+					blk.type, blk.size);
+		}
+		offset += ALIGN(blk.size, ISP_PARAMS_ALIGN);
+	}
+	return 0;
+}
+#endif
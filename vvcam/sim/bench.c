@@ -0,0 +1,133 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+/*
+ * Time the register programming paths of the isp/dwe core against the
+ * simulated register file and count the mmio accesses per call.
+ *
+ *   vvsim-bench [-n iterations] [name filter]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_run(const struct bench_case *bc, unsigned long iters)
+{
+	uint64_t start, elapsed;
+	unsigned long i;
+
+	sim_regs_reset();
+	bc->setup();
+	/* first call may take one-off paths, keep it out of the numbers */
+	bc->run();
+	memset(bc->mmio, 0, sizeof(*bc->mmio));
+
+	start = bench_now_ns();
+	for (i = 0; i < iters; i++)
+		bc->run();
+	elapsed = bench_now_ns() - start;
+
+	printf("%-20s %10.1f %10.1f %10.1f\n", bc->name,
+	       (double)elapsed / iters,
+	       (double)bc->mmio->reads / iters,
+	       (double)bc->mmio->writes / iters);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct bench_case *tables[] = {
+		isp_bench_cases, dwe_bench_cases, vvbuf_bench_cases,
+	};
+	const struct bench_case *bc;
+	unsigned long iters = 10000;
+	const char *filter = NULL;
+	unsigned int t;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iters = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [filter]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		filter = argv[optind];
+	if (!iters)
+		iters = 1;
+
+	printf("%-20s %10s %10s %10s\n", "case", "ns/call", "reads", "writes");
+	for (t = 0; t < sizeof(tables) / sizeof(tables[0]); t++)
+		for (bc = tables[t]; bc->name; bc++)
+			if (!filter || strstr(bc->name, filter))
+				bench_run(bc, iters);
+	if (!filter || strstr("vvbuf 2cpu", filter))
+		vvbuf_bench_2cpu(iters);
+	return 0;
+}
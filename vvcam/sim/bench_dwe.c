@@ -0,0 +1,104 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+/* dwe cases, the per frame programming done by dwe_start_job() */
+#include <string.h>
+
+#include "dwe_ioctl.h"
+#include "dwe_regs.h"
+#include "bench.h"
+
+static struct dwe_ic_dev dev;
+static struct dwe_hw_info info;
+
+static void dwe_setup(void)
+{
+	memset(&dev, 0, sizeof(dev));
+	memset(&info, 0, sizeof(info));
+	dwe_set_func(sim_dwe_read, sim_dwe_write);
+
+	info.in_format = info.out_format = 0;
+	info.map_w = 61;
+	info.map_h = 35;
+	info.src_w = info.dst_w = 1920;
+	info.src_h = info.dst_h = 1080;
+	info.src_stride = info.dst_stride = 1920;
+	info.dst_size_uv = 1920 * 1080 / 2;
+	info.scale_factor = 4096;
+}
+
+static void dwe_run_frame(void)
+{
+	u32 dewarp_ctrl;
+
+	dwe_s_params(&dev, &info);
+	dwe_set_buffer(&dev, &info, 0x80000000);
+	dwe_set_lut(&dev, 0x90000000);
+	dwe_start_dma_read(&dev, &info, 0xa0000000);
+	dewarp_ctrl = dwe_read_reg(&dev, DEWARP_CTRL);
+	dwe_write_reg(&dev, DEWARP_CTRL, dewarp_ctrl | 2);
+	dwe_write_reg(&dev, DEWARP_CTRL, dewarp_ctrl);
+	dwe_write_reg(&dev, INTERRUPT_STATUS, INT_MSK_STATUS_MASK);
+	dwe_enable_bus(&dev, 1);
+}
+
+static void dwe_run_s_params(void)
+{
+	dwe_s_params(&dev, &info);
+}
+
+const struct bench_case dwe_bench_cases[] = {
+	{ "dwe s_params", dwe_setup, dwe_run_s_params, &sim_dwe_mmio },
+	{ "dwe frame", dwe_setup, dwe_run_frame, &sim_dwe_mmio },
+	{ NULL },
+};
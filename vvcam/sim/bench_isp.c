@@ -0,0 +1,161 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+/* isp cases, driven through isp_priv_ioctl() like the userspace stack */
+#include <string.h>
+
+#include "mrv_all_bits.h"
+#include "isp_ioctl.h"
+#include "isp_types.h"
+#include "bench.h"
+
+extern MrvAllRegister_t *all_regs;
+
+static struct isp_ic_dev dev;
+
+static void isp_setup(void)
+{
+	memset(&dev, 0, sizeof(dev));
+	isp_ic_set_hal(NULL);
+}
+
+/* the lsc table is only written while the isp runs */
+static void isp_setup_enabled(void)
+{
+	isp_setup();
+	sim_isp_poke(REG_ADDR(isp_ctrl), MRV_ISP_ISP_ENABLE_MASK);
+}
+
+static void isp_setup_modules(void)
+{
+	isp_setup_enabled();
+	dev.bls.enabled = true;
+	dev.ee.enable = true;
+	dev.dpf.enable = true;
+	dev.dpf.gain_usage = IC_DPF_GAIN_USAGE_AWB_GAINS;
+	dev.dpf.filter_type = IC_DPF_RB_FILTERSIZE_9x9;
+	dev.exp.enable = true;
+	dev.hist.enable = true;
+	dev.gamma_out.enableGamma = true;
+}
+
+static void isp_setup_mi(void)
+{
+	struct isp_mi_data_path_context *mp = &dev.mi.path[0];
+
+	isp_setup();
+	mp->enable = true;
+	mp->out_mode = IC_MI_DATAMODE_YUV422;
+	mp->data_layout = IC_MI_DATASTORAGE_SEMIPLANAR;
+	mp->in_width = mp->out_width = 1920;
+	mp->in_height = mp->out_height = 1080;
+}
+
+/* the args alias the context, so the copy in the ioctl is skipped */
+#define ISP_IOCTL_CASE(fn, cmd, member) \
+static void fn(void) \
+{ \
+	isp_priv_ioctl(&dev, cmd, &dev.member); \
+}
+
+ISP_IOCTL_CASE(isp_run_s_cc, ISPIOC_S_CC, cc)
+#ifdef ISP_EE
+ISP_IOCTL_CASE(isp_run_s_ee, ISPIOC_S_EE, ee)
+#endif
+#ifdef ISP_BLS
+ISP_IOCTL_CASE(isp_run_s_bls, ISPIOC_S_BLS, bls)
+#endif
+ISP_IOCTL_CASE(isp_run_s_dpf, ISPIOC_S_DPF, dpf)
+ISP_IOCTL_CASE(isp_run_s_exp, ISPIOC_S_EXP, exp)
+ISP_IOCTL_CASE(isp_run_s_hist, ISPIOC_S_HIST, hist)
+ISP_IOCTL_CASE(isp_run_s_gamma_out, ISPIOC_S_GAMMA_OUT, gamma_out)
+ISP_IOCTL_CASE(isp_run_s_lsc_tbl, ISPIOC_S_LSC_TBL, lsc)
+ISP_IOCTL_CASE(isp_run_mi_start, ISPIOC_MI_START, mi)
+
+static void isp_run_g_awbmean(void)
+{
+	struct isp_awb_mean mean;
+
+	isp_priv_ioctl(&dev, ISPIOC_G_AWBMEAN, &mean);
+}
+
+static void isp_run_g_expmean(void)
+{
+	u8 mean[25];
+
+	isp_priv_ioctl(&dev, ISPIOC_G_EXPMEAN, mean);
+}
+
+const struct bench_case isp_bench_cases[] = {
+	{ "isp s_cc", isp_setup_modules, isp_run_s_cc, &sim_isp_mmio },
+	/* left out when the VERSION_CFG builds the module as a stub */
+#ifdef ISP_EE
+	{ "isp s_ee", isp_setup_modules, isp_run_s_ee, &sim_isp_mmio },
+#endif
+#ifdef ISP_BLS
+	{ "isp s_bls", isp_setup_modules, isp_run_s_bls, &sim_isp_mmio },
+#endif
+	{ "isp s_dpf", isp_setup_modules, isp_run_s_dpf, &sim_isp_mmio },
+	{ "isp s_exp", isp_setup_modules, isp_run_s_exp, &sim_isp_mmio },
+	{ "isp s_hist", isp_setup_modules, isp_run_s_hist, &sim_isp_mmio },
+	{ "isp s_gamma_out", isp_setup_modules, isp_run_s_gamma_out,
+	  &sim_isp_mmio },
+	{ "isp g_awbmean", isp_setup_modules, isp_run_g_awbmean,
+	  &sim_isp_mmio },
+	{ "isp g_expmean", isp_setup_modules, isp_run_g_expmean,
+	  &sim_isp_mmio },
+	{ "isp s_lsc_tbl", isp_setup_enabled, isp_run_s_lsc_tbl,
+	  &sim_isp_mmio },
+	{ "isp mi_start", isp_setup_mi, isp_run_mi_start, &sim_isp_mmio },
+	{ NULL },
+};
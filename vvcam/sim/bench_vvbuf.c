@@ -0,0 +1,265 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "video/vvbuf.h"
+#include "bench.h"
+
+#define VVBUF_BENCH_DEPTH 8
+
+static struct vvbuf_ctx ctx;
+static struct vb2_dc_buf bufs[VVBUF_BENCH_DEPTH];
+/* nothing here touches the register file */
+static struct sim_mmio_stats vvbuf_mmio;
+
+/* keep half the queue filled, as with a few buffers queued ahead */
+static void vvbuf_fill(void)
+{
+	int i;
+
+	for (i = 0; i < VVBUF_BENCH_DEPTH / 2; i++)
+		vvbuf_push_buf(&ctx, &bufs[i]);
+}
+
+static void vvbuf_setup_list(void)
+{
+	vvbuf_ctx_deinit(&ctx);
+	vvbuf_ctx_init(&ctx);
+	vvbuf_fill();
+}
+
+static void vvbuf_setup_ring(void)
+{
+	vvbuf_ctx_deinit(&ctx);
+	vvbuf_ctx_init_ring(&ctx, VVBUF_BENCH_DEPTH);
+	vvbuf_fill();
+}
+
+/* one qbuf handed to the queue and one buffer taken by the frame end */
+static void vvbuf_run_cycle(void)
+{
+	vvbuf_push_buf(&ctx, vvbuf_pull_buf(&ctx));
+}
+
+const struct bench_case vvbuf_bench_cases[] = {
+	{ "vvbuf list", vvbuf_setup_list, vvbuf_run_cycle, &vvbuf_mmio },
+	{ "vvbuf ring", vvbuf_setup_ring, vvbuf_run_cycle, &vvbuf_mmio },
+	{ NULL },
+};
+
+/*
+ * Two producers feed one queue from their own cpus while a third drains
+ * it, as qbuf and the dwe return path do while the isp frame end pulls.
+ * At most VVBUF_BENCH_DEPTH buffers are out at once.  Reports the cost of
+ * a push and of a pull that found a buffer, then, in a second pass with
+ * the lock timed, how long irqlock was held and irqs would have been off.
+ */
+#define VVBUF_2CPU_PRODUCERS 2
+
+struct vvbuf_2cpu_thread {
+	pthread_t thread;
+	int cpu;
+	unsigned long calls;
+	u64 ns;
+};
+
+static struct vvbuf_2cpu_thread producers[VVBUF_2CPU_PRODUCERS];
+static struct vvbuf_2cpu_thread consumer;
+static unsigned long vvbuf_2cpu_iters;
+static int vvbuf_2cpu_inflight, vvbuf_2cpu_stop;
+static u64 vvbuf_2cpu_clock_ns;
+
+static void vvbuf_2cpu_pin(int cpu)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu % (ncpu > 0 ? ncpu : 1), &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *vvbuf_2cpu_produce(void *arg)
+{
+	struct vvbuf_2cpu_thread *t = arg;
+	struct vb2_dc_buf *buf = &bufs[t - producers];
+	u64 start;
+
+	vvbuf_2cpu_pin(t->cpu);
+	while (!__atomic_load_n(&vvbuf_2cpu_stop, __ATOMIC_ACQUIRE)) {
+		/* a buffer of our own has to come back first */
+		if (__atomic_add_fetch(&vvbuf_2cpu_inflight, 1,
+				__ATOMIC_ACQ_REL) > VVBUF_BENCH_DEPTH) {
+			__atomic_sub_fetch(&vvbuf_2cpu_inflight, 1,
+					__ATOMIC_ACQ_REL);
+			sched_yield();
+			continue;
+		}
+		start = kstub_now_ns();
+		vvbuf_push_buf(&ctx, buf);
+		t->ns += kstub_now_ns() - start - vvbuf_2cpu_clock_ns;
+		t->calls++;
+	}
+	return NULL;
+}
+
+static void *vvbuf_2cpu_consume(void *arg)
+{
+	struct vvbuf_2cpu_thread *t = arg;
+	struct vb2_dc_buf *buf;
+	u64 start, ns;
+
+	vvbuf_2cpu_pin(t->cpu);
+	while (t->calls < vvbuf_2cpu_iters) {
+		start = kstub_now_ns();
+		buf = vvbuf_pull_buf(&ctx);
+		ns = kstub_now_ns() - start - vvbuf_2cpu_clock_ns;
+		if (!buf) {
+			sched_yield();
+			continue;
+		}
+		t->ns += ns;
+		t->calls++;
+		__atomic_sub_fetch(&vvbuf_2cpu_inflight, 1, __ATOMIC_ACQ_REL);
+	}
+	__atomic_store_n(&vvbuf_2cpu_stop, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void vvbuf_2cpu_pass(bool ring, bool timed)
+{
+	int i;
+
+	vvbuf_ctx_deinit(&ctx);
+	if (ring)
+		vvbuf_ctx_init_ring(&ctx, VVBUF_BENCH_DEPTH);
+	else
+		vvbuf_ctx_init(&ctx);
+	ctx.irqlock.timed = timed;
+	vvbuf_2cpu_inflight = 0;
+	vvbuf_2cpu_stop = 0;
+
+	memset(&consumer, 0, sizeof(consumer));
+	memset(producers, 0, sizeof(producers));
+	pthread_create(&consumer.thread, NULL, vvbuf_2cpu_consume, &consumer);
+	for (i = 0; i < VVBUF_2CPU_PRODUCERS; i++) {
+		producers[i].cpu = i + 1;
+		pthread_create(&producers[i].thread, NULL,
+				vvbuf_2cpu_produce, &producers[i]);
+	}
+	pthread_join(consumer.thread, NULL);
+	for (i = 0; i < VVBUF_2CPU_PRODUCERS; i++)
+		pthread_join(producers[i].thread, NULL);
+}
+
+static double vvbuf_2cpu_net(u64 ns, u64 count)
+{
+	double avg;
+
+	if (!count || !ns)
+		return 0.0;
+	avg = (double)ns / count - vvbuf_2cpu_clock_ns;
+	return avg > 0.0 ? avg : 0.0;
+}
+
+static void vvbuf_2cpu_run(const char *name, bool ring)
+{
+	unsigned long pushes = 0;
+	u64 push_ns = 0;
+	spinlock_t *l = &ctx.irqlock;
+	int i;
+
+	vvbuf_2cpu_pass(ring, false);
+	for (i = 0; i < VVBUF_2CPU_PRODUCERS; i++) {
+		pushes += producers[i].calls;
+		push_ns += producers[i].ns;
+	}
+
+	printf("%-20s %10.1f %10.1f", name,
+	       pushes ? (double)push_ns / pushes : 0.0,
+	       consumer.calls ? (double)consumer.ns / consumer.calls : 0.0);
+
+	/* the lock times its hold with a clock read inside, take it off */
+	vvbuf_2cpu_pass(ring, true);
+	printf(" %10.1f %10.1f %10.1f %10.1f\n",
+	       vvbuf_2cpu_net(l->held, l->count),
+	       vvbuf_2cpu_net(l->held_max, 1),
+	       vvbuf_2cpu_net(l->irqoff, l->count),
+	       vvbuf_2cpu_net(l->irqoff_max, 1));
+}
+
+void vvbuf_bench_2cpu(unsigned long iters)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	u64 start;
+	int i;
+
+	/* what a pair of clock reads costs, taken off every timed call */
+	start = kstub_now_ns();
+	for (i = 0; i < 1000; i++)
+		kstub_now_ns();
+	vvbuf_2cpu_clock_ns = (kstub_now_ns() - start) / 1000;
+
+	vvbuf_2cpu_iters = iters;
+	printf("\n%d producers and 1 consumer on %ld cpus, ns per call\n",
+	       VVBUF_2CPU_PRODUCERS, ncpu);
+	if (ncpu < VVBUF_2CPU_PRODUCERS + 1)
+		printf("fewer cpus than threads: the maxima include preemption\n");
+	printf("%-20s %10s %10s %10s %10s %10s %10s\n", "case", "push",
+	       "pull", "held", "held max", "irqs off", "off max");
+	vvbuf_2cpu_run("vvbuf 2cpu list", false);
+	vvbuf_2cpu_run("vvbuf 2cpu ring", true);
+}
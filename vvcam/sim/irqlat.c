@@ -0,0 +1,307 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+/*
+ * Host model of the isp frame end under cpu load: does the next mi buffer
+ * address get written before the next frame starts?  A SCHED_FIFO timer
+ * thread stands in for the hard irq and fires at every frame end.  It
+ * either programs the buffer itself (irq_dma_update, or mi_depth > 2) or
+ * wakes a second thread that does it (the irq thread at mi_depth 2).
+ * Busy threads on the same cpu stand in for whatever else wants it; they
+ * and the irq thread share SCHED_OTHER.  The programming is the real
+ * isp_set_buffer() on the simulated registers.
+ *
+ * A write later than the vertical blanking after the frame end counts as
+ * late, the same as dma_stats.late.  This is a model on the host
+ * scheduler, not the board: it shows how the wakeup latency of a thread
+ * becomes late buffers, not what a given board does.
+ *
+ *   vvsim-irqlat [-f frames] [-p period us] [-b blanking us] [-l load]
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isp_ioctl.h"
+#include "isp_types.h"
+#include "sim_regs.h"
+
+static struct isp_ic_dev dev;
+
+static unsigned int frames = 2000;
+static unsigned int period_us = 1000;
+static unsigned int blank_us = 100;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static unsigned int ended;	/* frame ends raised so far */
+static bool stop;
+
+static uint64_t *frame_end;	/* ns, when each frame end fired */
+static uint64_t *programmed;	/* ns, when its next buffer was written */
+static volatile bool load_stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* everything shares cpu 0, as the irq, its thread and the load would */
+static void pin_cpu0(void)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static bool set_fifo(int prio)
+{
+	struct sched_param sp = { .sched_priority = prio };
+
+	return !pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+}
+
+/* the timer may be SCHED_FIFO, the others must not inherit that */
+static void start_other(pthread_t *thread, void *(*fn)(void *))
+{
+	struct sched_param sp = { .sched_priority = 0 };
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	pthread_attr_setschedparam(&attr, &sp);
+	pthread_create(thread, &attr, fn, NULL);
+	pthread_attr_destroy(&attr);
+}
+
+static void program_next(unsigned int k)
+{
+	struct isp_buffer_context buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.addr_y = 0x10000000 + (k & 7) * 0x400000;
+	buf.size_y = 1920 * 1080;
+	buf.addr_cb = buf.addr_y + buf.size_y;
+	buf.size_cb = buf.size_y / 2;
+	isp_set_buffer(&dev, &buf);
+	programmed[k] = now_ns();
+}
+
+static void *irq_thread(void *arg)
+{
+	unsigned int k = 0, n;
+
+	pin_cpu0();
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		while (k == ended && !stop)
+			pthread_cond_wait(&wake, &lock);
+		n = ended;
+		pthread_mutex_unlock(&lock);
+		if (k == n)
+			break;
+		/* frame ends that piled up are handled in one go, as the
+		 * thread does with the latched mis bits */
+		for (; k < n; k++)
+			program_next(k);
+	}
+	return NULL;
+}
+
+static void *load_thread(void *arg)
+{
+	pin_cpu0();
+	while (!load_stop)
+		;
+	return NULL;
+}
+
+struct result {
+	unsigned int late;
+	uint64_t p50, p99, max;
+};
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void run(bool in_irq, unsigned int load, struct result *r)
+{
+	pthread_t thread, *loads;
+	struct timespec ts;
+	uint64_t t0, t, *lat;
+	unsigned int i, k;
+
+	memset(frame_end, 0, frames * sizeof(*frame_end));
+	memset(programmed, 0, frames * sizeof(*programmed));
+	ended = 0;
+	stop = false;
+	load_stop = false;
+
+	loads = calloc(load ? load : 1, sizeof(*loads));
+	for (i = 0; i < load; i++)
+		start_other(&loads[i], load_thread);
+	if (!in_irq)
+		start_other(&thread, irq_thread);
+
+	t0 = now_ns() + 10 * 1000000ull;
+	for (k = 0; k < frames; k++) {
+		t = t0 + (uint64_t)k * period_us * 1000;
+		ts.tv_sec = t / 1000000000ull;
+		ts.tv_nsec = t % 1000000000ull;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		/* the frame end as the hardware raised it */
+		frame_end[k] = t;
+		if (in_irq) {
+			program_next(k);
+			continue;
+		}
+		pthread_mutex_lock(&lock);
+		ended++;
+		pthread_cond_signal(&wake);
+		pthread_mutex_unlock(&lock);
+	}
+
+	if (!in_irq) {
+		pthread_mutex_lock(&lock);
+		stop = true;
+		pthread_cond_signal(&wake);
+		pthread_mutex_unlock(&lock);
+		pthread_join(thread, NULL);
+	}
+	load_stop = true;
+	for (i = 0; i < load; i++)
+		pthread_join(loads[i], NULL);
+	free(loads);
+
+	lat = calloc(frames, sizeof(*lat));
+	r->late = 0;
+	for (k = 0; k < frames; k++) {
+		lat[k] = programmed[k] - frame_end[k];
+		if (lat[k] > (uint64_t)blank_us * 1000)
+			r->late++;
+	}
+	qsort(lat, frames, sizeof(*lat), cmp_u64);
+	r->p50 = lat[frames / 2];
+	r->p99 = lat[frames * 99 / 100];
+	r->max = lat[frames - 1];
+	free(lat);
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const mode[] = { "thread", "hard irq" };
+	unsigned int load = 8, l, m;
+	struct result r;
+	bool fifo;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:p:b:l:")) != -1) {
+		switch (opt) {
+		case 'f':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			period_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			blank_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			load = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f frames] [-p period us] "
+				"[-b blanking us] [-l load]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!frames || !period_us)
+		return 1;
+
+	frame_end = calloc(frames, sizeof(*frame_end));
+	programmed = calloc(frames, sizeof(*programmed));
+	sim_regs_reset();
+	isp_ic_set_hal(NULL);
+
+	pin_cpu0();
+	fifo = set_fifo(90);
+	printf("%u frames every %u us, late after %u us of blanking%s\n",
+	       frames, period_us, blank_us,
+	       fifo ? "" : " (no SCHED_FIFO, the timer is a normal thread)");
+	printf("%-10s %5s %8s %8s %10s %10s %10s\n", "mode", "load",
+	       "late", "late %", "p50 us", "p99 us", "max us");
+	for (l = 0; l <= load; l += load ? load : 1) {
+		for (m = 0; m < 2; m++) {
+			run(m, l, &r);
+			printf("%-10s %5u %8u %8.2f %10.1f %10.1f %10.1f\n",
+			       mode[m], l, r.late, 100.0 * r.late / frames,
+			       r.p50 / 1000.0, r.p99 / 1000.0, r.max / 1000.0);
+		}
+	}
+	return 0;
+}
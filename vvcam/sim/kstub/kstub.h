@@ -0,0 +1,353 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _SIM_KSTUB_H_
+#define _SIM_KSTUB_H_
+
+/*
+ * Just enough of the kernel api to build v4l2/video/vvbuf.c and
+ * v4l2/vvsensor_i2c.c on the host.  Media graph lookups find nothing,
+ * spinlocks are a plain test-and-set so the uncontended cost stays in the
+ * numbers, and can time how long they are held.  The i2c bus and msleep
+ * are left to the program linking them.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef uint64_t dma_addr_t;
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define BIT(n)			(1ul << (n))
+#define max_t(type, a, b)	((type)(a) > (type)(b) ? (type)(a) : (type)(b))
+#define min_t(type, a, b)	((type)(a) < (type)(b) ? (type)(a) : (type)(b))
+
+#define EXPORT_SYMBOL_GPL(sym)
+#define MODULE_DESCRIPTION(s)
+#define MODULE_AUTHOR(s)
+#define MODULE_LICENSE(s)
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#define GFP_KERNEL 0
+#define kmalloc(size, gfp)	malloc(size)
+#define kcalloc(n, size, gfp)	calloc(n, size)
+#define kzalloc(size, gfp)	calloc(1, size)
+#define krealloc(p, size, gfp)	realloc((void *)(p), size)
+#define kfree(p)		free((void *)(p))
+
+static inline unsigned long roundup_pow_of_two(unsigned long n)
+{
+	return n <= 1 ? 1 : 1ul << (64 - __builtin_clzl(n - 1));
+}
+
+static inline u64 kstub_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * With timed set a lock also keeps how long it was held and, for the
+ * _irqsave variants, how long irqs would have been off: from before the
+ * spin for the lock to its release.  The holder updates them, so the
+ * lock itself protects them.
+ */
+typedef struct {
+	int locked;
+	bool timed;
+	u64 since, irqoff_since;
+	u64 count, held, held_max, irqoff, irqoff_max;
+} spinlock_t;
+
+static inline void kstub_spin_lock(spinlock_t *l, bool irqoff)
+{
+	u64 start = l->timed && irqoff ? kstub_now_ns() : 0;
+
+	while (__atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE))
+		;
+	if (l->timed) {
+		l->since = kstub_now_ns();
+		l->irqoff_since = irqoff ? start : 0;
+	}
+}
+
+static inline void kstub_spin_unlock(spinlock_t *l)
+{
+	u64 now, held;
+
+	if (l->timed) {
+		now = kstub_now_ns();
+		held = now - l->since;
+		l->count++;
+		l->held += held;
+		if (held > l->held_max)
+			l->held_max = held;
+		if (l->irqoff_since) {
+			held = now - l->irqoff_since;
+			l->irqoff += held;
+			if (held > l->irqoff_max)
+				l->irqoff_max = held;
+		}
+	}
+	__atomic_store_n(&l->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define spin_lock_init(l)	memset(l, 0, sizeof(spinlock_t))
+#define spin_lock(l)		kstub_spin_lock(l, false)
+#define spin_unlock(l)		kstub_spin_unlock(l)
+#define spin_lock_irqsave(l, flags) \
+	do { \
+		(flags) = 0; \
+		kstub_spin_lock(l, true); \
+	} while (0)
+#define spin_unlock_irqrestore(l, flags) kstub_spin_unlock(l)
+
+/* nothing sleeps on the host, a mutex spins as the spinlock does */
+struct mutex {
+	int locked;
+};
+
+#define mutex_init(m)		((m)->locked = 0)
+#define mutex_destroy(m)	((void)(m))
+#define mutex_lock(m) \
+	do { \
+		while (__atomic_exchange_n(&(m)->locked, 1, __ATOMIC_ACQUIRE)) \
+			; \
+	} while (0)
+#define mutex_unlock(m) \
+	__atomic_store_n(&(m)->locked, 0, __ATOMIC_RELEASE)
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list->prev = list;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+	entry->prev = head;
+	entry->next = head->next;
+	head->next->prev = entry;
+	head->next = entry;
+}
+
+static inline void list_add_tail(struct list_head *entry,
+				 struct list_head *head)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+	list_del(entry);
+	INIT_LIST_HEAD(entry);
+}
+
+#define list_first_entry(head, type, member) \
+	container_of((head)->next, type, member)
+
+static inline void sort(void *base, size_t num, size_t size,
+			int (*cmp)(const void *, const void *),
+			void (*swap)(void *, void *, int))
+{
+	qsort(base, num, size, cmp);
+}
+
+#define BITS_PER_LONG	(8 * sizeof(long))
+#define BITS_TO_LONGS(n)	(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+static inline unsigned long *bitmap_zalloc(unsigned int nbits, int gfp)
+{
+	return calloc(BITS_TO_LONGS(nbits), sizeof(long));
+}
+
+static inline void bitmap_free(const unsigned long *map)
+{
+	free((void *)map);
+}
+
+static inline void bitmap_zero(unsigned long *map, unsigned int nbits)
+{
+	memset(map, 0, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+static inline void set_bit(long nr, unsigned long *map)
+{
+	map[nr / BITS_PER_LONG] |= 1ul << (nr % BITS_PER_LONG);
+}
+
+static inline int test_bit(long nr, const unsigned long *map)
+{
+	return (map[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1;
+}
+
+typedef s64 ktime_t;
+
+static inline ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (s64)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static inline s64 ktime_us_delta(ktime_t later, ktime_t earlier)
+{
+	return (later - earlier) / 1000;
+}
+
+void msleep(unsigned int msecs);
+
+struct device {
+	const char *name;
+};
+
+#define dev_err(dev, fmt, ...) \
+	fprintf(stderr, "%s: " fmt, (dev)->name, ##__VA_ARGS__)
+#define dev_warn(dev, fmt, ...) \
+	fprintf(stderr, "%s: " fmt, (dev)->name, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...)	((void)(dev))
+
+struct i2c_adapter_quirks {
+	u16 max_write_len;
+};
+
+struct i2c_adapter {
+	const struct i2c_adapter_quirks *quirks;
+};
+
+struct i2c_client {
+	unsigned short addr;
+	unsigned short flags;
+	struct i2c_adapter *adapter;
+	struct device dev;
+};
+
+struct i2c_msg {
+	u16 addr;
+	u16 flags;
+	u16 len;
+	u8 *buf;
+};
+
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
+int i2c_master_send(const struct i2c_client *client, const char *buf,
+		    int count);
+int i2c_master_recv(const struct i2c_client *client, char *buf, int count);
+
+struct media_entity {
+	int type;
+};
+
+struct media_pad {
+	struct media_entity *entity;
+	u16 index;
+};
+
+struct video_device;
+struct v4l2_subdev;
+
+static inline struct media_pad *media_entity_remote_pad(struct media_pad *pad)
+{
+	return NULL;
+}
+
+#define is_media_entity_v4l2_video_device(entity)	false
+#define is_media_entity_v4l2_subdev(entity)		false
+#define media_entity_to_video_device(entity)	((struct video_device *)NULL)
+#define media_entity_to_v4l2_subdev(entity)	((struct v4l2_subdev *)NULL)
+#define video_get_drvdata(vdev)			NULL
+#define v4l2_get_subdevdata(sd)			NULL
+
+struct vb2_v4l2_buffer {
+	u32 sequence;
+};
+
+#endif /* _SIM_KSTUB_H_ */
@@ -0,0 +1,425 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+/*
+ * Checks the mode switch diffs of v4l2/vvsensor_i2c.c against a full
+ * mode write, for every mode pair of the sensors with register tables.
+ * The i2c bus ends in a register file that goes back to random reset
+ * values when the soft reset register is written.  A switch has to leave
+ * the same registers as the full write, apart from the runtime registers
+ * the new table does not set, and the register cache has to agree with
+ * the register file afterwards.
+ *
+ * I2C times are computed, not measured: 9 clocks per byte plus the
+ * device address byte, start and stop per transfer, at 400 kHz, plus the
+ * delays of the tables.
+ */
+#include "vvsensor_i2c.h"
+
+#include "ov2775_regs_1080p.h"
+#include "ov2775_regs_1080p_hdr.h"
+#include "ov2775_regs_1080p_hdr_low_freq.h"
+#include "ov2775_regs_1080p_native_hdr.h"
+#include "ov2775_regs_1080p_hdr_2dol.h"
+#include "ov2775_i2c_ranges.h"
+#include "os08a20_regs_1080p.h"
+#include "os08a20_regs_1080p_hdr.h"
+#include "os08a20_regs_4k.h"
+#include "os08a20_regs_4k_hdr.h"
+#include "os08a20_i2c_ranges.h"
+#include "ar1335_regs_1080p.h"
+#include "ar1335_regs_1080p60.h"
+#include "ar1335_regs_12MP.h"
+#include "ar1335_i2c_ranges.h"
+
+#define REGCHECK_REGS	0x10000
+#define REGCHECK_KHZ	400
+
+struct regcheck_mode {
+	const char *name;
+	const struct vvcam_sccb_data_s *table;
+	u32 count;
+};
+
+struct regcheck_sensor {
+	const char *name;
+	u8 data_bytes;
+	u16 reset_reg;		/* reset when written with bit 0 set */
+	int zero;		/* reads 0 out of reset, -1 for none */
+	const struct vvsensor_reg_range *ranges;
+	u32 nranges;
+	const struct vvcam_sccb_data_s *reset;
+	u32 reset_count;
+	const struct regcheck_mode *modes;
+	u32 nmodes;
+};
+
+#define REGCHECK_MODE(n, t)	{ n, t, ARRAY_SIZE(t) }
+
+static const struct regcheck_mode ov2775_modes[] = {
+	REGCHECK_MODE("1080p", ov2775_init_setting_1080p),
+	REGCHECK_MODE("1080p_hdr", ov2775_init_setting_1080p_hdr),
+	REGCHECK_MODE("hdr_low_freq", ov2775_init_setting_1080p_hdr_low_freq),
+	REGCHECK_MODE("native_hdr", ov2775_1080p_native_hdr_regs),
+	REGCHECK_MODE("hdr_2dol", ov2775_init_setting_1080p_hdr_2dol),
+};
+
+static const struct regcheck_mode os08a20_modes[] = {
+	REGCHECK_MODE("1080p", os08a20_init_setting_1080p),
+	REGCHECK_MODE("1080p_hdr", os08a20_init_setting_1080p_hdr),
+	REGCHECK_MODE("4k", os08a20_init_setting_4k),
+	REGCHECK_MODE("4k_hdr", os08a20_init_setting_4k_hdr),
+};
+
+static const struct regcheck_mode ar1335_modes[] = {
+	REGCHECK_MODE("1080p", ar1335_init_setting_1080p),
+	REGCHECK_MODE("1080p60", ar1335_init_setting_1080p60),
+	REGCHECK_MODE("12MP", ar1335_init_setting_12MP),
+};
+
+static const struct regcheck_sensor sensors[] = {
+	{
+		.name = "ov2775",
+		.data_bytes = 1,
+		.reset_reg = 0x3013,
+		.zero = -1,
+		.ranges = ov2775_i2c_ranges,
+		.nranges = ARRAY_SIZE(ov2775_i2c_ranges),
+		.reset = ov2775_soft_reset,
+		.reset_count = ARRAY_SIZE(ov2775_soft_reset),
+		.modes = ov2775_modes,
+		.nmodes = ARRAY_SIZE(ov2775_modes),
+	},
+	{
+		.name = "os08a20",
+		.data_bytes = 1,
+		.reset_reg = 0x0103,
+		.zero = 0x0100,	/* out of reset in standby */
+		.ranges = os08a20_i2c_ranges,
+		.nranges = ARRAY_SIZE(os08a20_i2c_ranges),
+		.reset = os08a20_soft_reset,
+		.reset_count = ARRAY_SIZE(os08a20_soft_reset),
+		.modes = os08a20_modes,
+		.nmodes = ARRAY_SIZE(os08a20_modes),
+	},
+	{
+		.name = "ar1335",
+		.data_bytes = 2,
+		.reset_reg = AR1335_RESET_REG,
+		.zero = -1,
+		/* the tables reset the sensor themselves */
+		.ranges = ar1335_i2c_ranges,
+		.nranges = ARRAY_SIZE(ar1335_i2c_ranges),
+		.modes = ar1335_modes,
+		.nmodes = ARRAY_SIZE(ar1335_modes),
+	},
+};
+
+/* the simulated sensor */
+static const struct regcheck_sensor *cur;
+static u32 regs[REGCHECK_REGS], regs_reset[REGCHECK_REGS];
+static u32 read_addr;
+
+struct regcheck_stats {
+	u32 xfers;
+	u32 bytes;
+	u32 reads;
+	u32 delay_ms;
+};
+
+static struct regcheck_stats bus;
+
+static void regcheck_store(u32 addr, u32 val)
+{
+	if (addr == cur->reset_reg && (val & 1))
+		memcpy(regs, regs_reset, sizeof(regs));
+	else
+		regs[addr % REGCHECK_REGS] = val;
+}
+
+static void regcheck_write_buf(const u8 *buf, int len)
+{
+	u32 addr = (buf[0] << 8) | buf[1], val;
+	int i;
+
+	for (i = 2; i + cur->data_bytes <= len; i += cur->data_bytes) {
+		val = cur->data_bytes == 2 ? (buf[i] << 8) | buf[i + 1] : buf[i];
+		regcheck_store(addr, val);
+		addr += cur->data_bytes;
+	}
+}
+
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		regcheck_write_buf(msgs[i].buf, msgs[i].len);
+		bus.xfers++;
+		bus.bytes += msgs[i].len;
+	}
+	return num;
+}
+
+int i2c_master_send(const struct i2c_client *client, const char *buf,
+		    int count)
+{
+	const u8 *p = (const u8 *)buf;
+
+	bus.xfers++;
+	bus.bytes += count;
+	if (count == 2) {
+		read_addr = (p[0] << 8) | p[1];
+		bus.reads++;
+	} else {
+		regcheck_write_buf(p, count);
+	}
+	return count;
+}
+
+int i2c_master_recv(const struct i2c_client *client, char *buf, int count)
+{
+	u32 val = regs[read_addr];
+
+	bus.xfers++;
+	bus.bytes += count;
+	if (count == 2) {
+		buf[0] = val >> 8;
+		buf[1] = val;
+	} else {
+		buf[0] = val;
+	}
+	return count;
+}
+
+void msleep(unsigned int msecs)
+{
+	bus.delay_ms += msecs;
+}
+
+static double regcheck_ms(const struct regcheck_stats *st)
+{
+	u32 clocks = (st->bytes + st->xfers) * 9 + st->xfers * 2;
+
+	return (double)clocks / REGCHECK_KHZ + st->delay_ms;
+}
+
+static u32 regcheck_flags(u32 addr)
+{
+	u32 i, flags = 0;
+
+	for (i = 0; i < cur->nranges; i++)
+		if (addr >= cur->ranges[i].first && addr <= cur->ranges[i].last)
+			flags |= cur->ranges[i].flags;
+	return flags;
+}
+
+static bool regcheck_in_table(const struct regcheck_mode *m, u32 addr)
+{
+	u32 i;
+
+	for (i = 0; i < m->count; i++)
+		if (m->table[i].addr == addr)
+			return true;
+	return false;
+}
+
+static bool regcheck_has_diff(const struct vvsensor_i2c *i2c,
+		const struct regcheck_mode *from,
+		const struct regcheck_mode *to)
+{
+	u32 i;
+
+	for (i = 0; i < i2c->ndiffs; i++)
+		if (i2c->diffs[i].from == from->table &&
+		    i2c->diffs[i].to == to->table)
+			return true;
+	return false;
+}
+
+static int regcheck_write_mode(struct vvsensor_i2c *i2c,
+		const struct regcheck_mode *m)
+{
+	return vvsensor_i2c_write_mode(i2c, cur->reset, cur->reset_count,
+			m->table, m->count);
+}
+
+/* the cache against the register file, every slot read back */
+static u32 regcheck_cache(struct vvsensor_i2c *i2c, bool verbose)
+{
+	u32 k, addr, val, valid = 0, reads = bus.reads, bad = 0;
+
+	for (k = 0; k < i2c->ncache; k++) {
+		addr = i2c->cache[k].addr;
+		if (test_bit(k, i2c->cache_valid)) {
+			valid++;
+			if (i2c->cache[k].data != regs[addr]) {
+				printf("  stale cache 0x%04x\n", addr);
+				bad++;
+			}
+		}
+		if (vvsensor_i2c_read(i2c, addr, &val) || val != regs[addr]) {
+			printf("  read 0x%04x\n", addr);
+			bad++;
+		}
+	}
+	if (verbose)
+		printf("  cache %u slots, %u valid after a switch, %u bus reads for all\n",
+		       i2c->ncache, valid, bus.reads - reads);
+	return bad;
+}
+
+static u32 regcheck_pair(struct vvsensor_i2c *i2c,
+		const struct regcheck_mode *from,
+		const struct regcheck_mode *to, bool verbose)
+{
+	static u32 ref[REGCHECK_REGS];
+	struct regcheck_stats full, sw;
+	u32 addr, flags, bad = 0;
+
+	/* the reference, a full write of the new mode */
+	memcpy(regs, regs_reset, sizeof(regs));
+	vvsensor_i2c_invalidate(i2c);
+	memset(&bus, 0, sizeof(bus));
+	if (regcheck_write_mode(i2c, to))
+		bad++;
+	full = bus;
+	memcpy(ref, regs, sizeof(ref));
+
+	/* the old mode, the controls set at runtime, then the switch */
+	memcpy(regs, regs_reset, sizeof(regs));
+	vvsensor_i2c_invalidate(i2c);
+	if (regcheck_write_mode(i2c, from))
+		bad++;
+	for (addr = 0; addr < REGCHECK_REGS; addr++) {
+		flags = regcheck_flags(addr);
+		if ((flags & VVSENSOR_REG_SWITCH) &&
+		    !(flags & VVSENSOR_REG_TRIGGER))
+			vvsensor_i2c_write(i2c, addr, rand() & 0xff);
+	}
+	memset(&bus, 0, sizeof(bus));
+	if (regcheck_write_mode(i2c, to))
+		bad++;
+	sw = bus;
+
+	bad += regcheck_cache(i2c, verbose);
+	for (addr = 0; addr < REGCHECK_REGS; addr++) {
+		if (regs[addr] == ref[addr])
+			continue;
+		flags = regcheck_flags(addr);
+		if (flags & VVSENSOR_REG_TRIGGER)
+			continue;
+		if ((flags & VVSENSOR_REG_SWITCH) && !regcheck_in_table(to, addr))
+			continue;
+		printf("  mismatch 0x%04x: 0x%x, full write 0x%x\n",
+		       addr, regs[addr], ref[addr]);
+		bad++;
+	}
+
+	printf("  %-12s -> %-12s full %4u xfers %5u B %6.1f ms | %s %4u xfers %5u B %6.1f ms\n",
+	       from->name, to->name, full.xfers, full.bytes, regcheck_ms(&full),
+	       regcheck_has_diff(i2c, from, to) ? "diff" : "full",
+	       sw.xfers, sw.bytes, regcheck_ms(&sw));
+	return bad;
+}
+
+static u32 regcheck_sensor(const struct regcheck_sensor *s)
+{
+	struct i2c_adapter adap = { 0 };
+	struct i2c_client client = {
+		.adapter = &adap,
+		.dev = { .name = s->name },
+	};
+	struct vvsensor_i2c i2c;
+	u32 i, j, addr, mask = s->data_bytes == 2 ? 0xffff : 0xff, bad = 0;
+
+	cur = s;
+	srand(1);
+	for (addr = 0; addr < REGCHECK_REGS; addr++)
+		regs_reset[addr] = rand() & mask;
+	if (s->zero >= 0)
+		regs_reset[s->zero] = 0;
+	memcpy(regs, regs_reset, sizeof(regs));
+
+	if (vvsensor_i2c_init(&i2c, &client, 2, s->data_bytes))
+		return 1;
+	for (i = 0; i < s->nmodes; i++)
+		vvsensor_i2c_add_mode(&i2c, s->modes[i].table,
+				      s->modes[i].count);
+	i2c.ranges = s->ranges;
+	i2c.nranges = s->nranges;
+	if (vvsensor_i2c_add_diffs(&i2c) || vvsensor_i2c_add_cache(&i2c)) {
+		vvsensor_i2c_exit(&i2c);
+		return 1;
+	}
+
+	printf("%s: %u reset values read, %u diffs\n", s->name,
+	       i2c.ndefaults, i2c.ndiffs);
+	for (i = 0; i < s->nmodes; i++)
+		for (j = 0; j < s->nmodes; j++)
+			if (i != j)
+				bad += regcheck_pair(&i2c, &s->modes[i],
+						     &s->modes[j],
+						     !i && j == 1);
+	vvsensor_i2c_exit(&i2c);
+	return bad;
+}
+
+int main(void)
+{
+	u32 i, bad = 0;
+
+	for (i = 0; i < ARRAY_SIZE(sensors); i++)
+		bad += regcheck_sensor(&sensors[i]);
+	printf("%s\n", bad ? "FAIL" : "ok");
+	return bad != 0;
+}
@@ -0,0 +1,317 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+/*
+ * Behavioural register model for the host simulation build. Plain
+ * registers read back what was written. On top of that it models the
+ * parts the driver relies on for correctness:
+ *  - interrupt blocks: mis = ris & imsc, icr clears and isr sets ris
+ *  - self clearing update bits in isp_ctrl, mi_init and the resizers
+ *  - *_shd registers, latched on an immediate update or at frame end
+ * Every access through the hal or the dwe bar accessors is counted.
+ */
+#include <string.h>
+
+#include "mrv_all_bits.h"
+#include "isp_ioctl.h"
+#include "dwe_regs.h"
+#include "sim_regs.h"
+
+#define SIM_REG(reg)	((uint32_t)offsetof(MrvAllRegister_t, reg))
+
+struct sim_mmio_stats sim_isp_mmio;
+struct sim_mmio_stats sim_dwe_mmio;
+
+static uint32_t isp_regs[SIM_ISP_REG_SIZE / 4];
+static uint32_t dwe_regs[REGISTER_NUM];
+static bool isp_gen_cfg_pending;
+
+enum sim_latch {
+	SIM_LATCH_ISP,		/* isp_ctrl cfg_upd, gen_cfg_upd at frame end */
+	SIM_LATCH_MRSZ,		/* mrsz_ctrl cfg_upd */
+	SIM_LATCH_SRSZ,		/* srsz_ctrl cfg_upd */
+	SIM_LATCH_MI,		/* mi_init cfg_upd and every frame end */
+};
+
+struct sim_shadow {
+	uint32_t reg;
+	uint32_t shd;
+	enum sim_latch latch;
+};
+
+#define SIM_SHADOW(reg, latch) \
+	{ SIM_REG(reg), SIM_REG(reg##_shd), latch }
+#define SIM_SHADOW_INIT(reg, latch) \
+	{ SIM_REG(reg##_init), SIM_REG(reg##_shd), latch }
+
+static const struct sim_shadow sim_shadows[] = {
+	SIM_SHADOW(isp_out_h_offs, SIM_LATCH_ISP),
+	SIM_SHADOW(isp_out_v_offs, SIM_LATCH_ISP),
+	SIM_SHADOW(isp_out_h_size, SIM_LATCH_ISP),
+	SIM_SHADOW(isp_out_v_size, SIM_LATCH_ISP),
+	SIM_SHADOW(mrsz_ctrl, SIM_LATCH_MRSZ),
+	SIM_SHADOW(mrsz_scale_hy, SIM_LATCH_MRSZ),
+	SIM_SHADOW(mrsz_scale_hcb, SIM_LATCH_MRSZ),
+	SIM_SHADOW(mrsz_scale_hcr, SIM_LATCH_MRSZ),
+	SIM_SHADOW(mrsz_scale_vy, SIM_LATCH_MRSZ),
+	SIM_SHADOW(mrsz_scale_vc, SIM_LATCH_MRSZ),
+	SIM_SHADOW(srsz_ctrl, SIM_LATCH_SRSZ),
+	SIM_SHADOW(srsz_scale_hy, SIM_LATCH_SRSZ),
+	SIM_SHADOW(srsz_scale_hcb, SIM_LATCH_SRSZ),
+	SIM_SHADOW(srsz_scale_hcr, SIM_LATCH_SRSZ),
+	SIM_SHADOW(srsz_scale_vy, SIM_LATCH_SRSZ),
+	SIM_SHADOW(srsz_scale_vc, SIM_LATCH_SRSZ),
+#ifdef ISP_MIV1
+	SIM_SHADOW(mi_ctrl, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_y_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_y_size, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_cb_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_cb_size, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_cr_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_mp_cr_size, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_y_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_y_size, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_cb_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_cb_size, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_cr_base_ad, SIM_LATCH_MI),
+	SIM_SHADOW_INIT(mi_sp_cr_size, SIM_LATCH_MI),
+#endif
+};
+
+struct sim_irq_block {
+	uint32_t ris, imsc, mis, icr, isr;
+};
+
+#define SIM_IRQ_BLOCK(prefix) { \
+	SIM_REG(prefix##_ris), SIM_REG(prefix##_imsc), SIM_REG(prefix##_mis), \
+	SIM_REG(prefix##_icr), SIM_REG(prefix##_isr) }
+
+static const struct sim_irq_block sim_irq_blocks[] = {
+	SIM_IRQ_BLOCK(isp),
+#ifdef ISP_MIV1
+	SIM_IRQ_BLOCK(mi),
+#elif defined(ISP_MIV2)
+	SIM_IRQ_BLOCK(miv2),
+#endif
+};
+
+static uint32_t *isp_reg(uint32_t offset)
+{
+	return &isp_regs[offset / 4];
+}
+
+static void sim_latch(enum sim_latch latch)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sim_shadows) / sizeof(sim_shadows[0]); i++)
+		if (sim_shadows[i].latch == latch)
+			*isp_reg(sim_shadows[i].shd) = *isp_reg(sim_shadows[i].reg);
+}
+
+static void sim_raise(const struct sim_irq_block *blk, uint32_t bits)
+{
+	*isp_reg(blk->ris) |= bits;
+}
+
+void sim_regs_reset(void)
+{
+	memset(isp_regs, 0, sizeof(isp_regs));
+	memset(dwe_regs, 0, sizeof(dwe_regs));
+	memset(&sim_isp_mmio, 0, sizeof(sim_isp_mmio));
+	memset(&sim_dwe_mmio, 0, sizeof(sim_dwe_mmio));
+	isp_gen_cfg_pending = false;
+}
+
+uint32_t sim_isp_peek(uint32_t offset)
+{
+	return offset < SIM_ISP_REG_SIZE ? *isp_reg(offset) : 0;
+}
+
+void sim_isp_poke(uint32_t offset, uint32_t val)
+{
+	if (offset < SIM_ISP_REG_SIZE)
+		*isp_reg(offset) = val;
+}
+
+void sim_isp_frame_start(void)
+{
+	sim_raise(&sim_irq_blocks[0], MRV_ISP_RIS_V_START_MASK);
+}
+
+void sim_isp_frame_end(void)
+{
+	if (isp_gen_cfg_pending) {
+		sim_latch(SIM_LATCH_ISP);
+		isp_gen_cfg_pending = false;
+	}
+	sim_latch(SIM_LATCH_MI);
+	sim_raise(&sim_irq_blocks[0], MRV_ISP_RIS_FRAME_MASK);
+#if defined(ISP_MIV1) || defined(ISP_MIV2)
+	sim_raise(&sim_irq_blocks[1],
+		  MRV_MI_MP_FRAME_END_MASK | MRV_MI_SP_FRAME_END_MASK);
+#endif
+}
+
+uint32_t HalReadReg(HalHandle_t handle, uint32_t reg)
+{
+	unsigned int i;
+
+	sim_isp_mmio.reads++;
+	if (reg >= SIM_ISP_REG_SIZE)
+		return 0;
+
+	for (i = 0; i < sizeof(sim_irq_blocks) / sizeof(sim_irq_blocks[0]); i++) {
+		const struct sim_irq_block *blk = &sim_irq_blocks[i];
+
+		if (reg == blk->mis)
+			return *isp_reg(blk->ris) & *isp_reg(blk->imsc);
+		if (reg == blk->icr || reg == blk->isr)
+			return 0;
+	}
+#ifdef ISP_MIV1
+	if (reg == SIM_REG(mi_init))
+		return 0;
+#endif
+	return *isp_reg(reg);
+}
+
+void HalWriteReg(HalHandle_t handle, uint32_t reg, uint32_t val)
+{
+	unsigned int i;
+
+	sim_isp_mmio.writes++;
+	if (reg >= SIM_ISP_REG_SIZE)
+		return;
+
+	for (i = 0; i < sizeof(sim_irq_blocks) / sizeof(sim_irq_blocks[0]); i++) {
+		const struct sim_irq_block *blk = &sim_irq_blocks[i];
+
+		if (reg == blk->icr) {
+			*isp_reg(blk->ris) &= ~val;
+			return;
+		}
+		if (reg == blk->isr) {
+			*isp_reg(blk->ris) |= val;
+			return;
+		}
+		if (reg == blk->mis || reg == blk->ris)
+			return;
+	}
+
+	if (reg == SIM_REG(isp_ctrl)) {
+		if (val & MRV_ISP_ISP_CFG_UPD_MASK)
+			sim_latch(SIM_LATCH_ISP);
+		if (val & MRV_ISP_ISP_GEN_CFG_UPD_MASK)
+			isp_gen_cfg_pending = true;
+		val &= ~(MRV_ISP_ISP_CFG_UPD_MASK | MRV_ISP_ISP_GEN_CFG_UPD_MASK);
+	} else if (reg == SIM_REG(mrsz_ctrl)) {
+		if (val & MRV_MRSZ_CFG_UPD_MASK) {
+			*isp_reg(reg) = val & ~MRV_MRSZ_CFG_UPD_MASK;
+			sim_latch(SIM_LATCH_MRSZ);
+			return;
+		}
+	} else if (reg == SIM_REG(srsz_ctrl)) {
+		if (val & MRV_SRSZ_CFG_UPD_MASK) {
+			*isp_reg(reg) = val & ~MRV_SRSZ_CFG_UPD_MASK;
+			sim_latch(SIM_LATCH_SRSZ);
+			return;
+		}
+#ifdef ISP_MIV1
+	} else if (reg == SIM_REG(mi_init)) {
+		if (val & MRV_MI_MI_CFG_UPD_MASK)
+			sim_latch(SIM_LATCH_MI);
+		return;
+#endif
+	}
+	*isp_reg(reg) = val;
+}
+
+void sim_dwe_frame_done(void)
+{
+	dwe_regs[INTERRUPT_STATUS / 4] |= INT_FRAME_DONE;
+}
+
+/* only the dewarp block is modelled, the extended control bar reads 0 */
+static uint32_t *dwe_reg(uint32_t bar)
+{
+	if (bar >= REGISTER_NUM * 4 || (bar & 3))
+		return NULL;
+	return &dwe_regs[bar / 4];
+}
+
+bool sim_dwe_read(uint32_t bar, uint32_t *data)
+{
+	uint32_t *reg = dwe_reg(bar);
+
+	sim_dwe_mmio.reads++;
+	*data = reg ? *reg : 0;
+	return true;
+}
+
+bool sim_dwe_write(uint32_t bar, uint32_t data)
+{
+	uint32_t *reg = dwe_reg(bar);
+
+	sim_dwe_mmio.writes++;
+	if (!reg)
+		return true;
+
+	if (bar == INTERRUPT_STATUS) {
+		/* top byte clears status bits, the status byte is read only */
+		*reg = (*reg & ~(data >> 24) & 0xff) | (data & 0x00ffff00);
+		return true;
+	}
+	*reg = data;
+	return true;
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _SIM_REGS_H_
+#define _SIM_REGS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_ISP_REG_SIZE	0x10000
+
+struct sim_mmio_stats {
+	uint64_t reads;
+	uint64_t writes;
+};
+
+extern struct sim_mmio_stats sim_isp_mmio;
+extern struct sim_mmio_stats sim_dwe_mmio;
+
+/* clear both register files and the counters */
+void sim_regs_reset(void);
+
+/* backdoor access for test setup, not counted */
+uint32_t sim_isp_peek(uint32_t offset);
+void sim_isp_poke(uint32_t offset, uint32_t val);
+
+/*
+ * Hardware events. Start of frame raises v_start, frame end latches the
+ * shadow registers armed by gen_cfg_upd plus the mi shadows and raises
+ * the isp and mi frame end interrupts.
+ */
+void sim_isp_frame_start(void);
+void sim_isp_frame_end(void);
+void sim_dwe_frame_done(void);
+
+/* bar accessors for dwe_set_func() */
+bool sim_dwe_read(uint32_t bar, uint32_t *data);
+bool sim_dwe_write(uint32_t bar, uint32_t data);
+
+#endif /* _SIM_REGS_H_ */
@@ -0,0 +1,59 @@
+#!/bin/bash
+# Capture drop rate with and without network load.
+#
+#   irq_stress.sh <iperf3 server> [seconds] [video node] [isp id]
+#
+# Streams the video node with v4l2-ctl for the given time, once idle and
+# once while iperf3 floods the network in both directions, and prints the
+# frames and drops counted in debugfs (vvcam-isp<N>, vvcam-video<N>) plus
+# the isp irq thread wakeup latency and late frame end commits. Run it once
+# per module setting to compare, e.g. irq_prio=0 against irq_prio=80
+# irq_cpu=3, or irq_dma_update=0 against irq_dma_update=1.
+
+SERVER=$1
+SECS=${2:-60}
+VIDEO=${3:-/dev/video0}
+ISP=${4:-0}
+DBG=/sys/kernel/debug
+
+if [ -z "$SERVER" ]; then
+	echo "usage: $0 <iperf3 server> [seconds] [video node] [isp id]"
+	exit 1
+fi
+
+VNUM=$(cat /sys/class/video4linux/$(basename $VIDEO)/name | sed 's/viv_v4l2//')
+
+stat() {
+	awk -v k=$2 '$1 == k { print $2 }' $DBG/$1/stats
+}
+
+run() {
+	local f0 d0 s0 f1 d1 s1
+
+	f0=$(stat vvcam-video$VNUM frames)
+	s0=$(stat vvcam-video$VNUM skipped)
+	d0=$(stat vvcam-isp$ISP mp_dropped)
+	v4l2-ctl -d $VIDEO --stream-mmap --stream-count=$((SECS * 120)) \
+		--stream-to=/dev/null >/dev/null 2>&1 &
+	local cap=$!
+	sleep $SECS
+	kill $cap 2>/dev/null
+	wait $cap 2>/dev/null
+	f1=$(stat vvcam-video$VNUM frames)
+	s1=$(stat vvcam-video$VNUM skipped)
+	d1=$(stat vvcam-isp$ISP mp_dropped)
+
+	printf "%-8s frames %6u skipped %5u isp dropped %5u\n" $1 \
+		$((f1 - f0)) $((s1 - s0)) $((d1 - d0))
+}
+
+run idle
+
+iperf3 -c $SERVER -t $((SECS + 5)) -P 4 --bidir >/dev/null 2>&1 &
+NET=$!
+sleep 2
+run loaded
+kill $NET 2>/dev/null
+wait 2>/dev/null
+
+grep -E "thread_latency|commit_late" $DBG/vvcam-isp$ISP/stats
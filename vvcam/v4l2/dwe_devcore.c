@@ -50,6 +50,8 @@
  * version of this file.
  *
  *****************************************************************************/
+#include <linux/debugfs.h>
+
 #include "dwe_driver.h"
 #include "dwe_ioctl.h"
 
@@ -134,11 +136,33 @@ static int dwe_core_get_index(struct dwe_ic_dev *dev, struct vb2_dc_buf *buf)
 	return -1;
 }
 
+static int dwe_stats_show(struct seq_file *m, void *unused)
+{
+	struct dwe_perf_stats *perf = m->private;
+	int i;
+
+	for (i = 0; i < MAX_DWE_NUM; ++i) {
+		seq_printf(m, "dwe%d_frames %u\n", i, perf->frames[i]);
+		seq_printf(m, "dwe%d_dropped %u\n", i, perf->dropped[i]);
+	}
+	seq_printf(m, "hw_error %u\n", perf->hw_error);
+	seq_printf(m, "underflow %u\n", perf->underflow);
+	seq_printf(m, "overflow %u\n", perf->overflow);
+	seq_printf(m, "no_dist_map %u\n", perf->no_dist_map);
+	seq_printf(m, "wrong_state %u\n", perf->wrong_state);
+	vvcam_hist_show(m, "isr", &perf->isr);
+	vvcam_hist_show(m, "thread_latency", &perf->thread_lat);
+	vvcam_hist_show(m, "thread", &perf->thread);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dwe_stats);
+
 struct dwe_devcore *dwe_devcore_init(struct dwe_device *dwe,
 				struct resource *res)
 {
 	struct dwe_devcore *core, *found = NULL;
 	unsigned long flags;
+	char name[32];
 	int rc;
 
 	spin_lock_irqsave(&devcore_list_lock, flags);
@@ -165,11 +189,18 @@ struct dwe_devcore *dwe_devcore_init(struct dwe_device *dwe,
 	if (!core)
 		return NULL;
 
+#ifdef VVCAM_SIM
+	if (dwe_sim_init(core)) {
+		dwe_sim_deinit(core);
+		goto end;
+	}
+#else
 	core->ic_dev.base = devm_ioremap_resource(dwe->sd.dev, res);
 	if (IS_ERR(core->ic_dev.base)) {
 		pr_err("failed to get ioremap resource.\n");
 		goto end;
 	}
+#endif
 	core->start = res->start;
 	core->end = res->end;
 
@@ -191,11 +222,15 @@ struct dwe_devcore *dwe_devcore_init(struct dwe_device *dwe,
 	core->ic_dev.state[dwe->id] = &dwe->state;
 	core->ic_dev.get_index = dwe_core_get_index;
 
-	tasklet_init(&core->ic_dev.tasklet, dwe_isr_tasklet, (unsigned long)(&core->ic_dev));
-
 	mutex_init(&core->mutex);
 	refcount_set(&core->refcount, 1);
 
+	/* one tree per dewarp core, shared by the dwe nodes it serves */
+	snprintf(name, sizeof(name), "vvcam-dwe@%llx", (u64)res->start);
+	core->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, core->debugfs,
+			&core->ic_dev.perf, &dwe_stats_fops);
+
 	spin_lock_irqsave(&devcore_list_lock, flags);
 	list_add_tail(&core->entry, &devcore_list);
 	spin_unlock_irqrestore(&devcore_list_lock, flags);
@@ -215,7 +250,7 @@ void dwe_devcore_deinit(struct dwe_device *dwe)
 		return;
 
 	if (refcount_dec_and_test(&core->refcount)) {
-		tasklet_kill(&core->ic_dev.tasklet);
+		debugfs_remove_recursive(core->debugfs);
 		spin_lock_irqsave(&devcore_list_lock, flags);
 		list_del(&core->entry);
 		spin_unlock_irqrestore(&devcore_list_lock, flags);
@@ -223,6 +258,9 @@ void dwe_devcore_deinit(struct dwe_device *dwe)
 
 #ifdef DWE_REG_RESET
 		iounmap(core->ic_dev.reset);
+#endif
+#ifdef VVCAM_SIM
+		dwe_sim_deinit(core);
 #endif
 		mutex_destroy(&core->mutex);
 		kfree(core);
@@ -56,6 +56,10 @@
 #include "dwe_dev.h"
 #include "video/vvbuf.h"
 
+#ifdef VVCAM_SIM
+#include <linux/hrtimer.h>
+#endif
+
 #ifdef ENABLE_IRQ
 struct dwe_devcore {
 	struct vvbuf_ctx bctx[DWE_PADS_NUM];
@@ -69,6 +73,10 @@ struct dwe_devcore {
 	int (*match)(struct dwe_devcore *core, struct resource *res);
 	int irq;
 	struct list_head entry;
+	struct dentry *debugfs;
+#ifdef VVCAM_SIM
+	struct hrtimer sim_timer;
+#endif
 };
 #endif
 
@@ -98,4 +106,13 @@ struct dwe_devcore *dwe_devcore_init(struct dwe_device *dwe,
 void dwe_devcore_deinit(struct dwe_device *dwe);
 long dwe_devcore_ioctl(struct dwe_device *dwe, unsigned int cmd, void *args);
 #endif
+
+#ifdef VVCAM_SIM
+int dwe_sim_init(struct dwe_devcore *core);
+void dwe_sim_deinit(struct dwe_devcore *core);
+void dwe_sim_start(struct dwe_devcore *core);
+void dwe_sim_stop(struct dwe_devcore *core);
+int dwe_sim_register(void);
+void dwe_sim_unregister(void);
+#endif
 #endif /* _DWE_DRIVER_H_ */
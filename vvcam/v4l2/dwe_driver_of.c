@@ -56,11 +56,27 @@
 
 #include "dwe_driver.h"
 #include "dwe_ioctl.h"
+#include "vvcam_irq.h"
+#ifdef VVCAM_SIM
+#include "dwe_regs.h"
+#endif
+
+#define VVCAM_TRACE_SYSTEM vvcam_dwe
+#define CREATE_TRACE_POINTS
+#include "vvcam_trace.h"
 
 #define DEWARP_NODE_NUM  (2)
 
 static struct dwe_device *pdwe_dev[DEWARP_NODE_NUM] = {NULL};
 
+static int irq_prio;
+module_param(irq_prio, int, 0444);
+MODULE_PARM_DESC(irq_prio, "SCHED_FIFO priority of the dwe irq thread, 0 keeps the kernel default");
+
+static int irq_cpu = -1;
+module_param(irq_cpu, int, 0444);
+MODULE_PARM_DESC(irq_cpu, "cpu the dwe irq and its thread run on, -1 leaves the affinity alone");
+
 int dwe_subscribe_event(struct v4l2_subdev *sd, struct v4l2_fh *fh,
 			struct v4l2_event_subscription *sub)
 {
@@ -138,7 +154,6 @@ int dwe_set_stream(struct v4l2_subdev *sd, int enable)
 	struct dwe_device *dwe_dev = v4l2_get_subdevdata(sd);
 	struct vvbuf_ctx *ctx;
 	struct media_pad *pad;
-	unsigned long flags;
 
 	if (!enable)
 		dwe_dev->state &= ~STATE_STREAM_STARTED;
@@ -155,10 +170,7 @@ int dwe_set_stream(struct v4l2_subdev *sd, int enable)
 
 	if (!enable) {
 		ctx = &dwe_dev->bctx[DWE_PAD_SOURCE];
-		spin_lock_irqsave(&ctx->irqlock, flags);
-		if (!list_empty(&ctx->dmaqueue))
-			list_del_init(&ctx->dmaqueue);
-		spin_unlock_irqrestore(&ctx->irqlock, flags);
+		vvbuf_ctx_flush(ctx);
 	}
 	return 0;
 }
@@ -209,7 +221,12 @@ static void dwe_src_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 	if ((dwe->core->ic_dev.hardware_status == HARDWARE_IDLE) &&
 	    (dwe->state == (STATE_DRIVER_STARTED | STATE_STREAM_STARTED))) {
 		dwe->core->ic_dev.hardware_status = HARDWARE_BUSY;
-		tasklet_schedule(&dwe->core->ic_dev.tasklet);
+		vvcam_hist_mark(&dwe->core->ic_dev.perf.thread_ts);
+#ifdef VVCAM_SIM
+		dwe_irq_thread(dwe->core->irq, &dwe->core->ic_dev);
+#else
+		irq_wake_thread(dwe->core->irq, &dwe->core->ic_dev);
+#endif
 	}
 }
 
@@ -262,13 +279,20 @@ static int dwe_open(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	if ((pdwe_dev[0]->refcnt + pdwe_dev[1]->refcnt) == 0) {
 		msleep(1);
 		dwe_clear_interrupts(&pdwe_dev[0]->core->ic_dev);
-		if (devm_request_irq(pdwe_dev[0]->sd.dev, pdwe_dev[0]->irq, dwe_hw_isr, IRQF_SHARED,
+#ifdef VVCAM_SIM
+		dwe_sim_start(pdwe_dev[0]->core);
+#else
+		pdwe_dev[0]->core->ic_dev.irq_prio = irq_prio;
+		if (devm_request_threaded_irq(pdwe_dev[0]->sd.dev, pdwe_dev[0]->irq,
+					dwe_hw_isr, dwe_irq_thread, IRQF_SHARED,
 					dev_name(pdwe_dev[0]->sd.dev), &pdwe_dev[0]->core->ic_dev) != 0) {
 			pr_err("failed to request irq.\n");
 			pm_runtime_put_sync(pdwe_dev[0]->sd.dev);
 			ret = -1;
 			goto unlock;
 		}
+		vvcam_irq_set_cpu(pdwe_dev[0]->irq, irq_cpu);
+#endif
 	}
 
 unlock:
@@ -282,7 +306,6 @@ static int dwe_close(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 {
 	struct dwe_device *dwe_dev = v4l2_get_subdevdata(sd);
 	struct vvbuf_ctx *ctx;
-	unsigned long flags;
 
 	if (dwe_dev->refcnt == 0)
 		return 0;
@@ -293,15 +316,16 @@ static int dwe_close(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		dwe_dev->state = 0;
 		msleep(10);
 		ctx = &dwe_dev->bctx[DWE_PAD_SOURCE];
-		spin_lock_irqsave(&ctx->irqlock, flags);
-		if (!list_empty(&ctx->dmaqueue))
-			list_del_init(&ctx->dmaqueue);
-		spin_unlock_irqrestore(&ctx->irqlock, flags);
+		vvbuf_ctx_flush(ctx);
 	}
 	if (((pdwe_dev[0]->refcnt) != 0) || ((pdwe_dev[1]->refcnt) != 0)) {
 		goto exit;
 	}
+#ifdef VVCAM_SIM
+	dwe_sim_stop(pdwe_dev[0]->core);
+#else
 	devm_free_irq(pdwe_dev[0]->sd.dev, pdwe_dev[0]->irq, &pdwe_dev[0]->core->ic_dev);
+#endif
 	dwe_clear_interrupts(&pdwe_dev[0]->core->ic_dev);
 	pdwe_dev[0]->core->state = 0;
 
@@ -319,9 +343,15 @@ static struct v4l2_subdev_internal_ops dwe_internal_ops = {
 	.close = dwe_close,
 };
 
+#ifdef VVCAM_SIM
+static struct resource dwe_sim_res = DEFINE_RES_MEM(0, REGISTER_NUM * 4);
+#endif
+
 int dwe_hw_probe(struct platform_device *pdev)
 {
+#ifndef VVCAM_SIM
 	struct device *dev = &pdev->dev;
+#endif
 	struct dwe_device *dwe_dev;
 	struct resource *mem_res;
 	int irq;
@@ -330,6 +360,11 @@ int dwe_hw_probe(struct platform_device *pdev)
 
 	pr_info("enter %s\n", __func__);
 
+#ifdef VVCAM_SIM
+	/* only identifies the core, the registers are allocated */
+	mem_res = &dwe_sim_res;
+	irq = 0;
+#else
 	mem_res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	if (!mem_res) {
 		pr_err("can't fetch device resource info\n");
@@ -341,6 +376,7 @@ int dwe_hw_probe(struct platform_device *pdev)
 		pr_err("failed to get irq number.\n");
 		return -ENODEV;
 	}
+#endif
 
 	rc = dwe_fake_pdev_creat();
 	if (rc < 0) {
@@ -363,6 +399,7 @@ int dwe_hw_probe(struct platform_device *pdev)
 
 		dwe_dev = pdwe_dev[dev_id];
 		dwe_dev->id = dev_id;
+#ifndef VVCAM_SIM
 		if (dev_id == 0){
 			dwe_dev->clk_core = devm_clk_get(dev, "core");
 			if (IS_ERR(dwe_dev->clk_core)) {
@@ -385,6 +422,7 @@ int dwe_hw_probe(struct platform_device *pdev)
 				return rc;
 			}
 		}
+#endif
 		dwe_dev->sd.internal_ops = &dwe_internal_ops;
 		v4l2_subdev_init(&dwe_dev->sd, &dwe_v4l2_subdev_ops);
 		snprintf(dwe_dev->sd.name, sizeof(dwe_dev->sd.name),
@@ -545,12 +583,20 @@ static int __init viv_dwe_init_module(void)
 		pr_err("register platform driver failed.\n");
 		return ret;
 	}
+#ifdef VVCAM_SIM
+	ret = dwe_sim_register();
+	if (ret)
+		platform_driver_unregister(&viv_dwe_driver);
+#endif
 	return ret;
 }
 
 static void __exit viv_dwe_exit_module(void)
 {
 	pr_info("enter %s\n", __func__);
+#ifdef VVCAM_SIM
+	dwe_sim_unregister();
+#endif
 	platform_driver_unregister(&viv_dwe_driver);
 }
 
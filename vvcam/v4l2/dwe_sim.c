@@ -0,0 +1,169 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/hrtimer.h>
+#include <linux/version.h>
+
+#include "dwe_driver.h"
+#include "dwe_ioctl.h"
+#include "dwe_regs.h"
+
+/*
+ * Hardware-free dewarp for VVCAM_SIM builds.  The registers live in
+ * memory and an hrtimer polls for a started job: once the irq thread has
+ * enabled the bus with a source and destination in place, the source is
+ * copied through unchanged and INT_FRAME_DONE is raised via dwe_hw_isr().
+ */
+
+static unsigned int sim_dwe_us = 1000;
+module_param(sim_dwe_us, uint, 0644);
+MODULE_PARM_DESC(sim_dwe_us, "processing time of one simulated dewarp job");
+
+static struct platform_device *dwe_sim_pdev;
+
+static void dwe_sim_copy(struct vb2_dc_buf *src, struct vb2_dc_buf *dst)
+{
+	struct vb2_buffer *vb_src = &src->vb.vb2_buf;
+	struct vb2_buffer *vb_dst = &dst->vb.vb2_buf;
+	void *vsrc, *vdst;
+
+	if (!vb_src->vb2_queue || !vb_dst->vb2_queue)
+		return;
+	vsrc = vb2_plane_vaddr(vb_src, 0);
+	vdst = vb2_plane_vaddr(vb_dst, 0);
+	if (vsrc && vdst)
+		memcpy(vdst, vsrc, min(vb2_plane_size(vb_src, 0),
+				       vb2_plane_size(vb_dst, 0)));
+}
+
+static enum hrtimer_restart dwe_sim_poll(struct hrtimer *timer)
+{
+	struct dwe_devcore *core =
+			container_of(timer, struct dwe_devcore, sim_timer);
+	struct dwe_ic_dev *dev = &core->ic_dev;
+	bool done = false;
+
+	spin_lock(&dev->irqlock);
+	if ((__raw_readl(dev->base + BUS_CTRL) & DEWRAP_BUS_CTRL_ENABLE_MASK) &&
+	    dev->src && dev->dst) {
+		dwe_sim_copy(dev->src, dev->dst);
+		done = true;
+	}
+	spin_unlock(&dev->irqlock);
+
+	if (done) {
+		__raw_writel(INT_FRAME_DONE, dev->base + INTERRUPT_STATUS);
+		if (dwe_hw_isr(core->irq, dev) == IRQ_WAKE_THREAD)
+			dwe_irq_thread(core->irq, dev);
+		__raw_writel(0, dev->base + INTERRUPT_STATUS);
+	}
+
+	hrtimer_forward_now(timer, ns_to_ktime(
+			max_t(u64, sim_dwe_us, 1) * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+int dwe_sim_init(struct dwe_devcore *core)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&core->sim_timer, dwe_sim_poll, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL);
+#else
+	hrtimer_init(&core->sim_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	core->sim_timer.function = dwe_sim_poll;
+#endif
+
+	core->ic_dev.base = (void __iomem *)kzalloc(REGISTER_NUM * 4,
+						    GFP_KERNEL);
+	if (!core->ic_dev.base)
+		return -ENOMEM;
+	return 0;
+}
+
+void dwe_sim_deinit(struct dwe_devcore *core)
+{
+	hrtimer_cancel(&core->sim_timer);
+	kfree((void __force *)core->ic_dev.base);
+	core->ic_dev.base = NULL;
+}
+
+void dwe_sim_start(struct dwe_devcore *core)
+{
+	hrtimer_start(&core->sim_timer, ns_to_ktime(
+			max_t(u64, sim_dwe_us, 1) * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+}
+
+void dwe_sim_stop(struct dwe_devcore *core)
+{
+	hrtimer_cancel(&core->sim_timer);
+}
+
+int dwe_sim_register(void)
+{
+	dwe_sim_pdev = platform_device_register_simple(DWE_DEVICE_NAME, 0,
+			NULL, 0);
+	if (IS_ERR(dwe_sim_pdev)) {
+		pr_err("failed to register the simulated dwe device\n");
+		return PTR_ERR(dwe_sim_pdev);
+	}
+	return 0;
+}
+
+void dwe_sim_unregister(void)
+{
+	if (!IS_ERR_OR_NULL(dwe_sim_pdev))
+		platform_device_unregister(dwe_sim_pdev);
+	dwe_sim_pdev = NULL;
+}
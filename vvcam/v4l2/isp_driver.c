@@ -226,22 +226,6 @@ irqreturn_t isp_hw_isr_reg_update(int irq, void *data)
 	if (isp_mis) {
 		if (isp_mis & MRV_ISP_MIS_FRAME_MASK) {
 			awb_set_gain(dev);
-			if (dev->flt.changed) {
-				isp_s_flt(dev);
-			}
-
-			if (dev->wdr.changed) {
-				isp_s_wdr(dev);
-			}
-
-			if (dev->cproc.changed) {
-				isp_s_cproc(dev);
-			}
-
-			if (dev->gamma_out.changed) {
-				isp_s_gamma_out(dev);
-			}
-
 			if(dev->update_gamma_en) {
 				isp_ctrl = isp_read_reg(dev, REG_ADDR(isp_ctrl));
 				REG_SET_SLICE(isp_ctrl, MRV_ISP_ISP_GAMMA_OUT_ENABLE,
@@ -249,6 +233,7 @@ irqreturn_t isp_hw_isr_reg_update(int irq, void *data)
 				isp_write_reg(dev, REG_ADDR(isp_ctrl), isp_ctrl);
 				dev->update_gamma_en = false;
 			}
+			isp_commit_dirty(dev);
 
 		}
 
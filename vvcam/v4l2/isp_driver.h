@@ -56,8 +56,12 @@
 #include "ic_dev.h"
 #include "video/vvbuf.h"
 
+#ifdef VVCAM_SIM
+#include <linux/hrtimer.h>
+#endif
+
 struct isp_device {
-	struct vvbuf_ctx bctx;
+	struct vvbuf_ctx bctx[ISP_PADS_NUM];
 	/* Driver private data */
 	struct v4l2_subdev sd;
 #ifndef ENABLE_IRQ
@@ -71,12 +75,28 @@ struct isp_device {
 	int refcnt;
 #ifdef ENABLE_IRQ
 	struct media_pad pads[ISP_PADS_NUM];
+	struct v4l2_mbus_framefmt sp_fmt;	/* under mlock */
 	int state;
+	struct dentry *debugfs;
 #endif
 	int irq;
 
 	int id;
 	struct mutex mlock;
+#ifdef VVCAM_SIM
+	struct hrtimer sim_timer;
+	u32 sim_frame;
+	bool sim_vblank;
+#endif
 };
 
+#ifdef VVCAM_SIM
+int isp_sim_init(struct isp_device *isp_dev);
+void isp_sim_deinit(struct isp_device *isp_dev);
+void isp_sim_start(struct isp_device *isp_dev);
+void isp_sim_stop(struct isp_device *isp_dev);
+int isp_sim_register(void);
+void isp_sim_unregister(void);
+#endif
+
 #endif /* _ISP_DRIVER_H_ */
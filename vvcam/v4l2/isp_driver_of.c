@@ -51,21 +51,57 @@
  *
  *****************************************************************************/
 #include <linux/module.h>
+#include <linux/mm.h>
 #include <linux/pm_runtime.h>
+#include <linux/debugfs.h>
 #include <media/v4l2-event.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
 #include <linux/of_reserved_mem.h>
+#include <linux/version.h>
 
 #include "isp_driver.h"
 #include "isp_ioctl.h"
 #include "mrv_all_bits.h"
 #include "viv_video_kevent.h"
+#include "vvcam_irq.h"
+
+#define VVCAM_TRACE_SYSTEM vvcam_isp
+#define CREATE_TRACE_POINTS
+#include "vvcam_trace.h"
 
 struct clk *clk_isp;
 
 extern MrvAllRegister_t *all_regs;
 
+static unsigned int bufring;
+module_param(bufring, uint, 0444);
+MODULE_PARM_DESC(bufring, "buffer ring depth for the isp queue, frame ends take buffers without its lock; 0 uses the locked list");
+
+static bool scratch = true;
+module_param(scratch, bool, 0444);
+MODULE_PARM_DESC(scratch, "drop frames into a scratch buffer when no capture buffer is queued");
+
+static unsigned int mi_depth = 2;
+module_param(mi_depth, uint, 0444);
+MODULE_PARM_DESC(mi_depth, "buffers held per mi path, above 2 the frame end reprograms from the hard irq; keep more than mi_depth buffers queued per path or the reserve never fills");
+
+static bool irq_dma_update;
+module_param(irq_dma_update, bool, 0444);
+MODULE_PARM_DESC(irq_dma_update, "program the next mi buffer in the frame end hard irq at any mi_depth, the irq thread only retries paths that ran dry");
+
+static int irq_prio;
+module_param(irq_prio, int, 0444);
+MODULE_PARM_DESC(irq_prio, "SCHED_FIFO priority of the isp irq thread, 0 keeps the kernel default");
+
+static int irq_cpu = -1;
+module_param(irq_cpu, int, 0444);
+MODULE_PARM_DESC(irq_cpu, "cpu the isp irq and its thread run on, -1 leaves the affinity alone");
+
+static bool reg_shadow;
+module_param(reg_shadow, bool, 0444);
+MODULE_PARM_DESC(reg_shadow, "serve reads of driver owned control registers from a shadow copy");
+
 #ifdef CONFIG_COMPAT
 static long isp_ioctl_compat(struct v4l2_subdev *sd,
 			     unsigned int cmd, void *arg)
@@ -141,12 +177,19 @@ static void isp_disable_clocks(struct isp_device *isp_dev)
 int isp_set_stream(struct v4l2_subdev *sd, int enable)
 {
 	struct isp_device *isp_dev = v4l2_get_subdevdata(sd);
+	unsigned long flags;
 	pr_info("enter %s %d\n", __func__, enable);
 
 	if (!enable) {
 		isp_dev->state &= ~STATE_STREAM_STARTED;
-	} else
+	} else {
+		/* buffer sequence numbers count from 0 on every stream on */
+		spin_lock_irqsave(&isp_dev->ic_dev.lock, flags);
+		isp_dev->ic_dev.sof_count = 0;
+		isp_dev->ic_dev.mi_end_sof = 0;
+		spin_unlock_irqrestore(&isp_dev->ic_dev.lock, flags);
 		isp_dev->state |= STATE_STREAM_STARTED;
+	}
 	return 0;
 }
 
@@ -208,9 +251,192 @@ static struct v4l2_subdev_video_ops isp_v4l2_subdev_video_ops = {
 	.s_stream = isp_set_stream,
 };
 
+/*
+ * The self path node sets its output on the sp pad before it streams and
+ * a zero sized format when it stops.  The memory layout travels in the
+ * code: YUYV8_1_5X8 is NV12, YUYV8_2X8 is NV16, YUYV8_1X16 is YUYV,
+ * RGB888_1X24 is packed and RGB888_3X8 planar RGB.
+ */
+static const u32 isp_sp_codes[] = {
+	MEDIA_BUS_FMT_YUYV8_1_5X8,
+	MEDIA_BUS_FMT_YUYV8_2X8,
+	MEDIA_BUS_FMT_YUYV8_1X16,
+	MEDIA_BUS_FMT_RGB888_1X24,
+#ifdef ISP_MIV2
+	/* the miv1 self path writes rgb interleaved only */
+	MEDIA_BUS_FMT_RGB888_3X8,
+#else
+	/* 4:0:0 goes through the jpeg path on miv2, main path only */
+	MEDIA_BUS_FMT_Y8_1X8,
+#endif
+};
+
+static int isp_sp_fmt_to_path(const struct v4l2_mbus_framefmt *fmt,
+		struct isp_mi_data_path_context *path)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(isp_sp_codes); ++i)
+		if (isp_sp_codes[i] == fmt->code)
+			break;
+	if (i == ARRAY_SIZE(isp_sp_codes))
+		return -EINVAL;
+
+	memset(path, 0, sizeof(*path));
+	/* the self resizer hands on 4:2:2, or 4:2:0 for NV12, and the mi
+	 * converts that to rgb */
+	path->in_mode = IC_MI_DATAMODE_YUV422;
+	switch (fmt->code) {
+	case MEDIA_BUS_FMT_YUYV8_1_5X8:
+		path->out_mode = IC_MI_DATAMODE_YUV420;
+		path->in_mode = IC_MI_DATAMODE_YUV420;
+		path->data_layout = IC_MI_DATASTORAGE_SEMIPLANAR;
+		break;
+	case MEDIA_BUS_FMT_YUYV8_2X8:
+		path->out_mode = IC_MI_DATAMODE_YUV422;
+		path->data_layout = IC_MI_DATASTORAGE_SEMIPLANAR;
+		break;
+	case MEDIA_BUS_FMT_YUYV8_1X16:
+		path->out_mode = IC_MI_DATAMODE_YUV422;
+		path->data_layout = IC_MI_DATASTORAGE_INTERLEAVED;
+		break;
+	case MEDIA_BUS_FMT_RGB888_1X24:
+		path->out_mode = IC_MI_DATAMODE_RGB888;
+		path->data_layout = IC_MI_DATASTORAGE_INTERLEAVED;
+		break;
+	case MEDIA_BUS_FMT_RGB888_3X8:
+		path->out_mode = IC_MI_DATAMODE_RGB888;
+		path->data_layout = IC_MI_DATASTORAGE_PLANAR;
+		break;
+	case MEDIA_BUS_FMT_Y8_1X8:
+		path->out_mode = IC_MI_DATAMODE_YUV400;
+		path->data_layout = IC_MI_DATASTORAGE_PLANAR;
+		break;
+	}
+	path->out_width = fmt->width;
+	path->out_height = fmt->height;
+	path->enable = true;
+	return 0;
+}
+
+#ifdef ISP_MIV2
+/* bayer the main path stores packed, the miv1 main path only writes
+ * raw10/12 in 16 bit containers and lists none */
+static const u32 isp_packed_codes[] = {
+	MEDIA_BUS_FMT_SBGGR10_1X10,
+	MEDIA_BUS_FMT_SGBRG10_1X10,
+	MEDIA_BUS_FMT_SGRBG10_1X10,
+	MEDIA_BUS_FMT_SRGGB10_1X10,
+	MEDIA_BUS_FMT_SBGGR12_1X12,
+	MEDIA_BUS_FMT_SGBRG12_1X12,
+	MEDIA_BUS_FMT_SGRBG12_1X12,
+	MEDIA_BUS_FMT_SRGGB12_1X12,
+};
+#endif
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int isp_enum_mbus_code(struct v4l2_subdev *sd,
+		struct v4l2_subdev_state *state,
+		struct v4l2_subdev_mbus_code_enum *code)
+#else
+static int isp_enum_mbus_code(struct v4l2_subdev *sd,
+		struct v4l2_subdev_pad_config *cfg,
+		struct v4l2_subdev_mbus_code_enum *code)
+#endif
+{
+#ifdef ISP_MIV2
+	if (code->pad == ISP_PAD_SOURCE) {
+		if (code->index >= ARRAY_SIZE(isp_packed_codes))
+			return -EINVAL;
+		code->code = isp_packed_codes[code->index];
+		return 0;
+	}
+#endif
+	if (code->pad != ISP_PAD_SOURCE_SP ||
+	    code->index >= ARRAY_SIZE(isp_sp_codes))
+		return -EINVAL;
+
+	code->code = isp_sp_codes[code->index];
+	return 0;
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int isp_get_fmt(struct v4l2_subdev *sd,
+		struct v4l2_subdev_state *state,
+		struct v4l2_subdev_format *fmt)
+#else
+static int isp_get_fmt(struct v4l2_subdev *sd,
+		struct v4l2_subdev_pad_config *cfg,
+		struct v4l2_subdev_format *fmt)
+#endif
+{
+	struct isp_device *isp_dev = v4l2_get_subdevdata(sd);
+
+	if (fmt->pad != ISP_PAD_SOURCE_SP)
+		return -EINVAL;
+
+	mutex_lock(&isp_dev->mlock);
+	fmt->format = isp_dev->sp_fmt;
+	mutex_unlock(&isp_dev->mlock);
+	return 0;
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int isp_set_fmt(struct v4l2_subdev *sd,
+		struct v4l2_subdev_state *state,
+		struct v4l2_subdev_format *fmt)
+#else
+static int isp_set_fmt(struct v4l2_subdev *sd,
+		struct v4l2_subdev_pad_config *cfg,
+		struct v4l2_subdev_format *fmt)
+#endif
+{
+	struct isp_device *isp_dev = v4l2_get_subdevdata(sd);
+	struct isp_ic_dev *dev = &isp_dev->ic_dev;
+	struct isp_mi_data_path_context path;
+	unsigned long flags;
+	int rc = 0;
+
+	if (fmt->pad != ISP_PAD_SOURCE_SP)
+		return -EINVAL;
+	if (fmt->which != V4L2_SUBDEV_FORMAT_ACTIVE)
+		return 0;
+
+	mutex_lock(&isp_dev->mlock);
+	if (!fmt->format.width || !fmt->format.height) {
+		isp_mi_release_sp(dev);
+		memset(&isp_dev->sp_fmt, 0, sizeof(isp_dev->sp_fmt));
+		goto end;
+	}
+
+	/* the mi picks the request up at its next start */
+	if (isp_dev->state & STATE_DRIVER_STARTED) {
+		rc = -EBUSY;
+		goto end;
+	}
+	rc = isp_sp_fmt_to_path(&fmt->format, &path);
+	if (rc)
+		goto end;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	dev->sp_req = path;
+	spin_unlock_irqrestore(&dev->lock, flags);
+	isp_dev->sp_fmt = fmt->format;
+end:
+	mutex_unlock(&isp_dev->mlock);
+	return rc;
+}
+
+static const struct v4l2_subdev_pad_ops isp_v4l2_subdev_pad_ops = {
+	.enum_mbus_code = isp_enum_mbus_code,
+	.get_fmt = isp_get_fmt,
+	.set_fmt = isp_set_fmt,
+};
+
 struct v4l2_subdev_ops isp_v4l2_subdev_ops = {
 	.core = &isp_v4l2_subdev_core_ops,
 	.video = &isp_v4l2_subdev_video_ops,
+	.pad = &isp_v4l2_subdev_pad_ops,
 };
 
 static int isp_link_setup(struct media_entity *entity,
@@ -237,7 +463,8 @@ static void isp_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 		isp_dev->ic_dev.free(&isp_dev->ic_dev, buf);
 		return;
 	}
-	vvbuf_push_buf(ctx,buf);
+	if (vvbuf_push_buf(ctx, buf))
+		isp_dev->ic_dev.free(&isp_dev->ic_dev, buf);
 	return;
 }
 
@@ -245,17 +472,61 @@ static const struct vvbuf_ops isp_buf_ops = {
 	.notify = isp_buf_notify,
 };
 
+/* the meta node stops streaming, see isp_meta_release() */
+static void isp_meta_buf_release(struct vvbuf_ctx *ctx, struct media_pad *pad)
+{
+	struct v4l2_subdev *sd = media_entity_to_v4l2_subdev(pad->entity);
+	struct isp_device *isp_dev = container_of(sd, struct isp_device, sd);
+
+	isp_meta_release(&isp_dev->ic_dev, ctx);
+}
+
+/* the stats ring, read-only: userspace only ever follows ring->head */
+static int isp_meta_buf_mmap(struct vvbuf_ctx *ctx, struct media_pad *pad,
+		struct vm_area_struct *vma)
+{
+	struct v4l2_subdev *sd = media_entity_to_v4l2_subdev(pad->entity);
+	struct isp_device *isp_dev = container_of(sd, struct isp_device, sd);
+	struct isp_ic_dev *dev = &isp_dev->ic_dev;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (pad->index != ISP_PAD_STATS || !dev->stats_ring)
+		return -ENODEV;
+	if (size > PAGE_ALIGN(sizeof(struct isp_stats_ring)))
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+	return remap_pfn_range(vma, vma->vm_start,
+			dev->stats_ring_phys >> PAGE_SHIFT, size,
+			vma->vm_page_prot);
+}
+
+static const struct vvbuf_ops isp_meta_buf_ops = {
+	.notify = isp_buf_notify,
+	.release = isp_meta_buf_release,
+	.mmap = isp_meta_buf_mmap,
+};
+
 static int isp_buf_alloc(struct isp_ic_dev *dev, struct isp_buffer_context *buf)
 {
 	struct isp_device *isp_dev;
 	struct media_pad *remote_pad;
 	struct vb2_dc_buf *buff;
+	struct vvbuf_ctx *ctx;
+	int pad;
 
-	if (!dev || !buf)
+	if (!dev || !buf || buf->path >= MI_PATH_NUM)
 		return -EINVAL;
 
 	isp_dev = container_of(dev, struct isp_device, ic_dev);
-	remote_pad = media_entity_remote_pad(&isp_dev->pads[ISP_PAD_SOURCE]);
+	ctx = dev->bctx[buf->path];
+	pad = ctx == dev->sp_bctx ? ISP_PAD_SOURCE_SP : ISP_PAD_SOURCE;
+	remote_pad = media_entity_remote_pad(&isp_dev->pads[pad]);
 	if (remote_pad) {
 		if (is_media_entity_v4l2_video_device(remote_pad->entity)) {
 			// isp connect to video, so no need allo buf for isp
@@ -267,14 +538,17 @@ static int isp_buf_alloc(struct isp_ic_dev *dev, struct isp_buffer_context *buf)
 	if (!buff)
 		return -ENOMEM;
 
-	buff->pad = &isp_dev->pads[ISP_PAD_SOURCE];
+	buff->pad = &isp_dev->pads[pad];
 #ifdef ISP_MP_34BIT
 	buff->dma = buf->addr_y << 2;
 #else
 	buff->dma = buf->addr_y;
 #endif
 	buff->flags = 1;
-	vvbuf_push_buf(&isp_dev->bctx, buff);
+	if (vvbuf_push_buf(ctx, buff)) {
+		kfree(buff);
+		return -ENOSPC;
+	}
 
 	return 0;
 }
@@ -296,7 +570,11 @@ static int isp_open(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	if (isp_dev->refcnt == 1) {
 		msleep(1);
 		isp_clear_interrupts(&isp_dev->ic_dev);
-		if (devm_request_irq(sd->dev, isp_dev->irq, isp_hw_isr, IRQF_SHARED,
+#ifdef VVCAM_SIM
+		isp_sim_start(isp_dev);
+#else
+		if (devm_request_threaded_irq(sd->dev, isp_dev->irq, isp_hw_isr,
+			isp_irq_thread, IRQF_SHARED,
 			dev_name(sd->dev), &isp_dev->ic_dev) != 0) {
 			pr_err("failed to request irq.\n");
 			isp_dev->refcnt = 0;
@@ -304,6 +582,8 @@ static int isp_open(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 			mutex_unlock(&isp_dev->mlock);
 			return -1;
 		}
+		vvcam_irq_set_cpu(isp_dev->irq, irq_cpu);
+#endif
 	}
 	mutex_unlock(&isp_dev->mlock);
 	return 0;
@@ -322,7 +602,11 @@ static int isp_close(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		if (isp_dev->state & STATE_DRIVER_STARTED)
 			isp_mi_stop(&isp_dev->ic_dev);
 		isp_dev->state = STATE_STOPPED;
+#ifdef VVCAM_SIM
+		isp_sim_stop(isp_dev);
+#else
 		devm_free_irq(sd->dev, isp_dev->irq, &isp_dev->ic_dev);
+#endif
 		isp_priv_ioctl(&isp_dev->ic_dev, ISPIOC_RESET, NULL);
 		isp_clear_interrupts(&isp_dev->ic_dev);
 		msleep(5);
@@ -339,12 +623,41 @@ static struct v4l2_subdev_internal_ops isp_internal_ops = {
 	.close = isp_close,
 };
 
+static int isp_stats_show(struct seq_file *m, void *unused)
+{
+	static const char * const path_name[] = { "mp", "sp", "sp2" };
+	struct isp_ic_dev *dev = m->private;
+	struct isp_perf_stats *perf = &dev->perf;
+	int i;
+
+	seq_printf(m, "mi_depth %u\n", dev->mi_depth);
+	seq_printf(m, "irq_dma_update %u\n", dev->irq_dma_update);
+	for (i = 0; i < MI_PATH_NUM; ++i) {
+		seq_printf(m, "%s_frames %u\n", path_name[i], perf->frames[i]);
+		seq_printf(m, "%s_dropped %u\n", path_name[i], perf->dropped[i]);
+		seq_printf(m, "%s_scratch %u\n", path_name[i], perf->scratch[i]);
+	}
+	seq_printf(m, "mi_fifo_full %u\n", perf->fifo_full);
+	seq_printf(m, "mi_wrap %u\n", perf->wrap);
+	seq_printf(m, "mi_fill %u\n", perf->fill);
+	seq_printf(m, "commit_late %u\n", perf->commit_late);
+	vvcam_hist_show(m, "isr", &perf->isr);
+	vvcam_hist_show(m, "thread_latency", &perf->thread_lat);
+	vvcam_hist_show(m, "thread", &perf->thread);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(isp_stats);
+
 int isp_hw_probe(struct platform_device *pdev)
 {
+#ifndef VVCAM_SIM
 	struct device *dev = &pdev->dev;
-	struct isp_device *isp_dev;
 	struct resource *mem_res;
+#endif
+	struct isp_device *isp_dev;
+	char name[16];
 	int irq;
+	int i;
 	int rc;
 	pr_info("enter %s\n", __func__);
 	isp_dev = kzalloc(sizeof(struct isp_device), GFP_KERNEL);
@@ -361,6 +674,7 @@ int isp_hw_probe(struct platform_device *pdev)
 	}
 	isp_dev->ic_dev.id = isp_dev->id;
 
+#ifndef VVCAM_SIM
 	isp_dev->clk_core = devm_clk_get(dev, "core");
 	if (IS_ERR(isp_dev->clk_core)) {
 		rc = PTR_ERR(isp_dev->clk_core);
@@ -400,6 +714,7 @@ int isp_hw_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	}
 #endif
+#endif /* VVCAM_SIM */
 	v4l2_subdev_init(&isp_dev->sd, &isp_v4l2_subdev_ops);
 	snprintf(isp_dev->sd.name, sizeof(isp_dev->sd.name),
 			"%s.%d", ISP_DEVICE_NAME, isp_dev->id);
@@ -409,12 +724,18 @@ int isp_hw_probe(struct platform_device *pdev)
 	v4l2_set_subdevdata(&isp_dev->sd, isp_dev);
 	isp_dev->sd.dev = &pdev->dev;
 
+#ifdef VVCAM_SIM
+	rc = isp_sim_init(isp_dev);
+	if (rc)
+		goto end;
+#else
 	mem_res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	isp_dev->ic_dev.base = devm_ioremap_resource(&pdev->dev, mem_res);
 	if (IS_ERR(isp_dev->ic_dev.base)) {
 		pr_err("failed to get ioremap resource.\n");
 		goto end;
 	}
+#endif
 
 #ifdef ISP_REG_RESET
 	isp_dev->ic_dev.reset = ioremap(ISP_REG_RESET, 4);
@@ -422,23 +743,78 @@ int isp_hw_probe(struct platform_device *pdev)
 	pr_debug("ioremap addr: %p", isp_dev->ic_dev.base);
 	isp_dev->ic_dev.state = &isp_dev->state;
 
-	vvbuf_ctx_init(&isp_dev->bctx);
-	isp_dev->bctx.ops = &isp_buf_ops;
-	isp_dev->ic_dev.bctx = &isp_dev->bctx;
+	if (bufring) {
+		/* every pull and flush of this queue runs under ic_dev.lock */
+		rc = vvbuf_ctx_init_ring(&isp_dev->bctx[ISP_PAD_SOURCE],
+				max_t(unsigned int, bufring, VB2_MAX_FRAME));
+		if (rc)
+			goto end;
+	} else {
+		vvbuf_ctx_init(&isp_dev->bctx[ISP_PAD_SOURCE]);
+	}
+	isp_dev->bctx[ISP_PAD_SOURCE].ops = &isp_buf_ops;
+	for (i = 0; i < MI_PATH_NUM; ++i)
+		isp_dev->ic_dev.bctx[i] = &isp_dev->bctx[ISP_PAD_SOURCE];
+
+	/* self path node, the self path pulls from it while it streams */
+	vvbuf_ctx_init(&isp_dev->bctx[ISP_PAD_SOURCE_SP]);
+	isp_dev->bctx[ISP_PAD_SOURCE_SP].ops = &isp_buf_ops;
+	isp_dev->ic_dev.sp_bctx = &isp_dev->bctx[ISP_PAD_SOURCE_SP];
+
+	/* empty meta capture buffers, filled with the stats of each frame */
+	vvbuf_ctx_init(&isp_dev->bctx[ISP_PAD_STATS]);
+	isp_dev->bctx[ISP_PAD_STATS].ops = &isp_meta_buf_ops;
+	isp_dev->ic_dev.stats_bctx = &isp_dev->bctx[ISP_PAD_STATS];
+
+	/* meta output buffers, programmed at the next frame end */
+	vvbuf_ctx_init(&isp_dev->bctx[ISP_PAD_PARAMS]);
+	isp_dev->bctx[ISP_PAD_PARAMS].ops = &isp_meta_buf_ops;
+	isp_dev->ic_dev.params_bctx = &isp_dev->bctx[ISP_PAD_PARAMS];
+
+	isp_dev->ic_dev.stats_ring = (struct isp_stats_ring *)devm_get_free_pages(
+			&pdev->dev, GFP_KERNEL | __GFP_ZERO,
+			get_order(sizeof(struct isp_stats_ring)));
+	if (isp_dev->ic_dev.stats_ring) {
+		isp_dev->ic_dev.stats_ring->num = ISP_STATS_RING_NUM;
+		isp_dev->ic_dev.stats_ring->record_size =
+				sizeof(struct isp_stats_record);
+		isp_dev->ic_dev.stats_ring_phys =
+				virt_to_phys(isp_dev->ic_dev.stats_ring);
+	} else {
+		pr_err("failed to alloc isp stats ring\n");
+	}
+
+	if (reg_shadow && isp_reg_shadow_init(&isp_dev->ic_dev))
+		pr_err("failed to alloc isp register shadow\n");
 
 	isp_dev->ic_dev.alloc = isp_buf_alloc;
 	isp_dev->ic_dev.free = isp_buf_free;
+	if (scratch)
+		isp_dev->ic_dev.scratch_dev = &pdev->dev;
 
+#ifdef VVCAM_SIM
+	irq = 0;
+#else
 	irq = platform_get_irq(pdev, 0);
 	if (irq < 0) {
 		pr_err("failed to get irq number.\n");
 		goto end;
 	}
+#endif
 
 	isp_dev->irq = irq;
 	pr_debug("request_irq num:%d, rc:%d", irq, rc);
 	spin_lock_init(&isp_dev->ic_dev.lock);
-	tasklet_init(&isp_dev->ic_dev.tasklet, isp_isr_tasklet, (unsigned long)(&isp_dev->ic_dev));
+	isp_dev->ic_dev.mi_depth = clamp_t(u32, mi_depth, 2, ISP_MI_DEPTH_MAX);
+	isp_dev->ic_dev.irq_dma_update = irq_dma_update ||
+		of_property_read_bool(pdev->dev.of_node, "irq-dma-update");
+	for (i = 0; i < MI_PATH_NUM; ++i) {
+		INIT_LIST_HEAD(&isp_dev->ic_dev.mi_ready[i]);
+		INIT_LIST_HEAD(&isp_dev->ic_dev.mi_done[i]);
+	}
+#ifndef VVCAM_SIM
+	isp_dev->ic_dev.irq_prio = irq_prio;
+#endif
 
 	platform_set_drvdata(pdev, isp_dev);
 
@@ -448,6 +824,9 @@ int isp_hw_probe(struct platform_device *pdev)
 	isp_dev->sd.entity.ops = &isp_media_ops;
 	isp_dev->pads[ISP_PAD_SOURCE].flags =
 			MEDIA_PAD_FL_SOURCE | MEDIA_PAD_FL_MUST_CONNECT;
+	isp_dev->pads[ISP_PAD_STATS].flags = MEDIA_PAD_FL_SOURCE;
+	isp_dev->pads[ISP_PAD_PARAMS].flags = MEDIA_PAD_FL_SINK;
+	isp_dev->pads[ISP_PAD_SOURCE_SP].flags = MEDIA_PAD_FL_SOURCE;
 	rc = media_entity_pads_init(&isp_dev->sd.entity,
 			ISP_PADS_NUM, isp_dev->pads);
 	if (rc)
@@ -460,10 +839,22 @@ int isp_hw_probe(struct platform_device *pdev)
 
 	pm_runtime_enable(&pdev->dev);
 
+	snprintf(name, sizeof(name), "vvcam-isp%d", isp_dev->id);
+	isp_dev->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, isp_dev->debugfs,
+			&isp_dev->ic_dev, &isp_stats_fops);
+
 	pr_info("vvcam isp driver registered\n");
 	return 0;
 end:
-	vvbuf_ctx_deinit(&isp_dev->bctx);
+	vvbuf_ctx_deinit(&isp_dev->bctx[ISP_PAD_SOURCE]);
+	vvbuf_ctx_deinit(&isp_dev->bctx[ISP_PAD_STATS]);
+	vvbuf_ctx_deinit(&isp_dev->bctx[ISP_PAD_PARAMS]);
+	vvbuf_ctx_deinit(&isp_dev->bctx[ISP_PAD_SOURCE_SP]);
+	isp_reg_shadow_free(&isp_dev->ic_dev);
+#ifdef VVCAM_SIM
+	isp_sim_deinit(isp_dev);
+#endif
 	kfree(isp_dev);
 	pm_runtime_put(&pdev->dev);
 	pm_runtime_disable(&pdev->dev);
@@ -478,10 +869,19 @@ int isp_hw_remove(struct platform_device *pdev)
 	if (!isp)
 		return -1;
 
-	tasklet_kill(&isp->ic_dev.tasklet);
-	vvbuf_ctx_deinit(&isp->bctx);
+	debugfs_remove_recursive(isp->debugfs);
+	vvbuf_ctx_deinit(&isp->bctx[ISP_PAD_SOURCE]);
+	vvbuf_ctx_deinit(&isp->bctx[ISP_PAD_STATS]);
+	vvbuf_ctx_deinit(&isp->bctx[ISP_PAD_PARAMS]);
+	vvbuf_ctx_deinit(&isp->bctx[ISP_PAD_SOURCE_SP]);
 	media_entity_cleanup(&isp->sd.entity);
 	v4l2_async_unregister_subdev(&isp->sd);
+	isp_reg_shadow_free(&isp->ic_dev);
+	isp_scratch_release(&isp->ic_dev);
+	kfree(isp->ic_dev.reg_batch);
+#ifdef VVCAM_SIM
+	isp_sim_deinit(isp);
+#endif
 
 	kfree(isp);
 	pm_runtime_disable(&pdev->dev);
@@ -544,6 +944,8 @@ static int isp_runtime_resume(struct device *dev)
 	struct isp_device *isp_dev = dev_get_drvdata(dev);
 
 	isp_enable_clocks(isp_dev);
+	/* the block may have lost power while suspended */
+	isp_reg_shadow_invalidate(&isp_dev->ic_dev);
 
 	return 0;
 }
@@ -583,12 +985,20 @@ static int __init viv_isp_init_module(void)
 		return ret;
 	}
 
+#ifdef VVCAM_SIM
+	ret = isp_sim_register();
+	if (ret)
+		platform_driver_unregister(&viv_isp_driver);
+#endif
 	return ret;
 }
 
 static void __exit viv_isp_exit_module(void)
 {
 	pr_info("enter %s\n", __func__);
+#ifdef VVCAM_SIM
+	isp_sim_unregister();
+#endif
 	platform_driver_unregister(&viv_isp_driver);
 }
 
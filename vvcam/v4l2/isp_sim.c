@@ -0,0 +1,258 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/hrtimer.h>
+#include <linux/dma-mapping.h>
+#include <linux/version.h>
+
+#include "isp_driver.h"
+#include "isp_ioctl.h"
+#include "mrv_all_bits.h"
+
+/*
+ * Hardware-free isp for VVCAM_SIM builds.  The real isp code runs against
+ * a kzalloc'd register file and an hrtimer stands in for the sensor: at
+ * each frame end it fills the programmed mi buffers with a test pattern,
+ * and the frame end and start of frame interrupts are raised by calling
+ * isp_hw_isr() from the timer, followed by the irq thread handler inline.
+ */
+
+static unsigned int sim_fps = 30;
+module_param(sim_fps, uint, 0644);
+MODULE_PARM_DESC(sim_fps, "frame rate of the simulated sensor");
+
+static bool sim_tpg = true;
+module_param(sim_tpg, bool, 0644);
+MODULE_PARM_DESC(sim_tpg, "fill finished buffers with a test pattern");
+
+static struct platform_device *isp_sim_pdev;
+
+static inline u32 isp_sim_read(struct isp_ic_dev *dev, u32 offset)
+{
+	return __raw_readl(dev->base + offset);
+}
+
+static inline void isp_sim_write(struct isp_ic_dev *dev, u32 offset, u32 val)
+{
+	__raw_writel(val, dev->base + offset);
+}
+
+/* a horizontal ramp scrolling by one step per frame, format agnostic */
+static void isp_sim_fill(struct isp_mi_data_path_context *path,
+			 struct vb2_dc_buf *buf, u32 frame)
+{
+	struct vb2_buffer *vb = &buf->vb.vb2_buf;
+	unsigned long size, line, off;
+	u8 *vaddr;
+	u32 x;
+
+	/* buffers the isp allocated for a userspace address have no queue */
+	if (!vb->vb2_queue)
+		return;
+	vaddr = vb2_plane_vaddr(vb, 0);
+	if (!vaddr)
+		return;
+
+	size = vb2_plane_size(vb, 0);
+	line = min_t(unsigned long, max_t(u32, path->out_width, 1), size);
+	for (x = 0; x < line; ++x)
+		vaddr[x] = (u8)(x * 256 / line + frame * 4);
+	for (off = line; off + line <= size; off += line)
+		memcpy(vaddr + off, vaddr, line);
+}
+
+/* one frame period, a tenth of which is spent in vertical blanking */
+static inline u64 isp_sim_period_ns(void)
+{
+	return NSEC_PER_SEC / max_t(unsigned int, sim_fps, 1);
+}
+
+static void isp_sim_irq(struct isp_ic_dev *dev)
+{
+	if (isp_hw_isr(0, dev) == IRQ_WAKE_THREAD)
+		isp_irq_thread(0, dev);
+}
+
+static void isp_sim_frame_end(struct isp_device *isp_dev)
+{
+	struct isp_ic_dev *dev = &isp_dev->ic_dev;
+	u32 isp_mis, mi_mis = 0;
+	unsigned long flags;
+	int i;
+
+	/* the frame in flight lands in the buffers the mi shadows hold */
+	if (sim_tpg) {
+		spin_lock_irqsave(&dev->lock, flags);
+		for (i = 0; i < MI_PATH_NUM; ++i)
+			if (dev->mi.path[i].enable && dev->mi_buf_shd[i])
+				isp_sim_fill(&dev->mi.path[i],
+					     dev->mi_buf_shd[i], isp_dev->sim_frame);
+		spin_unlock_irqrestore(&dev->lock, flags);
+	}
+	isp_dev->sim_frame++;
+
+	isp_mis = MRV_ISP_MIS_FRAME_MASK &
+			isp_sim_read(dev, REG_ADDR(isp_imsc));
+#ifdef ISP_MIV1
+	mi_mis = (MRV_MI_MP_FRAME_END_MASK | MRV_MI_SP_FRAME_END_MASK) &
+			isp_sim_read(dev, REG_ADDR(mi_imsc));
+	isp_sim_write(dev, REG_ADDR(mi_ris), mi_mis);
+	isp_sim_write(dev, REG_ADDR(mi_mis), mi_mis);
+#endif
+	isp_sim_write(dev, REG_ADDR(isp_ris), isp_mis);
+	isp_sim_write(dev, REG_ADDR(isp_mis), isp_mis);
+	if (isp_mis || mi_mis)
+		isp_sim_irq(dev);
+}
+
+static void isp_sim_frame_start(struct isp_device *isp_dev)
+{
+	struct isp_ic_dev *dev = &isp_dev->ic_dev;
+	u32 isp_mis;
+
+	isp_mis = MRV_ISP_MIS_V_START_MASK &
+			isp_sim_read(dev, REG_ADDR(isp_imsc));
+	isp_sim_write(dev, REG_ADDR(isp_ris), isp_mis);
+	isp_sim_write(dev, REG_ADDR(isp_mis), isp_mis);
+	if (isp_mis)
+		isp_sim_irq(dev);
+}
+
+static enum hrtimer_restart isp_sim_frame(struct hrtimer *timer)
+{
+	struct isp_device *isp_dev =
+			container_of(timer, struct isp_device, sim_timer);
+	struct isp_ic_dev *dev = &isp_dev->ic_dev;
+	u64 period = isp_sim_period_ns();
+	bool enabled;
+
+	enabled = isp_sim_read(dev, REG_ADDR(isp_ctrl)) &
+			MRV_ISP_ISP_ENABLE_MASK;
+	if (isp_dev->sim_vblank) {
+		if (enabled)
+			isp_sim_frame_start(isp_dev);
+		hrtimer_forward_now(timer, ns_to_ktime(period - period / 10));
+	} else {
+		if (enabled)
+			isp_sim_frame_end(isp_dev);
+		hrtimer_forward_now(timer, ns_to_ktime(period / 10));
+	}
+	isp_dev->sim_vblank = !isp_dev->sim_vblank;
+
+	/* the icr writes are plain stores here, nothing clears on its own */
+	isp_sim_write(dev, REG_ADDR(isp_ris), 0);
+	isp_sim_write(dev, REG_ADDR(isp_mis), 0);
+#ifdef ISP_MIV1
+	isp_sim_write(dev, REG_ADDR(mi_ris), 0);
+	isp_sim_write(dev, REG_ADDR(mi_mis), 0);
+#endif
+	return HRTIMER_RESTART;
+}
+
+int isp_sim_init(struct isp_device *isp_dev)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&isp_dev->sim_timer, isp_sim_frame, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL);
+#else
+	hrtimer_init(&isp_dev->sim_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	isp_dev->sim_timer.function = isp_sim_frame;
+#endif
+
+	isp_dev->ic_dev.base = (void __iomem *)kzalloc(ISP_REG_SIZE, GFP_KERNEL);
+	if (!isp_dev->ic_dev.base)
+		return -ENOMEM;
+	return 0;
+}
+
+void isp_sim_deinit(struct isp_device *isp_dev)
+{
+	hrtimer_cancel(&isp_dev->sim_timer);
+	kfree((void __force *)isp_dev->ic_dev.base);
+	isp_dev->ic_dev.base = NULL;
+}
+
+void isp_sim_start(struct isp_device *isp_dev)
+{
+	/* open in vertical blanking, so a start of frame comes first */
+	isp_dev->sim_frame = 0;
+	isp_dev->sim_vblank = true;
+	hrtimer_start(&isp_dev->sim_timer,
+		      ns_to_ktime(isp_sim_period_ns() / 10), HRTIMER_MODE_REL);
+}
+
+void isp_sim_stop(struct isp_device *isp_dev)
+{
+	hrtimer_cancel(&isp_dev->sim_timer);
+}
+
+int isp_sim_register(void)
+{
+	isp_sim_pdev = platform_device_register_simple(ISP_DEVICE_NAME, 0,
+			NULL, 0);
+	if (IS_ERR(isp_sim_pdev)) {
+		pr_err("failed to register the simulated isp device\n");
+		return PTR_ERR(isp_sim_pdev);
+	}
+	/* for the scratch buffer, capture buffers come from the video node */
+	dma_coerce_mask_and_coherent(&isp_sim_pdev->dev, DMA_BIT_MASK(32));
+	return 0;
+}
+
+void isp_sim_unregister(void)
+{
+	if (!IS_ERR_OR_NULL(isp_sim_pdev))
+		platform_device_unregister(isp_sim_pdev);
+	isp_sim_pdev = NULL;
+}
@@ -0,0 +1,21 @@
+#ifndef _VVCAM_AR1335_I2C_RANGES_H_
+#define _VVCAM_AR1335_I2C_RANGES_H_
+
+#include "vvsensor_i2c.h"
+
+#define AR1335_RESET_REG                0x301A
+
+/* mode switches always rewrite the pll and the runtime controls, the
+ * reset register of the tables is left to the full write, frame count
+ * and status read back from the sensor */
+static const struct vvsensor_reg_range ar1335_i2c_ranges[] = {
+	{0x0202, 0x0202, VVSENSOR_REG_SWITCH},
+	{0x0300, 0x0310, VVSENSOR_REG_SWITCH},
+	{0x0600, 0x0600, VVSENSOR_REG_SWITCH},
+	{0x3012, 0x3012, VVSENSOR_REG_SWITCH},
+	{AR1335_RESET_REG, AR1335_RESET_REG, VVSENSOR_REG_TRIGGER},
+	{0x303A, 0x303C, VVSENSOR_REG_VOLATILE},
+	{0x305E, 0x305E, VVSENSOR_REG_SWITCH},
+};
+
+#endif
@@ -30,10 +30,16 @@
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include "vvsensor.h"
+#include "vvsensor_sync.h"
+#include "vvsensor_i2c.h"
 #include "ar1335_regs_1080p.h"
 #include "ar1335_regs_1080p60.h"
 #include "ar1335_regs_12MP.h"
+#include "ar1335_i2c_ranges.h"
 
+#define VVSENSOR_TRACE_SYSTEM vvcam_ar1335
+#define CREATE_TRACE_POINTS
+#include "vvsensor_trace.h"
 
 #define AR1335_VOLTAGE_ANALOG			2800000
 #define AR1335_VOLTAGE_DIGITAL_CORE		1500000
@@ -44,7 +50,6 @@
 
 #define AR1335_CHIP_ID                  0x153
 #define AR1335_CHIP_VERSION_REG 		0x3000
-#define AR1335_RESET_REG                0x301A
 
 #define AR1335_SENS_PAD_SOURCE	0
 #define AR1335_SENS_PADS_NUM	1
@@ -85,6 +90,8 @@ struct ar1335 {
 	u32 stream_status;
 	u32 resume_status;
 	vvcam_lens_t focus_lens;
+	struct vvsensor_sync sync;
+	struct vvsensor_i2c i2c;
 };
 
 static struct vvcam_mode_info_s par1335_mode_info[] = {
@@ -256,6 +263,7 @@ static int ar1335_power_off(struct ar1335 *sensor)
 	if (gpio_is_valid(sensor->pwn_gpio))
 		gpio_set_value_cansleep(sensor->pwn_gpio, 0);
 	clk_disable_unprepare(sensor->sensor_clk);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return 0;
 }
@@ -276,38 +284,20 @@ static int ar1335_s_power(struct v4l2_subdev *sd, int on)
 
 static s32 ar1335_write_reg(struct ar1335 *sensor, u16 reg, u16 val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8Buf[4] = { reg >> 8, reg & 0xff, val >> 8, val & 0xff };
-
-	if (i2c_master_send(sensor->i2c_client, au8Buf, 4) < 0) {
-		dev_err(dev, "Write reg error: reg=%x, val=%x\n", reg, val);
-		return -1;
-	}
-
-	return 0;
+	return vvsensor_i2c_write(&sensor->i2c, reg, val);
 }
 
 
 static s32 ar1335_read_reg(struct ar1335 *sensor, u16 reg, u16 *val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8RegBuf[2] = { reg >> 8, reg & 0xff };
-	u8 au8RdVal[2] = {0};
-
-	if (i2c_master_send(sensor->i2c_client, au8RegBuf, 2) != 2) {
-		dev_err(dev, "Read reg error: reg=%x\n", reg);
-		return -1;
-	}
+	u32 data;
+	s32 ret;
 
-	if (i2c_master_recv(sensor->i2c_client, au8RdVal, 2) != 2) {
-		dev_err(dev, "Read reg error: reg=%x, val=%x %x\n",
-                        reg, au8RdVal[0], au8RdVal[1]);
-		return -1;
-	}
+	ret = vvsensor_i2c_read(&sensor->i2c, reg, &data);
+	if (ret == 0)
+		*val = data;
 
-	*val = ((u16)au8RdVal[0] << 8) | (u16)au8RdVal[1];
-
-	return 0;
+	return ret;
 }
 
 
@@ -343,21 +333,10 @@ static int ar1335_write_reg_arry(struct ar1335 *sensor,
 				    struct vvcam_sccb_data_s *mode_setting,
 				    s32 size)
 {
-	register u16 reg_addr = 0;
-	register u16 data = 0;
-	int i, retval = 0;
-
-	for (i = 0; i < size; ++i, ++mode_setting) {
-
-		reg_addr = mode_setting->addr;
-		data = mode_setting->data;
+	int retval;
 
-		retval = ar1335_write_reg(sensor, reg_addr, data);
-		if (retval < 0)
-			break;
-		if (reg_addr == 0x301A  && i == 0)
-			msleep(100);
-	}
+	retval = vvsensor_i2c_write_mode(&sensor->i2c, NULL, 0,
+			mode_setting, size);
 
     ar1335_stream_off(sensor);
 
@@ -612,6 +591,21 @@ static int ar1335_get_format_code(struct ar1335 *sensor, u32 *code)
 	return 0;
 }
 
+static int ar1335_sync_apply(struct vvsensor_sync *sync, u32 cmd, u32 value)
+{
+	struct ar1335 *sensor = container_of(sync, struct ar1335, sync);
+
+	switch (cmd) {
+	case VVSENSORIOC_S_EXP:
+		return ar1335_set_exp(sensor, value);
+	case VVSENSORIOC_S_GAIN:
+		return ar1335_set_gain(sensor, value);
+	case VVSENSORIOC_S_FPS:
+		return ar1335_set_fps(sensor, value);
+	default:
+		return -EINVAL;
+	}
+}
 
 static int ar1335_s_stream(struct v4l2_subdev *sd, int enable)
 {
@@ -624,7 +618,9 @@ static int ar1335_s_stream(struct v4l2_subdev *sd, int enable)
         ret = ar1335_stream_on(sensor);
         if (ret < 0)
             return ret;
+        vvsensor_sync_start(&sensor->sync, &sensor->cur_mode.ae_info);
     } else {
+        vvsensor_sync_stop(&sensor->sync);
         ret = ar1335_stream_off(sensor);
         if (ret < 0)
             return ret;
@@ -726,6 +722,7 @@ static long ar1335_priv_ioctl(struct v4l2_subdev *sd,
 	long ret = 0;
 	struct vvcam_sccb_data_s sensor_reg;
 	uint32_t value = 0;
+	struct vvcam_ae_group_s ae_group;
 
 	mutex_lock(&sensor->lock);
 	switch (cmd){
@@ -754,10 +751,14 @@ static long ar1335_priv_ioctl(struct v4l2_subdev *sd,
 		ret = ar1335_get_reserve_id(sensor, arg);
 		break;
 	case VVSENSORIOC_G_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ar1335_get_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ar1335_set_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_STREAM:
 		ret = copy_from_user(&value, arg, sizeof(value));
@@ -768,6 +769,7 @@ static long ar1335_priv_ioctl(struct v4l2_subdev *sd,
 			sizeof(struct vvcam_sccb_data_s));
 		ret |= ar1335_write_reg(sensor, sensor_reg.addr,
 			sensor_reg.data);
+		vvsensor_i2c_invalidate(&sensor->i2c);
 		break;
 	case VVSENSORIOC_READ_REG:
 		ret = copy_from_user(&sensor_reg, arg, sizeof(struct vvcam_sccb_data_s));
@@ -776,18 +778,32 @@ static long ar1335_priv_ioctl(struct v4l2_subdev *sd,
 		break;
 	case VVSENSORIOC_S_EXP:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ar1335_set_exp(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_GAIN:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ar1335_set_gain(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
+		break;
+	case VVSENSORIOC_G_AE_SYNC:
+		ret = vvsensor_sync_get(&sensor->sync, arg);
+		break;
+	case VVSENSORIOC_S_AE_GROUP:
+		ret = copy_from_user(&ae_group, arg, sizeof(ae_group));
+		ret |= vvsensor_sync_set_ae(&sensor->sync, &ae_group);
+		trace_sensor_ae(sd->name, cmd, ae_group.mask, ret);
 		break;
 	case VVSENSORIOC_S_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = copy_from_user(&value, arg, sizeof(value));
 		ret |= ar1335_set_fps(sensor, value);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_G_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ar1335_get_fps(sensor, &value);
+		vvsensor_sync_unlock(&sensor->sync);
 		ret |= copy_to_user(arg, &value, sizeof(value));
 		break;
 	case VVSENSORIOC_S_TEST_PATTERN:
@@ -939,6 +955,7 @@ static void ar1335_reset(struct ar1335 *sensor)
 
 	gpio_set_value_cansleep(sensor->rst_gpio, 1);
 	msleep(20);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return;
 }
@@ -1006,6 +1023,9 @@ static int ar1335_probe(struct i2c_client *client,
 	memset(sensor, 0, sizeof(*sensor));
 
 	sensor->i2c_client = client;
+	retval = vvsensor_i2c_init(&sensor->i2c, client, 2, 2);
+	if (retval < 0)
+		return retval;
 
 	sensor->pwn_gpio = of_get_named_gpio(dev->of_node, "pwn-gpios", 0);
 	if (!gpio_is_valid(sensor->pwn_gpio))
@@ -1121,6 +1141,16 @@ static int ar1335_probe(struct i2c_client *client,
         goto probe_err_power_off;
     }
 
+	vvsensor_i2c_add_modes(&sensor->i2c, par1335_mode_info,
+			ARRAY_SIZE(par1335_mode_info));
+	sensor->i2c.ranges = ar1335_i2c_ranges;
+	sensor->i2c.nranges = ARRAY_SIZE(ar1335_i2c_ranges);
+	retval = vvsensor_i2c_add_diffs(&sensor->i2c);
+	if (retval == 0)
+		retval = vvsensor_i2c_add_cache(&sensor->i2c);
+	if (retval < 0)
+		goto probe_err_power_off;
+
 	sd = &sensor->subdev;
 	v4l2_i2c_subdev_init(sd, client, &ar1335_subdev_ops);
 	sd->flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
@@ -1149,6 +1179,7 @@ static int ar1335_probe(struct i2c_client *client,
 			sizeof(struct vvcam_mode_info_s));
 
 	mutex_init(&sensor->lock);
+	vvsensor_sync_init(&sensor->sync, sensor->csi_id, ar1335_sync_apply);
 
 	pr_info("%s camera mipi ar1335, is found\n", __func__);
 
@@ -1158,6 +1189,7 @@ probe_err_free_entiny:
 	media_entity_cleanup(&sd->entity);
 
 probe_err_power_off:
+	vvsensor_i2c_exit(&sensor->i2c);
 	ar1335_power_off(sensor);
 
 probe_err_regulator_disable:
@@ -1174,6 +1206,8 @@ static int ar1335_remove(struct i2c_client *client)
 	pr_info("enter %s\n", __func__);
 
 	v4l2_async_unregister_subdev(sd);
+	vvsensor_sync_exit(&sensor->sync);
+	vvsensor_i2c_exit(&sensor->i2c);
 	media_entity_cleanup(&sd->entity);
 	ar1335_power_off(sensor);
 	ar1335_regulator_disable(sensor);
@@ -6,6 +6,7 @@
 /* 1080P30 RAW10 */
 static struct vvcam_sccb_data_s ar1335_init_setting_1080p[] = {
     {0x301A, 0x0219}, // RESET_REGISTER
+    {VVSENSOR_REG_DELAY, 100},
     {0x3042, 0x1004}, // DARK_CONTROL2
     {0x30D2, 0x0120}, // CRM_CONTROL
     {0x30D4, 0x0000}, // COLUMN_CORRECTION
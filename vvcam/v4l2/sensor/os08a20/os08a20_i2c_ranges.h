@@ -0,0 +1,76 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#ifndef _VVCAM_OS08A20_I2C_RANGES_H_
+#define _VVCAM_OS08A20_I2C_RANGES_H_
+
+#include "vvsensor_i2c.h"
+
+/* mode switches always rewrite stream, pll and the runtime controls,
+ * group hold and temperature read back from the sensor */
+static const struct vvsensor_reg_range os08a20_i2c_ranges[] = {
+	{0x0100, 0x0100, VVSENSOR_REG_SWITCH},
+	{0x0103, 0x0103, VVSENSOR_REG_TRIGGER},
+	{0x0300, 0x032f, VVSENSOR_REG_SWITCH},
+	{0x3208, 0x3208, VVSENSOR_REG_SWITCH | VVSENSOR_REG_VOLATILE},
+	{0x3501, 0x3512, VVSENSOR_REG_SWITCH},
+	{0x380e, 0x380f, VVSENSOR_REG_SWITCH},
+	{0x4d2a, 0x4d2b, VVSENSOR_REG_VOLATILE},
+	{0x5081, 0x5081, VVSENSOR_REG_SWITCH},
+};
+
+static struct vvcam_sccb_data_s os08a20_soft_reset[] = {
+	{0x0103, 0x01},
+	{VVSENSOR_REG_DELAY, 20},
+};
+
+#endif
@@ -30,11 +30,18 @@
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include "vvsensor.h"
+#include "vvsensor_sync.h"
+#include "vvsensor_i2c.h"
 
 #include "os08a20_regs_1080p.h"
 #include "os08a20_regs_1080p_hdr.h"
 #include "os08a20_regs_4k.h"
 #include "os08a20_regs_4k_hdr.h"
+#include "os08a20_i2c_ranges.h"
+
+#define VVSENSOR_TRACE_SYSTEM vvcam_os08a20
+#define CREATE_TRACE_POINTS
+#include "vvsensor_trace.h"
 
 #define OS08A20_VOLTAGE_ANALOG			2800000
 #define OS08A20_VOLTAGE_DIGITAL_CORE		1500000
@@ -78,6 +85,8 @@ struct os08a20 {
 	struct mutex lock;
 	u32 stream_status;
 	u32 resume_status;
+	struct vvsensor_sync sync;
+	struct vvsensor_i2c i2c;
 };
 
 static struct vvcam_mode_info_s pos08a20_mode_info[] = {
@@ -298,6 +307,7 @@ static int os08a20_power_off(struct os08a20 *sensor)
 	if (gpio_is_valid(sensor->pwn_gpio))
 		gpio_set_value_cansleep(sensor->pwn_gpio, 0);
 	clk_disable_unprepare(sensor->sensor_clk);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return 0;
 }
@@ -330,101 +340,26 @@ static int os08a20_get_clk(struct os08a20 *sensor, void *clk)
 
 static int os08a20_write_reg(struct os08a20 *sensor, u16 reg, u8 val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8Buf[3] = { 0 };
-
-	au8Buf[0] = reg >> 8;
-	au8Buf[1] = reg & 0xff;
-	au8Buf[2] = val;
-
-	if (i2c_master_send(sensor->i2c_client, au8Buf, 3) < 0) {
-		dev_err(dev, "Write reg error: reg=%x, val=%x\n", reg, val);
-		return -1;
-	}
-
-	return 0;
+	return vvsensor_i2c_write(&sensor->i2c, reg, val);
 }
 
 static int os08a20_read_reg(struct os08a20 *sensor, u16 reg, u8 *val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8RegBuf[2] = { 0 };
-	u8 u8RdVal = 0;
-
-	au8RegBuf[0] = reg >> 8;
-	au8RegBuf[1] = reg & 0xff;
-
-	if (i2c_master_send(sensor->i2c_client, au8RegBuf, 2) != 2) {
-		dev_err(dev, "Read reg error: reg=%x\n", reg);
-		return -1;
-	}
-
-	if (i2c_master_recv(sensor->i2c_client, &u8RdVal, 1) != 1) {
-		dev_err(dev, "Read reg error: reg=%x, val=%x\n", reg, u8RdVal);
-		return -1;
-	}
+	u32 data;
+	int ret;
 
-	*val = u8RdVal;
+	ret = vvsensor_i2c_read(&sensor->i2c, reg, &data);
+	if (ret == 0)
+		*val = data;
 
-	return 0;
+	return ret;
 }
 
 static int os08a20_write_reg_arry(struct os08a20 *sensor,
 				  struct vvcam_sccb_data_s *reg_arry,
 				  u32 size)
 {
-	int i = 0;
-	int ret = 0;
-	struct i2c_msg msg;
-	u8 *send_buf;
-	u32 send_buf_len = 0;
-	struct i2c_client *i2c_client = sensor->i2c_client;
-
-	send_buf = (u8 *)kmalloc(size + 2, GFP_KERNEL);
-	if (!send_buf)
-		return -ENOMEM;
-
-	send_buf[send_buf_len++] = (reg_arry[0].addr >> 8) & 0xff;
-	send_buf[send_buf_len++] = reg_arry[0].addr & 0xff;
-	send_buf[send_buf_len++] = reg_arry[0].data & 0xff;
-	for (i=1; i < size; i++) {
-		if (reg_arry[i].addr == (reg_arry[i-1].addr + 1)){
-			send_buf[send_buf_len++] = reg_arry[i].data & 0xff;
-		} else {
-			msg.addr  = i2c_client->addr;
-			msg.flags = i2c_client->flags;
-			msg.buf   = send_buf;
-			msg.len   = send_buf_len;
-			ret = i2c_transfer(i2c_client->adapter, &msg, 1);
-			if (ret < 0) {
-				pr_err("%s:i2c transfer error\n",__func__);
-				kfree(send_buf);
-				return ret;
-			}
-			send_buf_len = 0;
-			send_buf[send_buf_len++] =
-				(reg_arry[i].addr >> 8) & 0xff;
-			send_buf[send_buf_len++] =
-				reg_arry[i].addr & 0xff;
-			send_buf[send_buf_len++] =
-				reg_arry[i].data & 0xff;
-		}
-	}
-
-	if (send_buf_len > 0) {
-		msg.addr  = i2c_client->addr;
-		msg.flags = i2c_client->flags;
-		msg.buf   = send_buf;
-		msg.len   = send_buf_len;
-		ret = i2c_transfer(i2c_client->adapter, &msg, 1);
-		if (ret < 0)
-			pr_err("%s:i2c transfer end meg error\n",__func__);
-		else
-			ret = 0;
-
-	}
-	kfree(send_buf);
-	return ret;
+	return vvsensor_i2c_write_table(&sensor->i2c, reg_arry, size);
 }
 
 static int os08a20_query_capability(struct os08a20 *sensor, void *arg)
@@ -535,31 +470,36 @@ static int os08a20_set_vsexp(struct os08a20 *sensor, u32 exp)
 	return ret;
 }
 
-static int os08a20_set_gain(struct os08a20 *sensor, u32 total_gain)
+static void os08a20_calc_gain(u32 total_gain, u32 *again, u32 *dgain)
 {
-	int ret = 0;
-	u32 again = 0;
-	u32 dgain = 0;
-
 	if (total_gain < (1 << SENSOR_FIX_FRACBITS)) {
-		again = 0x80;
-		dgain = 0x400;
+		*again = 0x80;
+		*dgain = 0x400;
 	} else if (total_gain < 2 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 16) / 0x400) * 8;
-		dgain =  total_gain * 128 / again;
+		*again = ((total_gain * 16) / 0x400) * 8;
+		*dgain =  total_gain * 128 / *again;
 	} else if (total_gain < 4 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 8) / 0x400) * 16;
-		dgain =  total_gain * 128 / again;
+		*again = ((total_gain * 8) / 0x400) * 16;
+		*dgain =  total_gain * 128 / *again;
 	} else if (total_gain < 8 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 4) / 0x400) * 32;
-		dgain =  total_gain * 128 / again;
+		*again = ((total_gain * 4) / 0x400) * 32;
+		*dgain =  total_gain * 128 / *again;
 	} else if (total_gain < 16 * (1 << SENSOR_FIX_FRACBITS)){
-		again = ((total_gain * 2) / 0x400) * 64;
-		dgain =  total_gain * 128 / again;
+		*again = ((total_gain * 2) / 0x400) * 64;
+		*dgain =  total_gain * 128 / *again;
 	} else {
-		again = 0x7c0;
-		dgain =  total_gain * 128 / again;
+		*again = 0x7c0;
+		*dgain =  total_gain * 128 / *again;
 	}
+}
+
+static int os08a20_set_gain(struct os08a20 *sensor, u32 total_gain)
+{
+	int ret = 0;
+	u32 again = 0;
+	u32 dgain = 0;
+
+	os08a20_calc_gain(total_gain, &again, &dgain);
 
 	ret |= os08a20_write_reg(sensor, 0x3508, (again >> 8) & 0xff);
 	ret |= os08a20_write_reg(sensor, 0x3509, again & 0xff);
@@ -576,25 +516,7 @@ static int os08a20_set_vsgain(struct os08a20 *sensor, u32 total_gain)
 	u32 again = 0;
 	u32 dgain = 0;
 
-	if (total_gain < (1 << SENSOR_FIX_FRACBITS)) {
-		again = 0x80;
-		dgain = 0x400;
-	} else if (total_gain < 2 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 16) / 0x400) * 8;
-		dgain =  total_gain * 128 / again;
-	} else if (total_gain < 4 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 8) / 0x400) * 16;
-		dgain =  total_gain * 128 / again;
-	} else if (total_gain < 8 * (1 << SENSOR_FIX_FRACBITS)) {
-		again = ((total_gain * 4) / 0x400) * 32;
-		dgain =  total_gain * 128 / again;
-	} else if (total_gain < 16 * (1 << SENSOR_FIX_FRACBITS)){
-		again = ((total_gain * 2) / 0x400) * 64;
-		dgain =  total_gain * 128 / again;
-	} else {
-		again = 0x7c0;
-		dgain =  total_gain * 128 / again;
-	}
+	os08a20_calc_gain(total_gain, &again, &dgain);
 
 	ret |= os08a20_write_reg(sensor, 0x350c, (again >> 8) & 0xff);
 	ret |= os08a20_write_reg(sensor, 0x350d, again & 0xff);
@@ -605,11 +527,10 @@ static int os08a20_set_vsgain(struct os08a20 *sensor, u32 total_gain)
 	return ret;
 }
 
-static int os08a20_set_fps(struct os08a20 *sensor, u32 fps)
+/* clamps fps to the mode and updates the ae info, returns the frame length */
+static u32 os08a20_calc_vts(struct os08a20 *sensor, u32 fps)
 {
 	u32 vts;
-	//struct sensor_hdr_artio_s *phdr_ratio;
-	int ret = 0;
 
 	if (fps > sensor->cur_mode.ae_info.max_fps) {
 		fps = sensor->cur_mode.ae_info.max_fps;
@@ -620,9 +541,6 @@ static int os08a20_set_fps(struct os08a20 *sensor, u32 fps)
 	vts = sensor->cur_mode.ae_info.max_fps *
 	      sensor->cur_mode.ae_info.def_frm_len_lines / fps;
 
-	ret = os08a20_write_reg(sensor, 0x380e, (u8)(vts >> 8) & 0xff);
-	ret |= os08a20_write_reg(sensor, 0x380f, (u8)(vts & 0xff));
-
 	sensor->cur_mode.ae_info.cur_fps = fps;
 
 	if (sensor->cur_mode.hdr_mode == SENSOR_MODE_LINEAR) {
@@ -632,6 +550,17 @@ static int os08a20_set_fps(struct os08a20 *sensor, u32 fps)
 			vts - sensor->cur_mode.ae_info.max_vsintegration_line - 8;
 	}
 	sensor->cur_mode.ae_info.curr_frm_len_lines = vts;
+	return vts;
+}
+
+static int os08a20_set_fps(struct os08a20 *sensor, u32 fps)
+{
+	u32 vts;
+	int ret = 0;
+
+	vts = os08a20_calc_vts(sensor, fps);
+	ret = os08a20_write_reg(sensor, 0x380e, (u8)(vts >> 8) & 0xff);
+	ret |= os08a20_write_reg(sensor, 0x380f, (u8)(vts & 0xff));
 	return ret;
 }
 
@@ -695,15 +624,99 @@ static int os08a20_set_test_pattern(struct os08a20 *sensor, void * arg)
 	return ret;
 }
 
+static int os08a20_sync_apply(struct vvsensor_sync *sync, u32 cmd, u32 value)
+{
+	struct os08a20 *sensor = container_of(sync, struct os08a20, sync);
+
+	switch (cmd) {
+	case VVSENSORIOC_S_EXP:
+		return os08a20_set_exp(sensor, value);
+	case VVSENSORIOC_S_VSEXP:
+		return os08a20_set_vsexp(sensor, value);
+	case VVSENSORIOC_S_GAIN:
+		return os08a20_set_gain(sensor, value);
+	case VVSENSORIOC_S_VSGAIN:
+		return os08a20_set_vsgain(sensor, value);
+	case VVSENSORIOC_S_FPS:
+		return os08a20_set_fps(sensor, value);
+	default:
+		return -EINVAL;
+	}
+}
+
+#define OS08A20_REG(a, d) \
+	do { \
+		regs[n].addr = (a); \
+		regs[n++].data = (d) & 0xff; \
+	} while (0)
+
+/* one group hold, the registers in address order so that
+ * os08a20_write_reg_arry sends each run as one auto-increment burst */
+static int os08a20_sync_apply_group(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w, u32 n_writes)
+{
+	struct os08a20 *sensor = container_of(sync, struct os08a20, sync);
+	struct vvcam_sccb_data_s regs[20];
+	u32 val[VVSENSOR_SYNC_NUM] = { 0 };
+	u32 mask = 0, again, dgain, vts;
+	u32 i, n = 0;
+
+	for (i = 0; i < n_writes; ++i) {
+		val[w[i].cmd - VVSENSORIOC_S_LONG_EXP] = w[i].value;
+		mask |= 1 << (w[i].cmd - VVSENSORIOC_S_LONG_EXP);
+	}
+	if (mask & (BIT(VVSENSOR_SYNC_LONG_EXP) | BIT(VVSENSOR_SYNC_LONG_GAIN)))
+		return -EINVAL;
+
+	OS08A20_REG(0x3208, 0x00);
+	if (mask & BIT(VVSENSOR_SYNC_EXP)) {
+		OS08A20_REG(0x3501, val[VVSENSOR_SYNC_EXP] >> 8);
+		OS08A20_REG(0x3502, val[VVSENSOR_SYNC_EXP]);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_GAIN)) {
+		os08a20_calc_gain(val[VVSENSOR_SYNC_GAIN], &again, &dgain);
+		OS08A20_REG(0x3508, again >> 8);
+		OS08A20_REG(0x3509, again);
+		OS08A20_REG(0x350a, dgain >> 8);
+		OS08A20_REG(0x350b, dgain);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_VSGAIN)) {
+		os08a20_calc_gain(val[VVSENSOR_SYNC_VSGAIN], &again, &dgain);
+		OS08A20_REG(0x350c, again >> 8);
+		OS08A20_REG(0x350d, again);
+		OS08A20_REG(0x350e, dgain >> 8);
+		OS08A20_REG(0x350f, dgain);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_VSEXP)) {
+		OS08A20_REG(0x3511, val[VVSENSOR_SYNC_VSEXP] >> 8);
+		OS08A20_REG(0x3512, val[VVSENSOR_SYNC_VSEXP]);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_FPS)) {
+		vts = os08a20_calc_vts(sensor, val[VVSENSOR_SYNC_FPS]);
+		OS08A20_REG(0x380e, vts >> 8);
+		OS08A20_REG(0x380f, vts);
+	}
+	/* end group 0 and launch it at the next frame boundary */
+	OS08A20_REG(0x3208, 0x10);
+	OS08A20_REG(0x3208, 0xa0);
+
+	return os08a20_write_reg_arry(sensor, regs, n);
+}
+
+#undef OS08A20_REG
+
 static int os08a20_s_stream(struct v4l2_subdev *sd, int enable)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(sd);
 	struct os08a20 *sensor = client_to_os08a20(client);
 
-	if (enable)
+	if (enable) {
 		os08a20_write_reg(sensor, 0x0100, 0x01);
-	else
+		vvsensor_sync_start(&sensor->sync, &sensor->cur_mode.ae_info);
+	} else {
+		vvsensor_sync_stop(&sensor->sync);
 		os08a20_write_reg(sensor, 0x0100, 0x00);
+	}
 
 	sensor->stream_status = enable;
 	return 0;
@@ -800,14 +813,12 @@ static int os08a20_set_fmt(struct v4l2_subdev *sd,
 	}
 
 	os08a20_write_reg(sensor, 0x100, 0x00);
-	os08a20_write_reg(sensor, 0x103, 0x01);
-	msleep(20);
-
-	ret = os08a20_write_reg_arry(sensor,
+	ret = vvsensor_i2c_write_mode(&sensor->i2c,
+		os08a20_soft_reset, ARRAY_SIZE(os08a20_soft_reset),
 		(struct vvcam_sccb_data_s *)sensor->cur_mode.preg_data,
 		sensor->cur_mode.reg_data_count);
 	if (ret < 0) {
-		pr_err("%s:os08a20_write_reg_arry error\n",__func__);
+		pr_err("%s:vvsensor_i2c_write_mode error\n",__func__);
 		mutex_unlock(&sensor->lock);
 		return -EINVAL;
 	}
@@ -845,6 +856,7 @@ static long os08a20_priv_ioctl(struct v4l2_subdev *sd,
 	struct os08a20 *sensor = client_to_os08a20(client);
 	long ret = 0;
 	struct vvcam_sccb_data_s sensor_reg;
+	struct vvcam_ae_group_s ae_group;
 
 	mutex_lock(&sensor->lock);
 	switch (cmd){
@@ -873,10 +885,14 @@ static long os08a20_priv_ioctl(struct v4l2_subdev *sd,
 		ret = os08a20_get_reserve_id(sensor, arg);
 		break;
 	case VVSENSORIOC_G_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = os08a20_get_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = os08a20_set_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_STREAM:
 		ret = os08a20_s_stream(&sensor->subdev, *(int *)arg);
@@ -886,6 +902,7 @@ static long os08a20_priv_ioctl(struct v4l2_subdev *sd,
 			sizeof(struct vvcam_sccb_data_s));
 		ret |= os08a20_write_reg(sensor, sensor_reg.addr,
 			sensor_reg.data);
+		vvsensor_i2c_invalidate(&sensor->i2c);
 		break;
 	case VVSENSORIOC_READ_REG:
 		ret = copy_from_user(&sensor_reg, arg,
@@ -896,25 +913,43 @@ static long os08a20_priv_ioctl(struct v4l2_subdev *sd,
 			sizeof(struct vvcam_sccb_data_s));
 		break;
 	case VVSENSORIOC_S_EXP:
-		ret = os08a20_set_exp(sensor, *(u32 *)arg);
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
 		break;
 	case VVSENSORIOC_S_VSEXP:
-		ret = os08a20_set_vsexp(sensor, *(u32 *)arg);
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
 		break;
 	case VVSENSORIOC_S_GAIN:
-		ret = os08a20_set_gain(sensor, *(u32 *)arg);
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
 		break;
 	case VVSENSORIOC_S_VSGAIN:
-		ret = os08a20_set_vsgain(sensor, *(u32 *)arg);
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
+		break;
+	case VVSENSORIOC_G_AE_SYNC:
+		ret = vvsensor_sync_get(&sensor->sync, arg);
+		break;
+	case VVSENSORIOC_S_AE_GROUP:
+		ret = copy_from_user(&ae_group, arg, sizeof(ae_group));
+		ret |= vvsensor_sync_set_ae(&sensor->sync, &ae_group);
+		trace_sensor_ae(sd->name, cmd, ae_group.mask, ret);
 		break;
 	case VVSENSORIOC_S_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = os08a20_set_fps(sensor, *(u32 *)arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_G_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = os08a20_get_fps(sensor, (u32 *)arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_HDR_RADIO:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = os08a20_set_ratio(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_TEST_PATTERN:
 		ret= os08a20_set_test_pattern(sensor, arg);
@@ -1062,6 +1097,7 @@ static void os08a20_reset(struct os08a20 *sensor)
 
 	gpio_set_value_cansleep(sensor->rst_gpio, 1);
 	msleep(20);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return;
 }
@@ -1131,6 +1167,9 @@ static int os08a20_probe(struct i2c_client *client,
 	memset(sensor, 0, sizeof(*sensor));
 
 	sensor->i2c_client = client;
+	retval = vvsensor_i2c_init(&sensor->i2c, client, 2, 1);
+	if (retval < 0)
+		return retval;
 
 	sensor->pwn_gpio = of_get_named_gpio(dev->of_node, "pwn-gpios", 0);
 	if (!gpio_is_valid(sensor->pwn_gpio))
@@ -1241,6 +1280,16 @@ static int os08a20_probe(struct i2c_client *client,
 		goto probe_err_power_off;
 	}
 
+	vvsensor_i2c_add_modes(&sensor->i2c, pos08a20_mode_info,
+			ARRAY_SIZE(pos08a20_mode_info));
+	sensor->i2c.ranges = os08a20_i2c_ranges;
+	sensor->i2c.nranges = ARRAY_SIZE(os08a20_i2c_ranges);
+	retval = vvsensor_i2c_add_diffs(&sensor->i2c);
+	if (retval == 0)
+		retval = vvsensor_i2c_add_cache(&sensor->i2c);
+	if (retval < 0)
+		goto probe_err_power_off;
+
 	sd = &sensor->subdev;
 	v4l2_i2c_subdev_init(sd, client, &os08a20_subdev_ops);
 	sd->flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
@@ -1268,6 +1317,8 @@ static int os08a20_probe(struct i2c_client *client,
 			sizeof(struct vvcam_mode_info_s));
 
 	mutex_init(&sensor->lock);
+	vvsensor_sync_init(&sensor->sync, sensor->csi_id, os08a20_sync_apply);
+	sensor->sync.apply_group = os08a20_sync_apply_group;
 	pr_info("%s camera mipi os08a20, is found\n", __func__);
 
 	return 0;
@@ -1276,6 +1327,7 @@ probe_err_free_entiny:
 	media_entity_cleanup(&sd->entity);
 
 probe_err_power_off:
+	vvsensor_i2c_exit(&sensor->i2c);
 	os08a20_power_off(sensor);
 
 probe_err_regulator_disable:
@@ -1292,6 +1344,8 @@ static int os08a20_remove(struct i2c_client *client)
 	pr_info("enter %s\n", __func__);
 
 	v4l2_async_unregister_subdev(sd);
+	vvsensor_sync_exit(&sensor->sync);
+	vvsensor_i2c_exit(&sensor->i2c);
 	media_entity_cleanup(&sd->entity);
 	os08a20_power_off(sensor);
 	os08a20_regulator_disable(sensor);
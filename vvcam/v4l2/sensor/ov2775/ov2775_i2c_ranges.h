@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+
+#ifndef _VVCAM_OV2775_I2C_RANGES_H_
+#define _VVCAM_OV2775_I2C_RANGES_H_
+
+#include "vvsensor_i2c.h"
+
+/* mode switches always rewrite stream, pll and the runtime controls,
+ * the group registers read back from the sensor */
+static const struct vvsensor_reg_range ov2775_i2c_ranges[] = {
+	{0x3000, 0x3012, VVSENSOR_REG_SWITCH},
+	{0x3013, 0x3013, VVSENSOR_REG_TRIGGER},
+	{0x303a, 0x303a, VVSENSOR_REG_SWITCH},
+	{0x30b2, 0x30bb, VVSENSOR_REG_SWITCH},
+	{0x315a, 0x315f, VVSENSOR_REG_SWITCH},
+	{0x3253, 0x3253, VVSENSOR_REG_SWITCH},
+	{0x3360, 0x339b, VVSENSOR_REG_SWITCH},
+	{0x3464, 0x3464, VVSENSOR_REG_SWITCH | VVSENSOR_REG_VOLATILE},
+	{0x3467, 0x3467, VVSENSOR_REG_SWITCH | VVSENSOR_REG_VOLATILE},
+};
+
+static struct vvcam_sccb_data_s ov2775_soft_reset[] = {
+	{0x3013, 0x01},
+	{VVSENSOR_REG_DELAY, 20},
+};
+
+#endif
@@ -30,12 +30,19 @@
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include "vvsensor.h"
+#include "vvsensor_sync.h"
+#include "vvsensor_i2c.h"
 
 #include "ov2775_regs_1080p.h"
 #include "ov2775_regs_1080p_hdr.h"
 #include "ov2775_regs_1080p_hdr_low_freq.h"
 #include "ov2775_regs_1080p_native_hdr.h"
 #include "ov2775_regs_1080p_hdr_2dol.h"
+#include "ov2775_i2c_ranges.h"
+
+#define VVSENSOR_TRACE_SYSTEM vvcam_ov2775
+#define CREATE_TRACE_POINTS
+#include "vvsensor_trace.h"
 
 #define OV2775_VOLTAGE_ANALOG			2800000
 #define OV2775_VOLTAGE_DIGITAL_CORE		1500000
@@ -84,6 +91,8 @@ struct ov2775 {
 	u32 resume_status;
 	u32 hcg_again;
 	u32 hcg_dgain;
+	struct vvsensor_sync sync;
+	struct vvsensor_i2c i2c;
 };
 
 static struct vvcam_mode_info_s pov2775_mode_info[] = {
@@ -385,6 +394,7 @@ static int ov2775_power_off(struct ov2775 *sensor)
 	if (gpio_is_valid(sensor->pwn_gpio))
 		gpio_set_value_cansleep(sensor->pwn_gpio, 0);
 	clk_disable_unprepare(sensor->sensor_clk);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return 0;
 }
@@ -405,101 +415,74 @@ static int ov2775_s_power(struct v4l2_subdev *sd, int on)
 
 static int ov2775_write_reg(struct ov2775 *sensor, u16 reg, u8 val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8Buf[3] = { 0 };
-
-	au8Buf[0] = reg >> 8;
-	au8Buf[1] = reg & 0xff;
-	au8Buf[2] = val;
-
-	if (i2c_master_send(sensor->i2c_client, au8Buf, 3) < 0) {
-		dev_err(dev, "Write reg error: reg=%x, val=%x\n", reg, val);
-		return -1;
-	}
-
-	return 0;
+	return vvsensor_i2c_write(&sensor->i2c, reg, val);
 }
 
 static int ov2775_read_reg(struct ov2775 *sensor, u16 reg, u8 *val)
 {
-	struct device *dev = &sensor->i2c_client->dev;
-	u8 au8RegBuf[2] = { 0 };
-	u8 u8RdVal = 0;
-
-	au8RegBuf[0] = reg >> 8;
-	au8RegBuf[1] = reg & 0xff;
-
-	if (i2c_master_send(sensor->i2c_client, au8RegBuf, 2) != 2) {
-		dev_err(dev, "Read reg error: reg=%x\n", reg);
-		return -1;
-	}
-
-	if (i2c_master_recv(sensor->i2c_client, &u8RdVal, 1) != 1) {
-		dev_err(dev, "Read reg error: reg=%x, val=%x\n", reg, u8RdVal);
-		return -1;
-	}
+	u32 data;
+	int ret;
 
-	*val = u8RdVal;
+	ret = vvsensor_i2c_read(&sensor->i2c, reg, &data);
+	if (ret == 0)
+		*val = data;
 
-	return 0;
+	return ret;
 }
 
 static int ov2775_write_reg_arry(struct ov2775 *sensor,
 				 struct vvcam_sccb_data_s *reg_arry,
 				 u32 size)
 {
-	int i = 0;
-	int ret = 0;
-	struct i2c_msg msg;
-	u8 *send_buf;
-	u32 send_buf_len = 0;
-	struct i2c_client *i2c_client = sensor->i2c_client;
+	return vvsensor_i2c_write_table(&sensor->i2c, reg_arry, size);
+}
 
-	send_buf = (u8 *)kmalloc(size + 2, GFP_KERNEL);
-	if (!send_buf)
-		return -ENOMEM;
+/* the block of 0x7000+ registers that must be resent after standby */
+static struct vvcam_sccb_data_s *ov2775_standby_regs(
+	struct vvcam_sccb_data_s *reg_arry, u32 size, u32 *count)
+{
+	u32 first, last;
 
-	send_buf[send_buf_len++] = (reg_arry[0].addr >> 8) & 0xff;
-	send_buf[send_buf_len++] = reg_arry[0].addr & 0xff;
-	send_buf[send_buf_len++] = reg_arry[0].data & 0xff;
-	for (i=1; i < size; i++) {
-		if (reg_arry[i].addr == (reg_arry[i-1].addr + 1)){
-			send_buf[send_buf_len++] = reg_arry[i].data & 0xff;
-		} else {
-			msg.addr  = i2c_client->addr;
-			msg.flags = i2c_client->flags;
-			msg.buf   = send_buf;
-			msg.len   = send_buf_len;
-			ret = i2c_transfer(i2c_client->adapter, &msg, 1);
-			if (ret < 0) {
-				pr_err("%s:i2c transfer error\n",__func__);
-				kfree(send_buf);
-				return ret;
-			}
-			send_buf_len = 0;
-			send_buf[send_buf_len++] =
-				(reg_arry[i].addr >> 8) & 0xff;
-			send_buf[send_buf_len++] =
-				reg_arry[i].addr & 0xff;
-			send_buf[send_buf_len++] =
-				reg_arry[i].data & 0xff;
-		}
-	}
+	for (first = 0; first < size; first++)
+		if (reg_arry[first].addr >= 0x7000)
+			break;
+	for (last = first; last < size; last++)
+		if (reg_arry[last].addr < 0x7000)
+			break;
 
-	if (send_buf_len > 0) {
-		msg.addr  = i2c_client->addr;
-		msg.flags = i2c_client->flags;
-		msg.buf   = send_buf;
-		msg.len   = send_buf_len;
-		ret = i2c_transfer(i2c_client->adapter, &msg, 1);
-		if (ret < 0)
-			pr_err("%s:i2c transfer end meg error\n",__func__);
-		else
-			ret = 0;
+	*count = last - first;
+	return &reg_arry[first];
+}
+
+static int ov2775_add_tables(struct ov2775 *sensor)
+{
+	struct vvcam_sccb_data_s *regs;
+	u32 i, n;
+	int ret;
 
+	vvsensor_i2c_add_modes(&sensor->i2c, pov2775_mode_info,
+			ARRAY_SIZE(pov2775_mode_info));
+	vvsensor_i2c_add_mode(&sensor->i2c,
+			ov2775_init_setting_1080p_hdr_low_freq,
+			ARRAY_SIZE(ov2775_init_setting_1080p_hdr_low_freq));
+
+	for (i = 0; i < ARRAY_SIZE(pov2775_mode_info); i++) {
+		regs = ov2775_standby_regs(pov2775_mode_info[i].preg_data,
+				pov2775_mode_info[i].reg_data_count, &n);
+		if (n)
+			vvsensor_i2c_add_table(&sensor->i2c, regs, n);
 	}
-	kfree(send_buf);
-	return ret;
+	regs = ov2775_standby_regs(ov2775_init_setting_1080p_hdr_low_freq,
+			ARRAY_SIZE(ov2775_init_setting_1080p_hdr_low_freq), &n);
+	if (n)
+		vvsensor_i2c_add_table(&sensor->i2c, regs, n);
+
+	sensor->i2c.ranges = ov2775_i2c_ranges;
+	sensor->i2c.nranges = ARRAY_SIZE(ov2775_i2c_ranges);
+	ret = vvsensor_i2c_add_diffs(&sensor->i2c);
+	if (ret)
+		return ret;
+	return vvsensor_i2c_add_cache(&sensor->i2c);
 }
 
 static int ov2775_query_capability(struct ov2775 *sensor, void *arg)
@@ -657,27 +640,32 @@ static int ov2775_set_lgain(struct ov2775 *sensor, u32 gain)
 	return 0;
 }
 
-static int ov2775_set_gain(struct ov2775 *sensor, u32 gain)
+static void ov2775_calc_gain(u32 gain, u32 *again, u32 *dgain)
 {
-	int ret = 0;
-	u32 again = 0;
-	u32 dgain = 0;
-	u8 reg_val;
-
 	if (gain < (3 << 10)){
 		gain = 3  << 10;
 	}
 
 	if (gain < (3 << 10)) {
-		again = 0;
+		*again = 0;
 	} else if (gain < (6 << 10)) {
-		again = 1;
+		*again = 1;
 	} else if (gain < (12 << 10)) {
-		again = 2;
+		*again = 2;
 	} else {
-		again = 3;
+		*again = 3;
 	}
-	dgain = (gain * 0x100) / (( 1<< again) << 10);
+	*dgain = (gain * 0x100) / (( 1<< *again) << 10);
+}
+
+static int ov2775_set_gain(struct ov2775 *sensor, u32 gain)
+{
+	int ret = 0;
+	u32 again = 0;
+	u32 dgain = 0;
+	u8 reg_val;
+
+	ov2775_calc_gain(gain, &again, &dgain);
 
 	if (sensor->cur_mode.hdr_mode == SENSOR_MODE_LINEAR) {
 		ret = ov2775_read_reg(sensor, 0x30bb, &reg_val);
@@ -727,20 +715,7 @@ static int ov2775_set_vsgain(struct ov2775 *sensor, u32 gain)
 	u32 dgain = 0;
 	u8 reg_val;
 
-	if (gain < (3 << 10)) {
-		gain = (3 << 10);
-	}
-
-	if (gain < (3 << 10)) {
-		again = 0;
-	} else if (gain < (6 << 10)) {
-		again = 1;
-	} else if (gain < (12 << 10)) {
-		again = 2;
-	} else {
-		again = 3;
-	}
-	dgain = (gain * 0x100) / ((1 << again) << 10);
+	ov2775_calc_gain(gain, &again, &dgain);
 
 	ret = ov2775_read_reg(sensor, 0x30bb, &reg_val);
 	reg_val &= ~0x30;
@@ -759,10 +734,10 @@ static int ov2775_set_vsgain(struct ov2775 *sensor, u32 gain)
 	return ret;
 }
 
-static int ov2775_set_fps(struct ov2775 *sensor, u32 fps)
+/* clamps fps to the mode and updates the ae info, returns the frame length */
+static u32 ov2775_calc_vts(struct ov2775 *sensor, u32 fps)
 {
 	u32 vts;
-	int ret = 0;
 
 	if (fps > sensor->cur_mode.ae_info.max_fps) {
 		fps = sensor->cur_mode.ae_info.max_fps;
@@ -773,9 +748,6 @@ static int ov2775_set_fps(struct ov2775 *sensor, u32 fps)
 	vts = sensor->cur_mode.ae_info.max_fps *
 	      sensor->cur_mode.ae_info.def_frm_len_lines / fps;
 
-	ret = ov2775_write_reg(sensor, 0x30B2, (u8)(vts >> 8) & 0xff);
-	ret |= ov2775_write_reg(sensor, 0x30B3, (u8)(vts & 0xff));
-
 	sensor->cur_mode.ae_info.cur_fps = fps;
 
 	if (sensor->cur_mode.hdr_mode == SENSOR_MODE_LINEAR) {
@@ -791,6 +763,17 @@ static int ov2775_set_fps(struct ov2775 *sensor, u32 fps)
 		}
 	}
 	sensor->cur_mode.ae_info.curr_frm_len_lines = vts;
+	return vts;
+}
+
+static int ov2775_set_fps(struct ov2775 *sensor, u32 fps)
+{
+	u32 vts;
+	int ret = 0;
+
+	vts = ov2775_calc_vts(sensor, fps);
+	ret = ov2775_write_reg(sensor, 0x30B2, (u8)(vts >> 8) & 0xff);
+	ret |= ov2775_write_reg(sensor, 0x30B3, (u8)(vts & 0xff));
 	return ret;
 }
 
@@ -1082,86 +1065,153 @@ static int ov2775_get_format_code(struct ov2775 *sensor, u32 *code)
 	return 0;
 }
 
+static int ov2775_sync_apply(struct vvsensor_sync *sync, u32 cmd, u32 value)
+{
+	struct ov2775 *sensor = container_of(sync, struct ov2775, sync);
+
+	switch (cmd) {
+	case VVSENSORIOC_S_LONG_EXP:
+		return ov2775_set_lexp(sensor, value);
+	case VVSENSORIOC_S_EXP:
+		return ov2775_set_exp(sensor, value);
+	case VVSENSORIOC_S_VSEXP:
+		return ov2775_set_vsexp(sensor, value);
+	case VVSENSORIOC_S_LONG_GAIN:
+		return ov2775_set_lgain(sensor, value);
+	case VVSENSORIOC_S_GAIN:
+		return ov2775_set_gain(sensor, value);
+	case VVSENSORIOC_S_VSGAIN:
+		return ov2775_set_vsgain(sensor, value);
+	case VVSENSORIOC_S_FPS:
+		return ov2775_set_fps(sensor, value);
+	default:
+		return -EINVAL;
+	}
+}
+
+#define OV2775_REG(a, d) \
+	do { \
+		regs[n].addr = (a); \
+		regs[n++].data = (d) & 0xff; \
+	} while (0)
+
+/* the writes of ov2775_set_* in one group hold instead of one each, in
+ * address order so that ov2775_write_reg_arry bursts each run */
+static int ov2775_sync_apply_group(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w, u32 n_writes)
+{
+	struct ov2775 *sensor = container_of(sync, struct ov2775, sync);
+	struct vvcam_sccb_data_s regs[24];
+	u32 val[VVSENSOR_SYNC_NUM] = { 0 };
+	u32 mask = 0, again, dgain, vts;
+	u32 dgain_315a = 0, dgain_315c = 0, dgain_315e = 0;
+	u32 i, n = 0;
+	u8 reg_val = 0;
+	int ret;
+
+	for (i = 0; i < n_writes; ++i) {
+		val[w[i].cmd - VVSENSORIOC_S_LONG_EXP] = w[i].value;
+		mask |= 1 << (w[i].cmd - VVSENSORIOC_S_LONG_EXP);
+	}
+	/* long exposure is a no-op and long gain only sets hcg_*, which the
+	 * gain write below picks up */
+	if (mask & BIT(VVSENSOR_SYNC_LONG_GAIN))
+		ov2775_set_lgain(sensor, val[VVSENSOR_SYNC_LONG_GAIN]);
+	if (mask & (BIT(VVSENSOR_SYNC_GAIN) | BIT(VVSENSOR_SYNC_VSGAIN))) {
+		ret = ov2775_read_reg(sensor, 0x30bb, &reg_val);
+		if (ret)
+			return ret;
+	}
+
+	OV2775_REG(0x3467, 0x00);
+	OV2775_REG(0x3464, 0x04);
+	if (mask & BIT(VVSENSOR_SYNC_FPS)) {
+		vts = ov2775_calc_vts(sensor, val[VVSENSOR_SYNC_FPS]);
+		OV2775_REG(0x30b2, vts >> 8);
+		OV2775_REG(0x30b3, vts);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_EXP)) {
+		OV2775_REG(0x30b6, val[VVSENSOR_SYNC_EXP] >> 8);
+		OV2775_REG(0x30b7, val[VVSENSOR_SYNC_EXP]);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_VSEXP)) {
+		if (val[VVSENSOR_SYNC_VSEXP] == 0x16)
+			val[VVSENSOR_SYNC_VSEXP] = 0x17;
+		OV2775_REG(0x30b8, val[VVSENSOR_SYNC_VSEXP] >> 8);
+		OV2775_REG(0x30b9, val[VVSENSOR_SYNC_VSEXP]);
+	}
+	if (mask & BIT(VVSENSOR_SYNC_GAIN)) {
+		ov2775_calc_gain(val[VVSENSOR_SYNC_GAIN], &again, &dgain);
+		if (sensor->cur_mode.hdr_mode == SENSOR_MODE_LINEAR) {
+			reg_val &= ~0x03;
+			reg_val |= again & 0x03;
+			dgain_315a = dgain;
+		} else {
+			reg_val &= ~0x0f;
+			reg_val |= sensor->hcg_again & 0x03;
+			reg_val |= (again & 0x03) << 2;
+			dgain_315a = sensor->hcg_dgain;
+			dgain_315c = dgain;
+		}
+	}
+	if (mask & BIT(VVSENSOR_SYNC_VSGAIN)) {
+		ov2775_calc_gain(val[VVSENSOR_SYNC_VSGAIN], &again, &dgain);
+		reg_val &= ~0x30;
+		reg_val |= (again & 0x03) << 4;
+		dgain_315e = dgain;
+	}
+	if (mask & (BIT(VVSENSOR_SYNC_GAIN) | BIT(VVSENSOR_SYNC_VSGAIN)))
+		OV2775_REG(0x30bb, reg_val);
+	if (mask & BIT(VVSENSOR_SYNC_GAIN)) {
+		OV2775_REG(0x315a, dgain_315a >> 8);
+		OV2775_REG(0x315b, dgain_315a);
+		if (sensor->cur_mode.hdr_mode != SENSOR_MODE_LINEAR) {
+			OV2775_REG(0x315c, dgain_315c >> 8);
+			OV2775_REG(0x315d, dgain_315c);
+		}
+	}
+	if (mask & BIT(VVSENSOR_SYNC_VSGAIN)) {
+		OV2775_REG(0x315e, dgain_315e >> 8);
+		OV2775_REG(0x315f, dgain_315e);
+	}
+	OV2775_REG(0x3464, 0x14);
+	OV2775_REG(0x3467, 0x01);
+
+	return ov2775_write_reg_arry(sensor, regs, n);
+}
+
+#undef OV2775_REG
+
 static int ov2775_s_stream(struct v4l2_subdev *sd, int enable)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(sd);
 	struct ov2775 *sensor = client_to_ov2775(client);
-	struct i2c_msg msg;
-	u8 *i2c_send_buf;
-	u32 i2c_send_buf_len = 0;
 	struct vvcam_sccb_data_s *sensor_reg_cfg;
 	u32 sensor_reg_size = 0;
-	int i = 0;
 	int ret;
 
 	pr_debug("enter %s\n", __func__);
 	sensor->stream_status = enable;
 	if (enable) {
 		ov2775_write_reg(sensor, 0x3012, 0x01);
+		vvsensor_sync_start(&sensor->sync, &sensor->cur_mode.ae_info);
 	} else  {
+		vvsensor_sync_stop(&sensor->sync);
 		ov2775_write_reg(sensor, 0x3012, 0x00);
 		msleep(100);
 		/* if the sensor re-enter streaming from standby mode
 		* all registers starting with 0x7000 must be resent
 		* before setting 0x3012[0]=1.
 		*/
-		sensor_reg_cfg =
-			(struct vvcam_sccb_data_s *)sensor->cur_mode.preg_data;
-		sensor_reg_size = sensor->cur_mode.reg_data_count;
-
-		i2c_send_buf = (u8 *)kmalloc(sensor_reg_size + 2, GFP_KERNEL);
-		if (!i2c_send_buf) {
-			pr_err("%s:kmalloc i2c_send_buf failed\n",__func__);
-			return -ENOMEM;
-		}
-		for (i = 0; i < sensor_reg_size; i++) {
-			if (sensor_reg_cfg[i].addr >= 0x7000) {
-				if (i2c_send_buf_len == 0) {
-					i2c_send_buf[i2c_send_buf_len++] =
-						(sensor_reg_cfg[i].addr >> 8) & 0xff;
-					i2c_send_buf[i2c_send_buf_len++] =
-						sensor_reg_cfg[i].addr & 0xff;
-					i2c_send_buf[i2c_send_buf_len++] =
-						sensor_reg_cfg[i].data & 0xff;
-				} else {
-					if (sensor_reg_cfg[i].addr == (sensor_reg_cfg[i-1].addr + 1)) {
-						i2c_send_buf[i2c_send_buf_len++] =
-							sensor_reg_cfg[i].data & 0xff;
-					} else {
-						msg.addr	= client->addr;
-						msg.flags	= client->flags;
-						msg.buf 	= i2c_send_buf;
-						msg.len 	= i2c_send_buf_len;
-						ret = i2c_transfer(client->adapter, &msg, 1);
-						if (ret < 0) {
-							kfree(i2c_send_buf);
-							pr_err("%s:i2c transfer error\n",__func__);
-							return -EBUSY;
-						}
-						i2c_send_buf_len = 0;
-						i2c_send_buf[i2c_send_buf_len++] =
-							(sensor_reg_cfg[i].addr >> 8) & 0xff;
-						i2c_send_buf[i2c_send_buf_len++] =
-							sensor_reg_cfg[i].addr & 0xff;
-						i2c_send_buf[i2c_send_buf_len++] =
-							sensor_reg_cfg[i].data & 0xff;
-					}
-				}
-			}
-		}
-		if (i2c_send_buf_len > 0) {
-			msg.addr	= client->addr;
-			msg.flags	= client->flags;
-			msg.buf 	= i2c_send_buf;
-			msg.len 	= i2c_send_buf_len;
-			ret = i2c_transfer(client->adapter, &msg, 1);
-			if (ret < 0) {
-				kfree(i2c_send_buf);
-				pr_err("%s:i2c transfer error\n",__func__);
+		sensor_reg_cfg = ov2775_standby_regs(
+			(struct vvcam_sccb_data_s *)sensor->cur_mode.preg_data,
+			sensor->cur_mode.reg_data_count, &sensor_reg_size);
+		if (sensor_reg_size) {
+			ret = ov2775_write_reg_arry(sensor, sensor_reg_cfg,
+					sensor_reg_size);
+			if (ret < 0)
 				return -EBUSY;
-			}
 		}
-		kfree(i2c_send_buf);
 	}
 
 	return 0;
@@ -1213,14 +1263,12 @@ static int ov2775_set_fmt(struct v4l2_subdev *sd,
 	}
 
 	ov2775_write_reg(sensor, 0x3012, 0x00);
-	ov2775_write_reg(sensor, 0x3013, 0x01);
-	msleep(20);
-
-	ret = ov2775_write_reg_arry(sensor,
+	ret = vvsensor_i2c_write_mode(&sensor->i2c,
+		ov2775_soft_reset, ARRAY_SIZE(ov2775_soft_reset),
 		(struct vvcam_sccb_data_s *)sensor->cur_mode.preg_data,
 		sensor->cur_mode.reg_data_count);
 	if (ret < 0) {
-		pr_err("%s:ov2775_write_reg_arry error\n",__func__);
+		pr_err("%s:vvsensor_i2c_write_mode error\n",__func__);
 		mutex_unlock(&sensor->lock);
 		return -EINVAL;
 	}
@@ -1262,6 +1310,7 @@ static long ov2775_priv_ioctl(struct v4l2_subdev *sd,
 	uint32_t value = 0;
 	sensor_blc_t blc;
 	sensor_expand_curve_t expand_curve;
+	struct vvcam_ae_group_s ae_group;
 
 	mutex_lock(&sensor->lock);
 	switch (cmd){
@@ -1290,10 +1339,14 @@ static long ov2775_priv_ioctl(struct v4l2_subdev *sd,
 		ret = ov2775_get_reserve_id(sensor, arg);
 		break;
 	case VVSENSORIOC_G_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ov2775_get_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ov2775_set_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_S_STREAM:
 		ret = copy_from_user(&value, arg, sizeof(value));
@@ -1304,6 +1357,7 @@ static long ov2775_priv_ioctl(struct v4l2_subdev *sd,
 			sizeof(struct vvcam_sccb_data_s));
 		ret |= ov2775_write_reg(sensor, sensor_reg.addr,
 			sensor_reg.data);
+		vvsensor_i2c_invalidate(&sensor->i2c);
 		break;
 	case VVSENSORIOC_READ_REG:
 		ret = copy_from_user(&sensor_reg, arg,
@@ -1315,34 +1369,52 @@ static long ov2775_priv_ioctl(struct v4l2_subdev *sd,
 		break;
 	case VVSENSORIOC_S_LONG_EXP:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_lexp(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_EXP:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_exp(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_VSEXP:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_vsexp(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_LONG_GAIN:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_lgain(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_GAIN:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_gain(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
 		break;
 	case VVSENSORIOC_S_VSGAIN:
 		ret = copy_from_user(&value, arg, sizeof(value));
-		ret |= ov2775_set_vsgain(sensor, value);
+		ret |= vvsensor_sync_set(&sensor->sync, cmd, value);
+		trace_sensor_ae(sd->name, cmd, value, ret);
+		break;
+	case VVSENSORIOC_G_AE_SYNC:
+		ret = vvsensor_sync_get(&sensor->sync, arg);
+		break;
+	case VVSENSORIOC_S_AE_GROUP:
+		ret = copy_from_user(&ae_group, arg, sizeof(ae_group));
+		ret |= vvsensor_sync_set_ae(&sensor->sync, &ae_group);
+		trace_sensor_ae(sd->name, cmd, ae_group.mask, ret);
 		break;
 	case VVSENSORIOC_S_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = copy_from_user(&value, arg, sizeof(value));
 		ret |= ov2775_set_fps(sensor, value);
+		vvsensor_sync_unlock(&sensor->sync);
 		break;
 	case VVSENSORIOC_G_FPS:
+		vvsensor_sync_lock(&sensor->sync);
 		ret = ov2775_get_fps(sensor, &value);
+		vvsensor_sync_unlock(&sensor->sync);
 		ret |= copy_to_user(arg, &value, sizeof(value));
 		break;
 	case VVSENSORIOC_S_HDR_RADIO:
@@ -1506,6 +1578,7 @@ static void ov2775_reset(struct ov2775 *sensor)
 
 	gpio_set_value_cansleep(sensor->rst_gpio, 1);
 	msleep(20);
+	vvsensor_i2c_invalidate(&sensor->i2c);
 
 	return;
 }
@@ -1573,6 +1646,9 @@ static int ov2775_probe(struct i2c_client *client,
 	memset(sensor, 0, sizeof(*sensor));
 
 	sensor->i2c_client = client;
+	retval = vvsensor_i2c_init(&sensor->i2c, client, 2, 1);
+	if (retval < 0)
+		return retval;
 
 	sensor->pwn_gpio = of_get_named_gpio(dev->of_node, "pwn-gpios", 0);
 	if (!gpio_is_valid(sensor->pwn_gpio))
@@ -1681,6 +1757,10 @@ static int ov2775_probe(struct i2c_client *client,
 		goto probe_err_power_off;
 	}
 
+	retval = ov2775_add_tables(sensor);
+	if (retval < 0)
+		goto probe_err_power_off;
+
 	sd = &sensor->subdev;
 	v4l2_i2c_subdev_init(sd, client, &ov2775_subdev_ops);
 	sd->flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
@@ -1708,6 +1788,8 @@ static int ov2775_probe(struct i2c_client *client,
 			sizeof(struct vvcam_mode_info_s));
 
 	mutex_init(&sensor->lock);
+	vvsensor_sync_init(&sensor->sync, sensor->csi_id, ov2775_sync_apply);
+	sensor->sync.apply_group = ov2775_sync_apply_group;
 	pr_info("%s camera mipi ov2775, is found\n", __func__);
 
 	return 0;
@@ -1716,6 +1798,7 @@ probe_err_free_entiny:
 	media_entity_cleanup(&sd->entity);
 
 probe_err_power_off:
+	vvsensor_i2c_exit(&sensor->i2c);
 	ov2775_power_off(sensor);
 
 probe_err_regulator_disable:
@@ -1732,6 +1815,8 @@ static int ov2775_remove(struct i2c_client *client)
 	pr_info("enter %s\n", __func__);
 
 	v4l2_async_unregister_subdev(sd);
+	vvsensor_sync_exit(&sensor->sync);
+	vvsensor_i2c_exit(&sensor->i2c);
 	media_entity_cleanup(&sd->entity);
 	ov2775_power_off(sensor);
 	ov2775_regulator_disable(sensor);
@@ -0,0 +1,652 @@
+/*
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ */
+/*
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+/*
+ * Simulated raw sensor for VVCAM_SIM builds.  It answers the same
+ * VVSENSORIOC_* calls as the ov2775/os08a20 drivers, backed by an in-memory
+ * register map instead of i2c, so the isp middleware can drive a pipeline
+ * without a board.  The pixels and the frame timing come from the
+ * simulated isp (see isp_sim.c), not from here.
+ */
+
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/v4l2-mediabus.h>
+#include <media/v4l2-device.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include "vvsensor.h"
+#include "vvsensor_sync.h"
+
+#define VVSENSOR_TRACE_SYSTEM vvcam_vvsim
+#define CREATE_TRACE_POINTS
+#include "vvsensor_trace.h"
+
+#define VVSIM_SENSOR_NAME	"vvcam-sim-sensor"
+#define VVSIM_CHIP_ID		0x565653
+#define VVSIM_REG_NUM		0x10000
+
+#define VVSIM_SENS_PAD_SOURCE	0
+#define VVSIM_SENS_PADS_NUM	1
+
+struct vvsim_sensor {
+	struct v4l2_device v4l2_dev;
+	struct v4l2_subdev subdev;
+	struct media_pad pads[VVSIM_SENS_PADS_NUM];
+
+	struct v4l2_mbus_framefmt format;
+	vvcam_mode_info_t cur_mode;
+	u8 *regs;
+	struct mutex lock;
+	u32 stream_status;
+	struct vvsensor_sync sync;
+};
+
+static struct vvcam_mode_info_s pvvsim_mode_info[] = {
+	{
+		.index	        = 0,
+		.size           = {
+			.bounds_width  = 1920,
+			.bounds_height = 1080,
+			.top           = 0,
+			.left          = 0,
+			.width         = 1920,
+			.height        = 1080,
+		},
+		.hdr_mode       = SENSOR_MODE_LINEAR,
+		.bit_width      = 12,
+		.data_compress  = {
+			.enable = 0,
+		},
+		.bayer_pattern  = BAYER_BGGR,
+		.ae_info = {
+			.def_frm_len_lines     = 0x460,
+			.curr_frm_len_lines    = 0x460,
+			.one_line_exp_time_ns  = 29625,
+			.max_integration_line  = 0x460 - 8,
+			.min_integration_line  = 8,
+			.max_again             = 15.5 * (1 << SENSOR_FIX_FRACBITS),
+			.min_again             = 1    * (1 << SENSOR_FIX_FRACBITS),
+			.max_dgain             = 4    * (1 << SENSOR_FIX_FRACBITS),
+			.min_dgain             = 1    * (1 << SENSOR_FIX_FRACBITS),
+			.start_exposure        = 1 * 100 * (1 << SENSOR_FIX_FRACBITS),
+			.cur_fps               = 30   * (1 << SENSOR_FIX_FRACBITS),
+			.max_fps               = 30   * (1 << SENSOR_FIX_FRACBITS),
+			.min_fps               = 1    * (1 << SENSOR_FIX_FRACBITS),
+			.min_afps              = 5    * (1 << SENSOR_FIX_FRACBITS),
+			.int_update_delay_frm  = 1,
+			.gain_update_delay_frm = 1,
+		},
+		.mipi_info = {
+			.mipi_lane = 4,
+		},
+		.preg_data      = NULL,
+		.reg_data_count = 0,
+	},
+};
+
+static struct platform_device *vvsim_pdev;
+
+static inline struct vvsim_sensor *to_vvsim(struct v4l2_subdev *sd)
+{
+	return container_of(sd, struct vvsim_sensor, subdev);
+}
+
+static int vvsim_write_reg(struct vvsim_sensor *sensor, u16 reg, u8 val)
+{
+	sensor->regs[reg] = val;
+	return 0;
+}
+
+static int vvsim_read_reg(struct vvsim_sensor *sensor, u16 reg, u8 *val)
+{
+	*val = sensor->regs[reg];
+	return 0;
+}
+
+static int vvsim_s_power(struct v4l2_subdev *sd, int on)
+{
+	return 0;
+}
+
+static int vvsim_get_clk(struct vvsim_sensor *sensor, void *clk)
+{
+	struct vvcam_clk_s vvcam_clk;
+	int ret = 0;
+
+	memset(&vvcam_clk, 0, sizeof(vvcam_clk));
+	vvcam_clk.sensor_mclk = 24000000;
+	vvcam_clk.csi_max_pixel_clk = 500000000;
+	ret = copy_to_user(clk, &vvcam_clk, sizeof(struct vvcam_clk_s));
+	if (ret != 0)
+		ret = -EINVAL;
+	return ret;
+}
+
+static int vvsim_query_capability(struct vvsim_sensor *sensor, void *arg)
+{
+	struct v4l2_capability *pcap = (struct v4l2_capability *)arg;
+
+	strcpy((char *)pcap->driver, "vvsim");
+	sprintf((char *)pcap->bus_info, "csi%d", 0);
+	pcap->bus_info[VVCAM_CAP_BUS_INFO_I2C_ADAPTER_NR_POS] = 0xFF;
+	return 0;
+}
+
+static int vvsim_query_supports(struct vvsim_sensor *sensor, void *parry)
+{
+	int ret = 0;
+	struct vvcam_mode_info_array_s *psensor_mode_arry = parry;
+
+	psensor_mode_arry->count = ARRAY_SIZE(pvvsim_mode_info);
+	ret = copy_to_user(&psensor_mode_arry->modes, pvvsim_mode_info,
+			   sizeof(pvvsim_mode_info));
+	if (ret != 0)
+		ret = -ENOMEM;
+	return ret;
+}
+
+static int vvsim_get_sensor_id(struct vvsim_sensor *sensor, void *pchip_id)
+{
+	int ret = 0;
+	u32 chip_id;
+	u8 chip_id_high = 0;
+	u8 chip_id_middle = 0;
+	u8 chip_id_low = 0;
+
+	ret  = vvsim_read_reg(sensor, 0x300a, &chip_id_high);
+	ret |= vvsim_read_reg(sensor, 0x300b, &chip_id_middle);
+	ret |= vvsim_read_reg(sensor, 0x300c, &chip_id_low);
+
+	chip_id = ((chip_id_high & 0xff) << 16) |
+		((chip_id_middle & 0xff) << 8) | (chip_id_low & 0xff);
+
+	ret = copy_to_user(pchip_id, &chip_id, sizeof(u32));
+	if (ret != 0)
+		ret = -ENOMEM;
+	return ret;
+}
+
+static int vvsim_get_reserve_id(struct vvsim_sensor *sensor, void *preserve_id)
+{
+	int ret = 0;
+	u32 reserve_id = VVSIM_CHIP_ID;
+
+	ret = copy_to_user(preserve_id, &reserve_id, sizeof(u32));
+	if (ret != 0)
+		ret = -ENOMEM;
+	return ret;
+}
+
+static int vvsim_get_sensor_mode(struct vvsim_sensor *sensor, void *pmode)
+{
+	int ret = 0;
+
+	ret = copy_to_user(pmode, &sensor->cur_mode,
+		sizeof(struct vvcam_mode_info_s));
+	if (ret != 0)
+		ret = -ENOMEM;
+	return ret;
+}
+
+static int vvsim_set_sensor_mode(struct vvsim_sensor *sensor, void *pmode)
+{
+	int ret = 0;
+	int i = 0;
+	struct vvcam_mode_info_s sensor_mode;
+
+	ret = copy_from_user(&sensor_mode, pmode,
+		sizeof(struct vvcam_mode_info_s));
+	if (ret != 0)
+		return -ENOMEM;
+	for (i = 0; i < ARRAY_SIZE(pvvsim_mode_info); i++) {
+		if (pvvsim_mode_info[i].index == sensor_mode.index) {
+			memcpy(&sensor->cur_mode, &pvvsim_mode_info[i],
+				sizeof(struct vvcam_mode_info_s));
+			return 0;
+		}
+	}
+
+	return -ENXIO;
+}
+
+static int vvsim_set_exp(struct vvsim_sensor *sensor, u32 exp, u16 reg)
+{
+	int ret = 0;
+
+	ret |= vvsim_write_reg(sensor, reg, (exp >> 8) & 0xff);
+	ret |= vvsim_write_reg(sensor, reg + 1, exp & 0xff);
+
+	return ret;
+}
+
+/* the total gain is kept as is, there is no analog/digital split to model */
+static int vvsim_set_gain(struct vvsim_sensor *sensor, u32 total_gain, u16 reg)
+{
+	int ret = 0;
+
+	ret |= vvsim_write_reg(sensor, reg, (total_gain >> 24) & 0xff);
+	ret |= vvsim_write_reg(sensor, reg + 1, (total_gain >> 16) & 0xff);
+	ret |= vvsim_write_reg(sensor, reg + 2, (total_gain >> 8) & 0xff);
+	ret |= vvsim_write_reg(sensor, reg + 3, total_gain & 0xff);
+
+	return ret;
+}
+
+static int vvsim_set_fps(struct vvsim_sensor *sensor, u32 fps)
+{
+	u32 vts;
+	int ret = 0;
+
+	if (fps > sensor->cur_mode.ae_info.max_fps)
+		fps = sensor->cur_mode.ae_info.max_fps;
+	else if (fps < sensor->cur_mode.ae_info.min_fps)
+		fps = sensor->cur_mode.ae_info.min_fps;
+	vts = sensor->cur_mode.ae_info.max_fps *
+	      sensor->cur_mode.ae_info.def_frm_len_lines / fps;
+
+	ret = vvsim_write_reg(sensor, 0x380e, (u8)(vts >> 8) & 0xff);
+	ret |= vvsim_write_reg(sensor, 0x380f, (u8)(vts & 0xff));
+
+	sensor->cur_mode.ae_info.cur_fps = fps;
+	sensor->cur_mode.ae_info.max_integration_line = vts - 8;
+	sensor->cur_mode.ae_info.curr_frm_len_lines = vts;
+	return ret;
+}
+
+static int vvsim_get_fps(struct vvsim_sensor *sensor, u32 *pfps)
+{
+	*pfps = sensor->cur_mode.ae_info.cur_fps;
+	return 0;
+}
+
+static int vvsim_set_test_pattern(struct vvsim_sensor *sensor, void *arg)
+{
+	int ret;
+	struct sensor_test_pattern_s test_pattern;
+
+	ret = copy_from_user(&test_pattern, arg, sizeof(test_pattern));
+	if (ret != 0)
+		return -ENOMEM;
+	if (test_pattern.enable && test_pattern.pattern > 4)
+		return -1;
+
+	vvsim_write_reg(sensor, 0x5081, test_pattern.enable ?
+			0x80 | test_pattern.pattern : 0x00);
+	return 0;
+}
+
+static int vvsim_sync_apply(struct vvsensor_sync *sync, u32 cmd, u32 value)
+{
+	struct vvsim_sensor *sensor =
+		container_of(sync, struct vvsim_sensor, sync);
+
+	switch (cmd) {
+	case VVSENSORIOC_S_EXP:
+		return vvsim_set_exp(sensor, value, 0x3501);
+	case VVSENSORIOC_S_VSEXP:
+		return vvsim_set_exp(sensor, value, 0x3511);
+	case VVSENSORIOC_S_GAIN:
+		return vvsim_set_gain(sensor, value, 0x3508);
+	case VVSENSORIOC_S_VSGAIN:
+		return vvsim_set_gain(sensor, value, 0x350c);
+	case VVSENSORIOC_S_FPS:
+		return vvsim_set_fps(sensor, value);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int vvsim_s_stream(struct v4l2_subdev *sd, int enable)
+{
+	struct vvsim_sensor *sensor = to_vvsim(sd);
+
+	if (!enable)
+		vvsensor_sync_stop(&sensor->sync);
+	vvsim_write_reg(sensor, 0x0100, enable ? 0x01 : 0x00);
+	if (enable)
+		vvsensor_sync_start(&sensor->sync, &sensor->cur_mode.ae_info);
+	sensor->stream_status = enable;
+	return 0;
+}
+
+static u32 vvsim_get_format_code(struct vvsim_sensor *sensor)
+{
+	switch (sensor->cur_mode.bit_width) {
+	case 8:
+		return MEDIA_BUS_FMT_SBGGR8_1X8;
+	case 10:
+		return MEDIA_BUS_FMT_SBGGR10_1X10;
+	default:
+		return MEDIA_BUS_FMT_SBGGR12_1X12;
+	}
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int vvsim_enum_mbus_code(struct v4l2_subdev *sd,
+				struct v4l2_subdev_state *state,
+				struct v4l2_subdev_mbus_code_enum *code)
+#else
+static int vvsim_enum_mbus_code(struct v4l2_subdev *sd,
+				struct v4l2_subdev_pad_config *cfg,
+				struct v4l2_subdev_mbus_code_enum *code)
+#endif
+{
+	if (code->index > 0)
+		return -EINVAL;
+	code->code = vvsim_get_format_code(to_vvsim(sd));
+	return 0;
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int vvsim_set_fmt(struct v4l2_subdev *sd,
+			 struct v4l2_subdev_state *state,
+			 struct v4l2_subdev_format *fmt)
+#else
+static int vvsim_set_fmt(struct v4l2_subdev *sd,
+			 struct v4l2_subdev_pad_config *cfg,
+			 struct v4l2_subdev_format *fmt)
+#endif
+{
+	struct vvsim_sensor *sensor = to_vvsim(sd);
+
+	mutex_lock(&sensor->lock);
+	if ((fmt->format.width != sensor->cur_mode.size.bounds_width) ||
+	    (fmt->format.height != sensor->cur_mode.size.bounds_height)) {
+		pr_err("%s:set sensor format %dx%d error\n",
+			__func__, fmt->format.width, fmt->format.height);
+		mutex_unlock(&sensor->lock);
+		return -EINVAL;
+	}
+
+	fmt->format.code = vvsim_get_format_code(sensor);
+	fmt->format.field = V4L2_FIELD_NONE;
+	sensor->format = fmt->format;
+	mutex_unlock(&sensor->lock);
+	return 0;
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 12, 0)
+static int vvsim_get_fmt(struct v4l2_subdev *sd,
+			 struct v4l2_subdev_state *state,
+			 struct v4l2_subdev_format *fmt)
+#else
+static int vvsim_get_fmt(struct v4l2_subdev *sd,
+			 struct v4l2_subdev_pad_config *cfg,
+			 struct v4l2_subdev_format *fmt)
+#endif
+{
+	struct vvsim_sensor *sensor = to_vvsim(sd);
+
+	mutex_lock(&sensor->lock);
+	fmt->format = sensor->format;
+	mutex_unlock(&sensor->lock);
+	return 0;
+}
+
+static long vvsim_priv_ioctl(struct v4l2_subdev *sd,
+			     unsigned int cmd,
+			     void *arg)
+{
+	struct vvsim_sensor *sensor = to_vvsim(sd);
+	long ret = 0;
+	struct vvcam_sccb_data_s sensor_reg;
+	struct vvcam_ae_group_s ae_group;
+
+	mutex_lock(&sensor->lock);
+	switch (cmd) {
+	case VVSENSORIOC_S_POWER:
+	case VVSENSORIOC_S_CLK:
+	case VVSENSORIOC_RESET:
+		ret = 0;
+		break;
+	case VVSENSORIOC_G_CLK:
+		ret = vvsim_get_clk(sensor, arg);
+		break;
+	case VIDIOC_QUERYCAP:
+		ret = vvsim_query_capability(sensor, arg);
+		break;
+	case VVSENSORIOC_QUERY:
+		ret = vvsim_query_supports(sensor, arg);
+		break;
+	case VVSENSORIOC_G_CHIP_ID:
+		ret = vvsim_get_sensor_id(sensor, arg);
+		break;
+	case VVSENSORIOC_G_RESERVE_ID:
+		ret = vvsim_get_reserve_id(sensor, arg);
+		break;
+	case VVSENSORIOC_G_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
+		ret = vvsim_get_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
+		break;
+	case VVSENSORIOC_S_SENSOR_MODE:
+		vvsensor_sync_lock(&sensor->sync);
+		ret = vvsim_set_sensor_mode(sensor, arg);
+		vvsensor_sync_unlock(&sensor->sync);
+		break;
+	case VVSENSORIOC_S_STREAM:
+		ret = vvsim_s_stream(&sensor->subdev, *(int *)arg);
+		break;
+	case VVSENSORIOC_WRITE_REG:
+		ret = copy_from_user(&sensor_reg, arg,
+			sizeof(struct vvcam_sccb_data_s));
+		ret |= vvsim_write_reg(sensor, sensor_reg.addr,
+			sensor_reg.data);
+		break;
+	case VVSENSORIOC_READ_REG:
+		ret = copy_from_user(&sensor_reg, arg,
+			sizeof(struct vvcam_sccb_data_s));
+		ret |= vvsim_read_reg(sensor, sensor_reg.addr,
+			(u8 *)&sensor_reg.data);
+		ret |= copy_to_user(arg, &sensor_reg,
+			sizeof(struct vvcam_sccb_data_s));
+		break;
+	case VVSENSORIOC_S_EXP:
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
+		break;
+	case VVSENSORIOC_S_VSEXP:
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
+		break;
+	case VVSENSORIOC_S_GAIN:
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
+		break;
+	case VVSENSORIOC_S_VSGAIN:
+		ret = vvsensor_sync_set(&sensor->sync, cmd, *(u32 *)arg);
+		trace_sensor_ae(sd->name, cmd, *(u32 *)arg, ret);
+		break;
+	case VVSENSORIOC_G_AE_SYNC:
+		ret = vvsensor_sync_get(&sensor->sync, arg);
+		break;
+	case VVSENSORIOC_S_AE_GROUP:
+		ret = copy_from_user(&ae_group, arg, sizeof(ae_group));
+		ret |= vvsensor_sync_set_ae(&sensor->sync, &ae_group);
+		trace_sensor_ae(sd->name, cmd, ae_group.mask, ret);
+		break;
+	case VVSENSORIOC_S_FPS:
+		vvsensor_sync_lock(&sensor->sync);
+		ret = vvsim_set_fps(sensor, *(u32 *)arg);
+		vvsensor_sync_unlock(&sensor->sync);
+		break;
+	case VVSENSORIOC_G_FPS:
+		vvsensor_sync_lock(&sensor->sync);
+		ret = vvsim_get_fps(sensor, (u32 *)arg);
+		vvsensor_sync_unlock(&sensor->sync);
+		break;
+	case VVSENSORIOC_S_HDR_RADIO:
+		ret = 0;
+		break;
+	case VVSENSORIOC_S_TEST_PATTERN:
+		ret = vvsim_set_test_pattern(sensor, arg);
+		break;
+	default:
+		break;
+	}
+
+	mutex_unlock(&sensor->lock);
+	return ret;
+}
+
+static struct v4l2_subdev_video_ops vvsim_subdev_video_ops = {
+	.s_stream = vvsim_s_stream,
+};
+
+static const struct v4l2_subdev_pad_ops vvsim_subdev_pad_ops = {
+	.enum_mbus_code = vvsim_enum_mbus_code,
+	.set_fmt = vvsim_set_fmt,
+	.get_fmt = vvsim_get_fmt,
+};
+
+static struct v4l2_subdev_core_ops vvsim_subdev_core_ops = {
+	.s_power = vvsim_s_power,
+	.ioctl = vvsim_priv_ioctl,
+};
+
+static struct v4l2_subdev_ops vvsim_subdev_ops = {
+	.core  = &vvsim_subdev_core_ops,
+	.video = &vvsim_subdev_video_ops,
+	.pad   = &vvsim_subdev_pad_ops,
+};
+
+static int vvsim_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct vvsim_sensor *sensor;
+	struct v4l2_subdev *sd;
+	int retval;
+
+	pr_info("enter %s\n", __func__);
+
+	sensor = devm_kzalloc(dev, sizeof(*sensor), GFP_KERNEL);
+	if (!sensor)
+		return -ENOMEM;
+
+	sensor->regs = devm_kzalloc(dev, VVSIM_REG_NUM, GFP_KERNEL);
+	if (!sensor->regs)
+		return -ENOMEM;
+	sensor->regs[0x300a] = (VVSIM_CHIP_ID >> 16) & 0xff;
+	sensor->regs[0x300b] = (VVSIM_CHIP_ID >> 8) & 0xff;
+	sensor->regs[0x300c] = VVSIM_CHIP_ID & 0xff;
+
+	mutex_init(&sensor->lock);
+	/* the simulated isp with the same id delivers the frame starts */
+	vvsensor_sync_init(&sensor->sync, max(pdev->id, 0), vvsim_sync_apply);
+	memcpy(&sensor->cur_mode, &pvvsim_mode_info[0],
+			sizeof(struct vvcam_mode_info_s));
+	sensor->format.width = sensor->cur_mode.size.bounds_width;
+	sensor->format.height = sensor->cur_mode.size.bounds_height;
+	sensor->format.code = vvsim_get_format_code(sensor);
+	sensor->format.field = V4L2_FIELD_NONE;
+
+	sd = &sensor->subdev;
+	v4l2_subdev_init(sd, &vvsim_subdev_ops);
+	snprintf(sd->name, sizeof(sd->name), "%s.%d",
+			VVSIM_SENSOR_NAME, pdev->id);
+	sd->flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
+	sd->owner = THIS_MODULE;
+	sd->dev = dev;
+	sd->entity.function = MEDIA_ENT_F_CAM_SENSOR;
+	sensor->pads[VVSIM_SENS_PAD_SOURCE].flags = MEDIA_PAD_FL_SOURCE;
+	retval = media_entity_pads_init(&sd->entity,
+				VVSIM_SENS_PADS_NUM,
+				sensor->pads);
+	if (retval < 0)
+		goto probe_err_mutex;
+
+	/* there is no csi bridge to bind to, so expose the node directly */
+	retval = v4l2_device_register(dev, &sensor->v4l2_dev);
+	if (retval < 0)
+		goto probe_err_free_entity;
+
+	retval = v4l2_device_register_subdev(&sensor->v4l2_dev, sd);
+	if (retval < 0)
+		goto probe_err_v4l2_unregister;
+
+	retval = v4l2_device_register_subdev_nodes(&sensor->v4l2_dev);
+	if (retval < 0)
+		goto probe_err_subdev_unregister;
+
+	platform_set_drvdata(pdev, sensor);
+	pr_info("%s simulated sensor registered\n", __func__);
+	return 0;
+
+probe_err_subdev_unregister:
+	v4l2_device_unregister_subdev(sd);
+probe_err_v4l2_unregister:
+	v4l2_device_unregister(&sensor->v4l2_dev);
+probe_err_free_entity:
+	media_entity_cleanup(&sd->entity);
+probe_err_mutex:
+	mutex_destroy(&sensor->lock);
+	return retval;
+}
+
+static int vvsim_remove(struct platform_device *pdev)
+{
+	struct vvsim_sensor *sensor = platform_get_drvdata(pdev);
+
+	pr_info("enter %s\n", __func__);
+
+	v4l2_device_unregister_subdev(&sensor->subdev);
+	vvsensor_sync_exit(&sensor->sync);
+	v4l2_device_unregister(&sensor->v4l2_dev);
+	media_entity_cleanup(&sensor->subdev.entity);
+	mutex_destroy(&sensor->lock);
+
+	return 0;
+}
+
+static struct platform_driver vvsim_driver = {
+	.probe = vvsim_probe,
+	.remove = vvsim_remove,
+	.driver = {
+		.owner = THIS_MODULE,
+		.name  = VVSIM_SENSOR_NAME,
+	},
+};
+
+static int __init vvsim_init_module(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&vvsim_driver);
+	if (ret) {
+		pr_err("register platform driver failed.\n");
+		return ret;
+	}
+
+	vvsim_pdev = platform_device_register_simple(VVSIM_SENSOR_NAME, 0,
+			NULL, 0);
+	if (IS_ERR(vvsim_pdev)) {
+		pr_err("register platform device failed.\n");
+		platform_driver_unregister(&vvsim_driver);
+		return PTR_ERR(vvsim_pdev);
+	}
+	return 0;
+}
+
+static void __exit vvsim_exit_module(void)
+{
+	platform_device_unregister(vvsim_pdev);
+	platform_driver_unregister(&vvsim_driver);
+}
+
+module_init(vvsim_init_module);
+module_exit(vvsim_exit_module);
+MODULE_DESCRIPTION("Simulated raw sensor for the vvcam pipeline");
+MODULE_LICENSE("GPL");
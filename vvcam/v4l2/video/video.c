@@ -55,6 +55,7 @@
 #endif
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/debugfs.h>
 #include <linux/spinlock.h>
 #include <linux/version.h>
 #include <media/v4l2-device.h>
@@ -69,6 +70,10 @@
 #include "vvdefs.h"
 #include "vvsensor.h"
 
+#define VVCAM_TRACE_SYSTEM vvcam_video
+#define CREATE_TRACE_POINTS
+#include "vvcam_trace.h"
+
 #define DEF_PLANE_NO    (0)
 #define RETRY_TIME_INTERVAL_MS  (5)
 #define RETRY_TIMES_MAX         (10)
@@ -105,6 +110,11 @@ static struct viv_video_fmt formats[] = {
 	 .depth = 16,
 	 .bpp = 1,
 	 },
+	{
+	 .fourcc = V4L2_PIX_FMT_GREY,
+	 .depth = 8,
+	 .bpp = 1,
+	 },
 };
 
 static int bayer_pattern_to_format(unsigned int bayer_pattern,
@@ -177,6 +187,48 @@ static int bayer_pattern_to_format(unsigned int bayer_pattern,
 	return ret;
 }
 
+#ifdef ENABLE_IRQ
+/* packed bayer, as the mi writes it with no padding to 16 bits, keyed by
+ * the bus code the isp lists on its main pad for it */
+static const struct viv_packed_fmt {
+	unsigned int bayer_pattern;
+	unsigned int bit_width;
+	u32 fourcc;
+	u32 code;
+} packed_formats[] = {
+	{ BAYER_BGGR, 10, V4L2_PIX_FMT_SBGGR10P, MEDIA_BUS_FMT_SBGGR10_1X10 },
+	{ BAYER_GBRG, 10, V4L2_PIX_FMT_SGBRG10P, MEDIA_BUS_FMT_SGBRG10_1X10 },
+	{ BAYER_GRBG, 10, V4L2_PIX_FMT_SGRBG10P, MEDIA_BUS_FMT_SGRBG10_1X10 },
+	{ BAYER_RGGB, 10, V4L2_PIX_FMT_SRGGB10P, MEDIA_BUS_FMT_SRGGB10_1X10 },
+	{ BAYER_BGGR, 12, V4L2_PIX_FMT_SBGGR12P, MEDIA_BUS_FMT_SBGGR12_1X12 },
+	{ BAYER_GBRG, 12, V4L2_PIX_FMT_SGBRG12P, MEDIA_BUS_FMT_SGBRG12_1X12 },
+	{ BAYER_GRBG, 12, V4L2_PIX_FMT_SGRBG12P, MEDIA_BUS_FMT_SGRBG12_1X12 },
+	{ BAYER_RGGB, 12, V4L2_PIX_FMT_SRGGB12P, MEDIA_BUS_FMT_SRGGB12_1X12 },
+};
+
+static const struct viv_packed_fmt *viv_find_packed_fmt(
+		unsigned int bayer_pattern, unsigned int bit_width)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(packed_formats); ++i)
+		if (packed_formats[i].bayer_pattern == bayer_pattern &&
+		    packed_formats[i].bit_width == bit_width)
+			return &packed_formats[i];
+	return NULL;
+}
+
+static bool viv_is_packed_fourcc(u32 fourcc)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(packed_formats); ++i)
+		if (packed_formats[i].fourcc == fourcc)
+			return true;
+	return false;
+}
+#endif
+
 /* Caller must hold fh->vdev->fh_lock! */
 static struct v4l2_subscribed_event *video_event_fh_subscribed(
 		struct v4l2_fh *fh, u32 type, u32 id)
@@ -758,13 +810,35 @@ end:
 	return rc;
 }
 
+/* the isp stats, params and self path pads follow the isp, whatever its
+ * main path feeds */
+static void viv_create_meta_links(struct viv_video_device *dev)
+{
+	struct media_entity *isp;
+
+	isp = viv_find_entity(dev, ISP_DEVICE_NAME);
+	if (dev->sp.video && viv_create_link(isp, ISP_PAD_SOURCE_SP,
+			&dev->sp.video->entity, 0))
+		pr_err("failed to create isp self path link!\n");
+	if (dev->stats.video && viv_create_link(isp, ISP_PAD_STATS,
+			&dev->stats.video->entity, 0))
+		pr_err("failed to create isp stats link!\n");
+	if (dev->params.video && viv_create_link(&dev->params.video->entity,
+			0, isp, ISP_PAD_PARAMS))
+		pr_err("failed to create isp params link!\n");
+}
+
 static int viv_create_default_links(struct viv_video_device *dev)
 {
 	struct media_entity *source, *sink;
+	int rc;
 
 	source = viv_find_entity(dev, ISP_DEVICE_NAME);
 	sink = &dev->video->entity;
-	return viv_create_link(source, ISP_PAD_SOURCE, sink, 0);
+	rc = viv_create_link(source, ISP_PAD_SOURCE, sink, 0);
+	if (!rc)
+		viv_create_meta_links(dev);
+	return rc;
 }
 
 static int viv_config_dwe(struct viv_video_file *handle, bool enable)
@@ -790,6 +864,7 @@ static int viv_config_dwe(struct viv_video_file *handle, bool enable)
 		source = viv_find_entity(vdev, ISP_DEVICE_NAME);
 		media_entity_remove_links(source);
 		rc = viv_create_link(source, ISP_PAD_SOURCE, sink, 0);
+		viv_create_meta_links(vdev);
 		if (!rc)
 			vdev->dweEnabled = false;
 		return rc;
@@ -805,12 +880,36 @@ static int viv_config_dwe(struct viv_video_file *handle, bool enable)
 		media_entity_remove_links(source);
 		if (viv_create_link(source, ISP_PAD_SOURCE, sink, DWE_PAD_SINK))
 			pr_err("failed to create link between isp and dwe!\n");
+		viv_create_meta_links(vdev);
 	}
 
 	vdev->dweEnabled = true;
 end:
 	return rc;
 }
+
+/* only an mi that writes raw without padding lists the packed codes */
+static bool viv_raw_packed(struct viv_video_device *vdev, u32 code)
+{
+	struct v4l2_subdev_mbus_code_enum mbus;
+	struct media_entity *isp;
+	struct v4l2_subdev *sd;
+
+	isp = viv_find_entity(vdev, ISP_DEVICE_NAME);
+	if (!isp || !is_media_entity_v4l2_subdev(isp))
+		return false;
+	sd = media_entity_to_v4l2_subdev(isp);
+
+	memset(&mbus, 0, sizeof(mbus));
+	mbus.pad = ISP_PAD_SOURCE;
+	mbus.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	while (!v4l2_subdev_call(sd, pad, enum_mbus_code, NULL, &mbus)) {
+		if (mbus.code == code)
+			return true;
+		mbus.index++;
+	}
+	return false;
+}
 #endif
 
 static inline void init_v4l2_fmt(struct v4l2_format *f, unsigned int bpp,
@@ -821,6 +920,14 @@ static inline void init_v4l2_fmt(struct v4l2_format *f, unsigned int bpp,
 		VIDEO_FRAME_MIN_WIDTH, VIDEO_FRAME_MAX_WIDTH, 0,
 		&f->fmt.pix.height, VIDEO_FRAME_MIN_HEIGHT,
 		VIDEO_FRAME_MAX_HEIGHT, 0, 0);
+	if (!bpp) {
+		/* packed raw has no whole bytes per pixel, the mi pads each
+		 * line to 128 bits */
+		*bytesperline = ALIGN(DIV_ROUND_UP(f->fmt.pix.width * depth, 8),
+				16);
+		*sizeimage = *bytesperline * f->fmt.pix.height;
+		return;
+	}
 	*bytesperline = (f->fmt.pix.width) * bpp;
 	*sizeimage = (f->fmt.pix.width) * (f->fmt.pix.height) * depth / 8;
 	return;
@@ -832,6 +939,9 @@ static int viv_set_modeinfo(struct viv_video_file *handle,
 	struct viv_video_device *vdev = handle->vdev;
 	struct viv_video_fmt fmt;
 	struct viv_video_fmt *pfmt = NULL;
+#ifdef ENABLE_IRQ
+	const struct viv_packed_fmt *packed;
+#endif
 
 	if (pcamera_mode->size.width == 0 || pcamera_mode->size.height == 0 ) {
 		vdev->camera_status = 0;
@@ -847,6 +957,17 @@ static int viv_set_modeinfo(struct viv_video_file *handle,
 		memcpy(&vdev->formats[vdev->formatscount], &fmt, sizeof(fmt));
 		vdev->formatscount++;
 	}
+#ifdef ENABLE_IRQ
+	packed = viv_find_packed_fmt(pcamera_mode->bayer_pattern,
+			pcamera_mode->bit_width);
+	if (packed && viv_raw_packed(vdev, packed->code)) {
+		fmt.fourcc = packed->fourcc;
+		fmt.depth = packed->bit_width;
+		fmt.bpp = 0;
+		memcpy(&vdev->formats[vdev->formatscount], &fmt, sizeof(fmt));
+		vdev->formatscount++;
+	}
+#endif
 
 	pfmt = &vdev->formats[0];
 
@@ -1187,7 +1308,10 @@ static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
 	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_SBGGR12) ||
 	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_SGBRG12) ||
 	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_SGRBG12) ||
-	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_SRGGB12)) {
+	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_SRGGB12) ||
+	    viv_is_packed_fourcc(f->fmt.pix.pixelformat) ||
+	    /* the dewarp writes chroma whatever it is fed, luma skips it */
+	    (f->fmt.pix.pixelformat == V4L2_PIX_FMT_GREY)) {
 		viv_config_dwe(handle, false);
 	}
 #endif
@@ -1902,10 +2026,18 @@ static void viv_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 		return;
 	buf->vb.vb2_buf.planes[DEF_PLANE_NO].bytesused =
 			vdev->fmt.fmt.pix.sizeimage;
+	/* timestamp and sequence were set from the isp start of frame */
 	cur_ts = ktime_get_ns();
-#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 0, 0)
-	buf->vb.vb2_buf.timestamp = cur_ts;
-#endif
+	trace_video_buf_done(vdev->id, buf->vb.vb2_buf.index,
+			buf->vb.sequence, buf->vb.vb2_buf.timestamp);
+	vdev->perf.frames++;
+	/* sequences restart from 0 at every stream on */
+	if (buf->vb.sequence > vdev->perf.last_seq + 1)
+		vdev->perf.skipped += buf->vb.sequence - vdev->perf.last_seq - 1;
+	vdev->perf.last_seq = buf->vb.sequence;
+	if (cur_ts > buf->vb.vb2_buf.timestamp)
+		vvcam_hist_add(&vdev->perf.latency,
+				cur_ts - buf->vb.vb2_buf.timestamp);
 	vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
 
 	/* print fps info for debugging purpose */
@@ -1913,10 +2045,11 @@ static void viv_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 	for (i = 0; i < VIDEO_NODE_NUM; i++) {
 		if (vdev->id == i) {
 			if (vdev->duration >= 3 * 1000000/*ms*/) {
+				fps = vdev->frameCnt[i] * 100000000 / vdev->duration;
+				vdev->perf.fps = fps;
 				vdev->loop_cnt[i]++;
 				if (vdev->loop_cnt[i] >= 10) {
 					if (vdev->frame_flag) {
-						fps = vdev->frameCnt[i] * 100000000 / vdev->duration;
 						pr_info("###### video%d(%d) %d.%02d fps ######\n",
 								vdev->video->num, vdev->id,
 								fps / 100, fps % 100);
@@ -1939,6 +2072,623 @@ static void viv_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 static const struct vvbuf_ops viv_buf_ops = {
 	.notify = viv_buf_notify,
 };
+
+static int viv_stats_show(struct seq_file *m, void *unused)
+{
+	struct viv_video_perf *perf = m->private;
+
+	seq_printf(m, "frames %u\n", perf->frames);
+	seq_printf(m, "skipped %u\n", perf->skipped);
+	seq_printf(m, "fps %u.%02u\n", perf->fps / 100, perf->fps % 100);
+	vvcam_hist_show(m, "latency", &perf->latency);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(viv_stats);
+
+static void viv_meta_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
+{
+	struct viv_meta_device *meta =
+		container_of(ctx, struct viv_meta_device, bctx);
+	unsigned long flags;
+
+	if (!buf)
+		return;
+
+	spin_lock_irqsave(&meta->qlock, flags);
+	list_del_init(&buf->nodelist);
+	spin_unlock_irqrestore(&meta->qlock, flags);
+
+	/* stats payload, sequence and timestamp are filled in by the isp */
+	vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+}
+
+static const struct vvbuf_ops viv_meta_buf_ops = {
+	.notify = viv_meta_buf_notify,
+};
+
+static int meta_queue_setup(struct vb2_queue *q,
+		       unsigned int *num_buffers, unsigned int *num_planes,
+		       unsigned int sizes[], struct device *alloc_devs[])
+{
+	struct viv_meta_device *meta = vb2_get_drv_priv(q);
+
+	if (*num_planes)
+		return sizes[0] < meta->buffersize ? -EINVAL : 0;
+
+	*num_planes = 1;
+	sizes[0] = meta->buffersize;
+	return 0;
+}
+
+static int meta_buffer_prepare(struct vb2_buffer *vb)
+{
+	struct viv_meta_device *meta = vb2_get_drv_priv(vb->vb2_queue);
+
+	if (vb2_plane_size(vb, 0) < meta->buffersize)
+		return -EINVAL;
+
+	if (V4L2_TYPE_IS_OUTPUT(vb->type) &&
+	    vb2_get_plane_payload(vb, 0) > meta->buffersize)
+		return -EINVAL;
+
+	/* map now, the isp accesses the buffer from its irq handler */
+	if (!vb2_plane_vaddr(vb, 0))
+		return -ENOMEM;
+	return 0;
+}
+
+static void meta_buffer_queue(struct vb2_buffer *vb)
+{
+	struct viv_meta_device *meta = vb2_get_drv_priv(vb->vb2_queue);
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct vb2_dc_buf *buf = container_of(vbuf, struct vb2_dc_buf, vb);
+	unsigned long flags;
+
+	spin_lock_irqsave(&meta->qlock, flags);
+	list_add_tail(&buf->nodelist, &meta->queued);
+	spin_unlock_irqrestore(&meta->qlock, flags);
+
+	vvbuf_ready(&meta->bctx, &meta->pad, buf);
+}
+
+static void meta_stop_streaming(struct vb2_queue *vq)
+{
+	struct viv_meta_device *meta = vb2_get_drv_priv(vq);
+	struct vb2_dc_buf *buf, *tmp;
+	unsigned long flags;
+	LIST_HEAD(queued);
+
+	/* the isp completes none of our buffers once this returns */
+	vvbuf_release(&meta->pad);
+
+	spin_lock_irqsave(&meta->qlock, flags);
+	list_splice_init(&meta->queued, &queued);
+	spin_unlock_irqrestore(&meta->qlock, flags);
+
+	list_for_each_entry_safe(buf, tmp, &queued, nodelist) {
+		list_del_init(&buf->nodelist);
+		vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_ERROR);
+	}
+}
+
+static struct vb2_ops meta_buffer_ops = {
+	.queue_setup = meta_queue_setup,
+	.buf_prepare = meta_buffer_prepare,
+	.buf_queue = meta_buffer_queue,
+	.stop_streaming = meta_stop_streaming,
+	.wait_prepare = vb2_ops_wait_prepare,
+	.wait_finish = vb2_ops_wait_finish,
+};
+
+static int meta_querycap(struct file *file, void *fh,
+			  struct v4l2_capability *cap)
+{
+	struct viv_meta_device *meta = video_drvdata(file);
+
+	strcpy(cap->driver, "viv_v4l2_device");
+	strcpy(cap->card, "VIV meta");
+	snprintf((char *)cap->bus_info, sizeof(cap->bus_info),
+			"platform:viv%d", meta->id);
+	return 0;
+}
+
+static int meta_enum_fmt(struct file *file, void *priv,
+				   struct v4l2_fmtdesc *f)
+{
+	struct viv_meta_device *meta = video_drvdata(file);
+
+	if (f->index > 0)
+		return -EINVAL;
+	f->pixelformat = meta->dataformat;
+	return 0;
+}
+
+static int meta_g_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct viv_meta_device *meta = video_drvdata(file);
+
+	f->fmt.meta.dataformat = meta->dataformat;
+	f->fmt.meta.buffersize = meta->buffersize;
+	return 0;
+}
+
+static const struct v4l2_ioctl_ops meta_ioctl_ops = {
+	.vidioc_querycap = meta_querycap,
+	.vidioc_enum_fmt_meta_cap = meta_enum_fmt,
+	.vidioc_g_fmt_meta_cap = meta_g_fmt,
+	.vidioc_try_fmt_meta_cap = meta_g_fmt,
+	.vidioc_s_fmt_meta_cap = meta_g_fmt,
+	.vidioc_enum_fmt_meta_out = meta_enum_fmt,
+	.vidioc_g_fmt_meta_out = meta_g_fmt,
+	.vidioc_try_fmt_meta_out = meta_g_fmt,
+	.vidioc_s_fmt_meta_out = meta_g_fmt,
+	.vidioc_reqbufs = vb2_ioctl_reqbufs,
+	.vidioc_querybuf = vb2_ioctl_querybuf,
+	.vidioc_qbuf = vb2_ioctl_qbuf,
+	.vidioc_dqbuf = vb2_ioctl_dqbuf,
+	.vidioc_expbuf = vb2_ioctl_expbuf,
+	.vidioc_streamon = vb2_ioctl_streamon,
+	.vidioc_streamoff = vb2_ioctl_streamoff,
+};
+
+static int meta_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct viv_meta_device *meta = video_drvdata(file);
+
+	/* the isp stats ring has an offset of its own, see vvbuf_mmap() */
+	if (vma->vm_pgoff == VIV_META_STATS_RING_OFFSET >> PAGE_SHIFT)
+		return vvbuf_mmap(&meta->pad, vma);
+	return vb2_fop_mmap(file, vma);
+}
+
+static struct v4l2_file_operations meta_ops = {
+	.owner = THIS_MODULE,
+	.open = v4l2_fh_open,
+	.release = vb2_fop_release,
+	.poll = vb2_fop_poll,
+	.unlocked_ioctl = video_ioctl2,
+	.mmap = meta_mmap,
+};
+
+/*
+ * type is V4L2_BUF_TYPE_META_CAPTURE for the statistics node and
+ * V4L2_BUF_TYPE_META_OUTPUT for the parameters node.
+ */
+static int viv_meta_register(struct viv_video_device *vdev,
+		struct viv_meta_device *meta, u32 type)
+{
+	bool output = type == V4L2_BUF_TYPE_META_OUTPUT;
+	struct video_device *video;
+	int rc;
+
+	video = video_device_alloc();
+	if (!video)
+		return -ENOMEM;
+
+	meta->id = vdev->id;
+	meta->dataformat = output ? VIV_META_FMT_ISP_PARAMS :
+			VIV_META_FMT_ISP_STATS;
+	meta->buffersize = output ? VIV_META_ISP_PARAMS_SIZE :
+			VIV_META_ISP_STATS_SIZE;
+	mutex_init(&meta->lock);
+	spin_lock_init(&meta->qlock);
+	INIT_LIST_HEAD(&meta->queued);
+	vvbuf_ctx_init(&meta->bctx);
+	meta->bctx.ops = &viv_meta_buf_ops;
+
+	meta->queue.type = type;
+	meta->queue.io_modes = VB2_MMAP | VB2_DMABUF;
+	meta->queue.drv_priv = meta;
+	meta->queue.ops = &meta_buffer_ops;
+	meta->queue.mem_ops = &vb2_dma_contig_memops;
+	meta->queue.buf_struct_size = sizeof(struct vb2_dc_buf);
+	meta->queue.timestamp_flags = output ? V4L2_BUF_FLAG_TIMESTAMP_COPY :
+			V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	meta->queue.lock = &meta->lock;
+	meta->queue.dev = vdev->v4l2_dev->dev;
+	rc = vb2_queue_init(&meta->queue);
+	if (rc)
+		goto err;
+
+	snprintf(video->name, sizeof(video->name), "viv_v4l2%d_%s",
+			vdev->id, output ? "params" : "stats");
+	video->v4l2_dev = vdev->v4l2_dev;
+	video->release = video_device_release;
+	video->fops = &meta_ops;
+	video->ioctl_ops = &meta_ioctl_ops;
+	video->queue = &meta->queue;
+	video->lock = &meta->lock;
+	video->vfl_dir = output ? VFL_DIR_TX : VFL_DIR_RX;
+	video->device_caps = V4L2_CAP_STREAMING | (output ?
+			V4L2_CAP_META_OUTPUT : V4L2_CAP_META_CAPTURE);
+	video_set_drvdata(video, meta);
+
+	video->entity.name = video->name;
+	video->entity.obj_type = MEDIA_ENTITY_TYPE_VIDEO_DEVICE;
+	video->entity.function = MEDIA_ENT_F_IO_V4L;
+	video->entity.ops = &viv_media_ops;
+	meta->pad.flags = output ? MEDIA_PAD_FL_SOURCE : MEDIA_PAD_FL_SINK;
+	rc = media_entity_pads_init(&video->entity, 1, &meta->pad);
+	if (rc)
+		goto err;
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 10, 0)
+	rc = video_register_device(video, VFL_TYPE_VIDEO, -1);
+#else
+	rc = video_register_device(video, VFL_TYPE_GRABBER, -1);
+#endif
+	if (rc)
+		goto err;
+
+	meta->video = video;
+	return 0;
+err:
+	video_device_release(video);
+	return rc;
+}
+
+static void viv_meta_unregister(struct viv_meta_device *meta)
+{
+	if (!meta->video)
+		return;
+
+	media_entity_cleanup(&meta->video->entity);
+	video_unregister_device(meta->video);
+	meta->video = NULL;
+	vvbuf_ctx_deinit(&meta->bctx);
+}
+
+/* self path formats, the isp takes the memory layout from the bus code */
+static const struct viv_sp_fmt {
+	struct viv_video_fmt fmt;
+	u32 code;
+} sp_formats[] = {
+	{
+	 .fmt = { .fourcc = V4L2_PIX_FMT_NV12, .depth = 12, .bpp = 1 },
+	 .code = MEDIA_BUS_FMT_YUYV8_1_5X8,
+	 },
+	{
+	 .fmt = { .fourcc = V4L2_PIX_FMT_NV16, .depth = 16, .bpp = 1 },
+	 .code = MEDIA_BUS_FMT_YUYV8_2X8,
+	 },
+	{
+	 .fmt = { .fourcc = V4L2_PIX_FMT_YUYV, .depth = 16, .bpp = 2 },
+	 .code = MEDIA_BUS_FMT_YUYV8_1X16,
+	 },
+	{
+	 .fmt = { .fourcc = V4L2_PIX_FMT_RGB24, .depth = 24, .bpp = 3 },
+	 .code = MEDIA_BUS_FMT_RGB888_1X24,
+	 },
+	{
+	 .fmt = { .fourcc = VIV_PIX_FMT_RGB888P, .depth = 24, .bpp = 1 },
+	 .code = MEDIA_BUS_FMT_RGB888_3X8,
+	 },
+	{
+	 .fmt = { .fourcc = V4L2_PIX_FMT_GREY, .depth = 8, .bpp = 1 },
+	 .code = MEDIA_BUS_FMT_Y8_1X8,
+	 },
+};
+
+static const struct viv_sp_fmt *viv_sp_find_fmt(u32 fourcc)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sp_formats); ++i)
+		if (sp_formats[i].fmt.fourcc == fourcc)
+			return &sp_formats[i];
+	return NULL;
+}
+
+/* not every mi writes every layout, ask the isp when it is linked */
+static bool viv_sp_fmt_supported(struct viv_sp_device *sp,
+		const struct viv_sp_fmt *format)
+{
+	struct v4l2_subdev_mbus_code_enum code;
+	struct v4l2_subdev *sd;
+	struct media_pad *pad;
+
+	pad = media_entity_remote_pad(&sp->pad);
+	if (!pad || !is_media_entity_v4l2_subdev(pad->entity))
+		return true;
+	sd = media_entity_to_v4l2_subdev(pad->entity);
+
+	memset(&code, 0, sizeof(code));
+	code.pad = pad->index;
+	code.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	while (!v4l2_subdev_call(sd, pad, enum_mbus_code, NULL, &code)) {
+		if (code.code == format->code)
+			return true;
+		code.index++;
+	}
+	return false;
+}
+
+/* ask the isp for the self path, a zero sized format releases it */
+static int viv_sp_config(struct viv_sp_device *sp, bool enable)
+{
+	struct v4l2_subdev_format sd_fmt;
+	struct v4l2_subdev *sd;
+	struct media_pad *pad;
+
+	pad = media_entity_remote_pad(&sp->pad);
+	if (!pad || !is_media_entity_v4l2_subdev(pad->entity))
+		return -ENOLINK;
+	sd = media_entity_to_v4l2_subdev(pad->entity);
+
+	memset(&sd_fmt, 0, sizeof(sd_fmt));
+	sd_fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	sd_fmt.pad = pad->index;
+	if (enable) {
+		sd_fmt.format.code =
+			viv_sp_find_fmt(sp->fmt.fmt.pix.pixelformat)->code;
+		sd_fmt.format.width = sp->fmt.fmt.pix.width;
+		sd_fmt.format.height = sp->fmt.fmt.pix.height;
+		sd_fmt.format.field = V4L2_FIELD_NONE;
+	}
+	return v4l2_subdev_call(sd, pad, set_fmt, NULL, &sd_fmt);
+}
+
+static void viv_sp_buf_notify(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
+{
+	struct viv_sp_device *sp = container_of(ctx, struct viv_sp_device, bctx);
+
+	if (!buf || buf->vb.vb2_buf.state != VB2_BUF_STATE_ACTIVE)
+		return;
+
+	/* timestamp and sequence were set from the isp start of frame */
+	vb2_set_plane_payload(&buf->vb.vb2_buf, 0, sp->fmt.fmt.pix.sizeimage);
+	vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+}
+
+static const struct vvbuf_ops viv_sp_buf_ops = {
+	.notify = viv_sp_buf_notify,
+};
+
+static int sp_queue_setup(struct vb2_queue *q,
+		       unsigned int *num_buffers, unsigned int *num_planes,
+		       unsigned int sizes[], struct device *alloc_devs[])
+{
+	struct viv_sp_device *sp = vb2_get_drv_priv(q);
+	u32 size = sp->fmt.fmt.pix.sizeimage;
+
+	if (*num_planes)
+		return sizes[0] < size ? -EINVAL : 0;
+
+	*num_planes = 1;
+	sizes[0] = size;
+	return 0;
+}
+
+static int sp_buffer_prepare(struct vb2_buffer *vb)
+{
+	struct viv_sp_device *sp = vb2_get_drv_priv(vb->vb2_queue);
+
+	if (vb2_plane_size(vb, 0) < sp->fmt.fmt.pix.sizeimage)
+		return -EINVAL;
+	return 0;
+}
+
+static void sp_buffer_queue(struct vb2_buffer *vb)
+{
+	struct viv_sp_device *sp = vb2_get_drv_priv(vb->vb2_queue);
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct vb2_dc_buf *buf = container_of(vbuf, struct vb2_dc_buf, vb);
+
+	buf->dma = vb2_dma_contig_plane_dma_addr(vb, DEF_PLANE_NO);
+	vvbuf_ready(&sp->bctx, &sp->pad, buf);
+}
+
+static void sp_return_buffers(struct vb2_queue *vq, enum vb2_buffer_state state)
+{
+	struct vb2_buffer *vb;
+
+	list_for_each_entry(vb, &vq->queued_list, queued_entry) {
+		if (vb->state == VB2_BUF_STATE_ACTIVE)
+			vb2_buffer_done(vb, state);
+	}
+}
+
+static int sp_start_streaming(struct vb2_queue *vq, unsigned int count)
+{
+	struct viv_sp_device *sp = vb2_get_drv_priv(vq);
+	int rc;
+
+	/* frames flow once the main node starts the isp */
+	rc = viv_sp_config(sp, true);
+	if (rc) {
+		pr_err("isp %d refused the self path: %d\n", sp->id, rc);
+		vvbuf_ctx_flush(vvbuf_get_remote_ctx(&sp->pad));
+		sp_return_buffers(vq, VB2_BUF_STATE_QUEUED);
+	}
+	return rc;
+}
+
+static void sp_stop_streaming(struct vb2_queue *vq)
+{
+	struct viv_sp_device *sp = vb2_get_drv_priv(vq);
+
+	viv_sp_config(sp, false);
+	vvbuf_ctx_flush(vvbuf_get_remote_ctx(&sp->pad));
+	sp_return_buffers(vq, VB2_BUF_STATE_ERROR);
+}
+
+static struct vb2_ops sp_buffer_ops = {
+	.queue_setup = sp_queue_setup,
+	.buf_prepare = sp_buffer_prepare,
+	.buf_queue = sp_buffer_queue,
+	.start_streaming = sp_start_streaming,
+	.stop_streaming = sp_stop_streaming,
+	.wait_prepare = vb2_ops_wait_prepare,
+	.wait_finish = vb2_ops_wait_finish,
+};
+
+static int sp_querycap(struct file *file, void *fh,
+			  struct v4l2_capability *cap)
+{
+	struct viv_sp_device *sp = video_drvdata(file);
+
+	strcpy(cap->driver, "viv_v4l2_device");
+	strcpy(cap->card, "VIV self path");
+	snprintf((char *)cap->bus_info, sizeof(cap->bus_info),
+			"platform:viv%d", sp->id);
+	return 0;
+}
+
+static int sp_enum_fmt(struct file *file, void *priv,
+				   struct v4l2_fmtdesc *f)
+{
+	struct viv_sp_device *sp = video_drvdata(file);
+	u32 index = f->index;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sp_formats); ++i) {
+		if (!viv_sp_fmt_supported(sp, &sp_formats[i]))
+			continue;
+		if (index-- == 0) {
+			f->pixelformat = sp_formats[i].fmt.fourcc;
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+static int sp_g_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct viv_sp_device *sp = video_drvdata(file);
+
+	*f = sp->fmt;
+	return 0;
+}
+
+static void viv_sp_try_fmt(struct viv_sp_device *sp, struct v4l2_format *f)
+{
+	const struct viv_sp_fmt *sp_fmt;
+	const struct viv_video_fmt *format;
+
+	sp_fmt = viv_sp_find_fmt(f->fmt.pix.pixelformat);
+	if (!sp_fmt || !viv_sp_fmt_supported(sp, sp_fmt))
+		sp_fmt = &sp_formats[0];
+	format = &sp_fmt->fmt;
+	f->fmt.pix.pixelformat = format->fourcc;
+	f->fmt.pix.width = ALIGN_UP(f->fmt.pix.width, VIDEO_FRAME_WIDTH_ALIGN);
+	f->fmt.pix.height = ALIGN_UP(f->fmt.pix.height, VIDEO_FRAME_HEIGHT_ALIGN);
+	f->fmt.pix.field = V4L2_FIELD_NONE;
+	f->fmt.pix.colorspace = V4L2_COLORSPACE_REC709;
+	init_v4l2_fmt(f, format->bpp, format->depth,
+			&f->fmt.pix.bytesperline, &f->fmt.pix.sizeimage);
+}
+
+static int sp_try_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	viv_sp_try_fmt(video_drvdata(file), f);
+	return 0;
+}
+
+static int sp_s_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct viv_sp_device *sp = video_drvdata(file);
+
+	if (vb2_is_busy(&sp->queue))
+		return -EBUSY;
+
+	viv_sp_try_fmt(sp, f);
+	sp->fmt = *f;
+	return 0;
+}
+
+static const struct v4l2_ioctl_ops sp_ioctl_ops = {
+	.vidioc_querycap = sp_querycap,
+	.vidioc_enum_fmt_vid_cap = sp_enum_fmt,
+	.vidioc_g_fmt_vid_cap = sp_g_fmt,
+	.vidioc_try_fmt_vid_cap = sp_try_fmt,
+	.vidioc_s_fmt_vid_cap = sp_s_fmt,
+	.vidioc_reqbufs = vb2_ioctl_reqbufs,
+	.vidioc_querybuf = vb2_ioctl_querybuf,
+	.vidioc_qbuf = vb2_ioctl_qbuf,
+	.vidioc_dqbuf = vb2_ioctl_dqbuf,
+	.vidioc_expbuf = vb2_ioctl_expbuf,
+	.vidioc_streamon = vb2_ioctl_streamon,
+	.vidioc_streamoff = vb2_ioctl_streamoff,
+};
+
+static int viv_sp_register(struct viv_video_device *vdev,
+		struct viv_sp_device *sp)
+{
+	struct video_device *video;
+	int rc;
+
+	video = video_device_alloc();
+	if (!video)
+		return -ENOMEM;
+
+	sp->id = vdev->id;
+	sp->fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	sp->fmt.fmt.pix.width = 640;
+	sp->fmt.fmt.pix.height = 480;
+	sp->fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_NV12;
+	mutex_init(&sp->lock);
+	vvbuf_ctx_init(&sp->bctx);
+	sp->bctx.ops = &viv_sp_buf_ops;
+
+	sp->queue.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	sp->queue.io_modes = VB2_MMAP | VB2_DMABUF;
+	sp->queue.drv_priv = sp;
+	sp->queue.ops = &sp_buffer_ops;
+	sp->queue.mem_ops = &vb2_dma_contig_memops;
+	sp->queue.buf_struct_size = sizeof(struct vb2_dc_buf);
+	sp->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	sp->queue.lock = &sp->lock;
+	sp->queue.dev = vdev->v4l2_dev->dev;
+	rc = vb2_queue_init(&sp->queue);
+	if (rc)
+		goto err;
+
+	snprintf(video->name, sizeof(video->name), "viv_v4l2%d_sp", vdev->id);
+	video->v4l2_dev = vdev->v4l2_dev;
+	video->release = video_device_release;
+	video->fops = &meta_ops;
+	video->ioctl_ops = &sp_ioctl_ops;
+	video->queue = &sp->queue;
+	video->lock = &sp->lock;
+	video->vfl_dir = VFL_DIR_RX;
+	video->device_caps = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
+	video_set_drvdata(video, sp);
+
+	video->entity.name = video->name;
+	video->entity.obj_type = MEDIA_ENTITY_TYPE_VIDEO_DEVICE;
+	video->entity.function = MEDIA_ENT_F_IO_V4L;
+	video->entity.ops = &viv_media_ops;
+	sp->pad.flags = MEDIA_PAD_FL_SINK;
+	rc = media_entity_pads_init(&video->entity, 1, &sp->pad);
+	if (rc)
+		goto err;
+	viv_sp_try_fmt(sp, &sp->fmt);
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(5, 10, 0)
+	rc = video_register_device(video, VFL_TYPE_VIDEO, -1);
+#else
+	rc = video_register_device(video, VFL_TYPE_GRABBER, -1);
+#endif
+	if (rc)
+		goto err;
+
+	sp->video = video;
+	return 0;
+err:
+	video_device_release(video);
+	return rc;
+}
+
+static void viv_sp_unregister(struct viv_sp_device *sp)
+{
+	if (!sp->video)
+		return;
+
+	media_entity_cleanup(&sp->video->entity);
+	video_unregister_device(sp->video);
+	sp->video = NULL;
+	vvbuf_ctx_deinit(&sp->bctx);
+}
 #endif
 
 struct dev_node {
@@ -1947,6 +2697,23 @@ struct dev_node {
 	int id;
 	const char *name;
 };
+#ifdef VVCAM_SIM
+/* the simulated isp and dwe are plain platform devices, matched by name */
+static inline int viv_find_compatible_nodes(struct dev_node *nodes, int size)
+{
+	if (size < 2)
+		return 0;
+
+	nodes[0].id = 0;
+	nodes[0].match_type = V4L2_ASYNC_MATCH_DEVNAME;
+	nodes[0].name = ISP_DEVICE_NAME ".0";
+
+	nodes[1].id = 0;
+	nodes[1].match_type = V4L2_ASYNC_MATCH_DEVNAME;
+	nodes[1].name = DWE_DEVICE_NAME ".0";
+	return 2;
+}
+#else
 static const char * const dwe_dev_compat_name[] = {
 	"32e30000.dwe", "fsl,fake-imx8mp-dwe.1"};
 
@@ -1989,6 +2756,7 @@ static inline int viv_find_compatible_nodes(struct dev_node *nodes, int size)
 	}
 	return cnt;
 }
+#endif
 #ifndef ENABLE_IRQ
 static struct reserved_mem * viv_find_isp_reserve_mem(int dev_id)
 {
@@ -2033,6 +2801,7 @@ static int viv_video_probe(struct platform_device *pdev)
 	int i,m, video_id;
 	struct dev_node nodes[MAX_SUBDEVS_NUM];
 	int nodecount;
+	char name[16];
 
 #ifdef ENABLE_IRQ
 	int j;
@@ -2046,7 +2815,7 @@ static int viv_video_probe(struct platform_device *pdev)
 	memset(nodes, 0, sizeof(nodes));
 	nodecount = viv_find_compatible_nodes(nodes, MAX_SUBDEVS_NUM);
 	for (i = 0; i < VIDEO_NODE_NUM && i*2 < nodecount; i++) {
-		if(nodes[i*2].node) {
+		if (nodes[i*2].node || nodes[i*2].name) {
 			video_id = nodes[i*2].id ;
 			if(video_id >= VIDEO_NODE_NUM) {
 				pr_err("%s: id %d is too large (id > %d) \n",
@@ -2137,6 +2906,18 @@ static int viv_video_probe(struct platform_device *pdev)
 				goto register_fail;
 
 #ifdef ENABLE_IRQ
+			if (viv_meta_register(vdev, &vdev->stats,
+					V4L2_BUF_TYPE_META_CAPTURE))
+				pr_err("failed to register stats node of isp %d\n",
+						video_id);
+			if (viv_meta_register(vdev, &vdev->params,
+					V4L2_BUF_TYPE_META_OUTPUT))
+				pr_err("failed to register params node of isp %d\n",
+						video_id);
+			if (viv_sp_register(vdev, &vdev->sp))
+				pr_err("failed to register self path node of isp %d\n",
+						video_id);
+
 			for (j = 0; j < nodecount; ++j) {
 				if (nodes[j].id == video_id) {
 					switch (nodes[j].match_type) {
@@ -2210,6 +2991,11 @@ static int viv_video_probe(struct platform_device *pdev)
 			vdev->last_ts = 0;
 			atomic_set(&(vdev->refcnt), 0);
 
+			snprintf(name, sizeof(name), "vvcam-video%d", video_id);
+			vdev->debugfs = debugfs_create_dir(name, NULL);
+			debugfs_create_file("stats", 0444, vdev->debugfs,
+					&vdev->perf, &viv_stats_fops);
+
 			continue;
 register_fail:
 			video_device_release(vdev->video);
@@ -2232,7 +3018,11 @@ static int viv_video_remove(struct platform_device *pdev)
 		vdev = vvdev[i];
 		if (!vdev || !vdev->video)
 			continue;
+		debugfs_remove_recursive(vdev->debugfs);
 #ifdef ENABLE_IRQ
+		viv_sp_unregister(&vdev->sp);
+		viv_meta_unregister(&vdev->stats);
+		viv_meta_unregister(&vdev->params);
 		media_entity_cleanup(&vdev->video->entity);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
 		v4l2_async_nf_cleanup(&vdev->subdev_notifier);
@@ -62,6 +62,7 @@
 
 #include "viv_video_kevent.h"
 #include "vvbuf.h"
+#include "vvcam_perf.h"
 
 #define MAX_SUBDEVS_NUM (8)
 #define VIDEO_NODE_NUM  (2)
@@ -80,6 +81,40 @@ struct viv_video_fmt {
 	int bpp;
 };
 
+/* per isp stats (META_CAPTURE) and params (META_OUTPUT) nodes */
+struct viv_meta_device {
+	struct vvbuf_ctx bctx;
+	struct video_device *video;
+	struct media_pad pad;
+	struct vb2_queue queue;
+	struct mutex lock;
+	spinlock_t qlock;		/* protects queued */
+	struct list_head queued;	/* buffers handed to the isp */
+	u32 dataformat;
+	u32 buffersize;
+	int id;
+};
+
+/* per isp self path capture node, streams next to the main node */
+struct viv_sp_device {
+	struct vvbuf_ctx bctx;
+	struct video_device *video;
+	struct media_pad pad;
+	struct vb2_queue queue;
+	struct mutex lock;
+	struct v4l2_format fmt;
+	int id;
+};
+
+/* counters since probe, exported through debugfs and never reset */
+struct viv_video_perf {
+	u32 frames;		/* buffers returned to user space */
+	u32 skipped;		/* sequence numbers never delivered */
+	u32 last_seq;
+	u32 fps;		/* latest 3s average, in 1/100 fps */
+	struct vvcam_hist latency;	/* start of frame to buffer done */
+};
+
 struct viv_video_device {
 	struct vvbuf_ctx bctx;
 	struct video_device *video;
@@ -114,6 +149,13 @@ struct viv_video_device {
 	bool frame_flag;
 	int dumpbuf_status;
 	struct vb2_dc_buf* dumpbuf;
+	struct viv_video_perf perf;
+	struct dentry *debugfs;
+#ifdef ENABLE_IRQ
+	struct viv_meta_device stats;
+	struct viv_meta_device params;
+	struct viv_sp_device sp;
+#endif
 };
 
 struct viv_video_file {
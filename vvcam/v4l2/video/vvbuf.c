@@ -50,9 +50,12 @@
  * version of this file.
  *
  *****************************************************************************/
+#include <linux/slab.h>
+#include <linux/log2.h>
 #include <media/v4l2-subdev.h>
 
 #include "vvbuf.h"
+#include "vvcam_trace.h"
 
 #ifdef ENABLE_IRQ
 
@@ -63,11 +66,95 @@ void vvbuf_ctx_init(struct vvbuf_ctx *ctx)
 
 	spin_lock_init(&ctx->irqlock);
 	INIT_LIST_HEAD(&ctx->dmaqueue);
+	memset(&ctx->ring, 0, sizeof(ctx->ring));
+	INIT_LIST_HEAD(&ctx->ring.requeue);
+}
+
+int vvbuf_ctx_init_ring(struct vvbuf_ctx *ctx, unsigned int depth)
+{
+	if (unlikely(!ctx || !depth))
+		return -EINVAL;
+
+	vvbuf_ctx_init(ctx);
+	depth = roundup_pow_of_two(depth);
+	ctx->ring.slots = kcalloc(depth, sizeof(*ctx->ring.slots), GFP_KERNEL);
+	if (!ctx->ring.slots)
+		return -ENOMEM;
+	ctx->ring.mask = depth - 1;
+	return 0;
 }
 
 void vvbuf_ctx_deinit(struct vvbuf_ctx *ctx)
 {
-	/*nop*/
+	if (unlikely(!ctx))
+		return;
+
+	kfree(ctx->ring.slots);
+	ctx->ring.slots = NULL;
+}
+
+static inline bool vvbuf_is_ring(struct vvbuf_ctx *ctx)
+{
+	return ctx->ring.slots != NULL;
+}
+
+static struct vb2_dc_buf *vvbuf_ring_peek(struct vvbuf_ring *ring)
+{
+	unsigned int head = ring->head;
+
+	if (!list_empty(&ring->requeue))
+		return list_first_entry(&ring->requeue,
+				struct vb2_dc_buf, irqlist);
+
+	/* pairs with the release in vvbuf_ring_push() */
+	if (head == smp_load_acquire(&ring->tail))
+		return NULL;
+	return ring->slots[head & ring->mask];
+}
+
+static void vvbuf_ring_advance(struct vvbuf_ring *ring)
+{
+	if (!list_empty(&ring->requeue)) {
+		list_del(ring->requeue.next);
+		return;
+	}
+
+	/* slot is consumed before the producer may reuse it */
+	smp_store_release(&ring->head, ring->head + 1);
+}
+
+static int vvbuf_ring_push(struct vvbuf_ring *ring, struct vb2_dc_buf *buf)
+{
+	unsigned int tail = ring->tail;
+
+	if (tail - smp_load_acquire(&ring->head) > ring->mask) {
+		ring->overflow++;
+		return -ENOSPC;
+	}
+	ring->slots[tail & ring->mask] = buf;
+	smp_store_release(&ring->tail, tail + 1);
+	return 0;
+}
+
+/* consumer side: drop everything queued so far */
+void vvbuf_ctx_flush(struct vvbuf_ctx *ctx)
+{
+	unsigned long flags;
+
+	if (unlikely(!ctx))
+		return;
+
+	if (vvbuf_is_ring(ctx)) {
+		INIT_LIST_HEAD(&ctx->ring.requeue);
+		smp_store_release(&ctx->ring.head,
+				smp_load_acquire(&ctx->ring.tail));
+		return;
+	}
+
+	spin_lock_irqsave(&ctx->irqlock, flags);
+	if (!list_empty(&ctx->dmaqueue))
+		list_del_init(&ctx->dmaqueue);
+	spin_unlock_irqrestore(&ctx->irqlock, flags);
 }
 
 struct vb2_dc_buf *vvbuf_pull_buf(struct vvbuf_ctx *ctx)
@@ -76,6 +163,14 @@ struct vb2_dc_buf *vvbuf_pull_buf(struct vvbuf_ctx *ctx)
 	struct vb2_dc_buf *buf = NULL;
 	if (unlikely(!ctx))
 		return NULL;
+
+	if (vvbuf_is_ring(ctx)) {
+		buf = vvbuf_ring_peek(&ctx->ring);
+		if (buf)
+			vvbuf_ring_advance(&ctx->ring);
+		return buf;
+	}
+
 	spin_lock_irqsave(&ctx->irqlock, flags);
 
 	if (list_empty(&ctx->dmaqueue)) {
@@ -92,17 +187,44 @@ struct vb2_dc_buf *vvbuf_pull_buf(struct vvbuf_ctx *ctx)
 int vvbuf_push_buf(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 {
 	unsigned long flags;
+	int rc;
 	if (unlikely(!ctx))
 		return -1;
 	if (unlikely(!buf))
 		return -1;
 
+	if (vvbuf_is_ring(ctx)) {
+		/* producers are serialized, the consumer never takes the lock */
+		spin_lock(&ctx->irqlock);
+		rc = vvbuf_ring_push(&ctx->ring, buf);
+		spin_unlock(&ctx->irqlock);
+		return rc;
+	}
+
 	spin_lock_irqsave(&ctx->irqlock, flags);
 	list_add_tail(&buf->irqlist, &ctx->dmaqueue);
 	spin_unlock_irqrestore(&ctx->irqlock, flags);
 	return 0;
 }
 
+/* consumer side: hand a pulled buffer back, it is the next one pulled */
+void vvbuf_requeue_buf(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
+{
+	unsigned long flags;
+
+	if (unlikely(!ctx || !buf))
+		return;
+
+	if (vvbuf_is_ring(ctx)) {
+		list_add(&buf->irqlist, &ctx->ring.requeue);
+		return;
+	}
+
+	spin_lock_irqsave(&ctx->irqlock, flags);
+	list_add(&buf->irqlist, &ctx->dmaqueue);
+	spin_unlock_irqrestore(&ctx->irqlock, flags);
+}
+
 
 
 struct vb2_dc_buf *vvbuf_try_dqbuf(struct vvbuf_ctx *ctx)
@@ -113,6 +235,9 @@ struct vb2_dc_buf *vvbuf_try_dqbuf(struct vvbuf_ctx *ctx)
 	if (unlikely(!ctx))
 		return NULL;
 
+	if (vvbuf_is_ring(ctx))
+		return vvbuf_ring_peek(&ctx->ring);
+
 	spin_lock_irqsave(&ctx->irqlock, flags);
 	if (list_empty(&ctx->dmaqueue)) {
 		spin_unlock_irqrestore(&ctx->irqlock, flags);
@@ -131,6 +256,12 @@ void vvbuf_try_dqbuf_done(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 	if (unlikely(!ctx))
 		return;
 
+	if (vvbuf_is_ring(ctx)) {
+		if (buf && buf == vvbuf_ring_peek(&ctx->ring))
+			vvbuf_ring_advance(&ctx->ring);
+		return;
+	}
+
 	spin_lock_irqsave(&ctx->irqlock, flags);
 	if (list_empty(&ctx->dmaqueue)) {
 		spin_unlock_irqrestore(&ctx->irqlock, flags);
@@ -143,20 +274,13 @@ void vvbuf_try_dqbuf_done(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf)
 	spin_unlock_irqrestore(&ctx->irqlock, flags);
 }
 
-void vvbuf_ready(struct vvbuf_ctx *ctx, struct media_pad *pad,
-				struct vb2_dc_buf *buf)
+/* entities keep one vvbuf_ctx per pad at the start of their drvdata */
+static struct vvbuf_ctx *vvbuf_pad_ctx(struct media_pad *pad)
 {
 	struct video_device *vdev;
 	struct v4l2_subdev *subdev;
 	struct vvbuf_ctx *rctx = NULL;
 
-	if (unlikely(!pad || !buf))
-		return;
-
-	pad = media_entity_remote_pad(pad);
-	if (!pad)
-		return;
-
 	if (is_media_entity_v4l2_video_device(pad->entity)) {
 		vdev = media_entity_to_video_device(pad->entity);
 		if (vdev)
@@ -167,11 +291,79 @@ void vvbuf_ready(struct vvbuf_ctx *ctx, struct media_pad *pad,
 			rctx = (struct vvbuf_ctx *)v4l2_get_subdevdata(subdev);
 	}
 
-	rctx += pad->index;
+	return rctx ? rctx + pad->index : NULL;
+}
+
+struct vvbuf_ctx *vvbuf_get_remote_ctx(struct media_pad *pad)
+{
+	if (unlikely(!pad))
+		return NULL;
+
+	pad = media_entity_remote_pad(pad);
+	if (!pad)
+		return NULL;
+
+	return vvbuf_pad_ctx(pad);
+}
+
+void vvbuf_ready(struct vvbuf_ctx *ctx, struct media_pad *pad,
+				struct vb2_dc_buf *buf)
+{
+	struct vvbuf_ctx *rctx;
+	struct media_pad *src = pad;
+
+	if (unlikely(!pad || !buf))
+		return;
+
+	pad = media_entity_remote_pad(pad);
+	if (!pad)
+		return;
+	trace_vvbuf_ready(src, pad, buf->vb.sequence);
+
+	rctx = vvbuf_pad_ctx(pad);
 	buf->pad = pad;
 
 	if (rctx && rctx->ops && rctx->ops->notify)
 		rctx->ops->notify(rctx, buf);
 }
 
+/* make the entity at the other end of pad give up our queued buffers */
+void vvbuf_release(struct media_pad *pad)
+{
+	struct vvbuf_ctx *rctx;
+
+	if (unlikely(!pad))
+		return;
+
+	pad = media_entity_remote_pad(pad);
+	if (!pad)
+		return;
+
+	rctx = vvbuf_pad_ctx(pad);
+	if (!rctx)
+		return;
+
+	if (rctx->ops && rctx->ops->release)
+		rctx->ops->release(rctx, pad);
+	else
+		vvbuf_ctx_flush(rctx);
+}
+
+int vvbuf_mmap(struct media_pad *pad, struct vm_area_struct *vma)
+{
+	struct vvbuf_ctx *rctx;
+
+	if (unlikely(!pad || !vma))
+		return -EINVAL;
+
+	pad = media_entity_remote_pad(pad);
+	if (!pad)
+		return -ENODEV;
+
+	rctx = vvbuf_pad_ctx(pad);
+	if (!rctx || !rctx->ops || !rctx->ops->mmap)
+		return -ENODEV;
+	return rctx->ops->mmap(rctx, pad, vma);
+}
+
 #endif
@@ -63,30 +63,66 @@ struct vb2_dc_buf {
 	struct vb2_v4l2_buffer vb;
 	struct media_pad *pad;
 	struct list_head irqlist;
+	struct list_head nodelist;	/* queued list of the owning node */
 	dma_addr_t dma;
 	int flags;
 };
 
 struct vvbuf_ctx;
+struct vm_area_struct;
 
 struct vvbuf_ops {
 	void (*notify)(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf);
+	/* drop the buffers queued through pad, none is completed after */
+	void (*release)(struct vvbuf_ctx *ctx, struct media_pad *pad);
+	/* map memory the entity shares through pad, other than buffers */
+	int (*mmap)(struct vvbuf_ctx *ctx, struct media_pad *pad,
+			struct vm_area_struct *vma);
+};
+
+/*
+ * A ctx either keeps its buffers on the spinlock protected dmaqueue, or,
+ * when set up with vvbuf_ctx_init_ring(), in a ring with a single
+ * consumer.  Pulls, peeks, flushes and vvbuf_requeue_buf() never take
+ * irqlock, so the caller must serialize them against each other (the isp
+ * does all of them under ic_dev.lock).
+ *
+ * Pushes to a ring still take irqlock, without disabling irqs: a queue
+ * can be fed from qbuf, the dwe irq thread and isp_buf_alloc() at once,
+ * and the slot has to be claimed by one of them at a time.  None of them
+ * runs in hard irq context, and nothing else may push to a ring from
+ * there; the consumer puts buffers back with vvbuf_requeue_buf().
+ */
+struct vvbuf_ring {
+	struct vb2_dc_buf **slots;
+	unsigned int mask;
+	unsigned int head;	/* consumer index */
+	unsigned int tail;	/* producer index */
+	unsigned int overflow;
+	struct list_head requeue;	/* put back by the consumer, taken first */
 };
 
 struct vvbuf_ctx {
 	spinlock_t irqlock;
 	struct list_head dmaqueue;
 	const struct vvbuf_ops *ops;
+	struct vvbuf_ring ring;
 };
 
 void vvbuf_ctx_init(struct vvbuf_ctx *ctx);
+int vvbuf_ctx_init_ring(struct vvbuf_ctx *ctx, unsigned int depth);
 void vvbuf_ctx_deinit(struct vvbuf_ctx *ctx);
+void vvbuf_ctx_flush(struct vvbuf_ctx *ctx);
 struct vb2_dc_buf *vvbuf_pull_buf(struct vvbuf_ctx *ctx);
 int vvbuf_push_buf(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf);
+void vvbuf_requeue_buf(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf);
 
 struct vb2_dc_buf *vvbuf_try_dqbuf(struct vvbuf_ctx *ctx);
 void vvbuf_try_dqbuf_done(struct vvbuf_ctx *ctx, struct vb2_dc_buf *buf);
 void vvbuf_ready(struct vvbuf_ctx *ctx, struct media_pad *pad,
 				struct vb2_dc_buf *buf);
+void vvbuf_release(struct media_pad *pad);
+int vvbuf_mmap(struct media_pad *pad, struct vm_area_struct *vma);
+struct vvbuf_ctx *vvbuf_get_remote_ctx(struct media_pad *pad);
 
 #endif /* _VVBUF_H_ */
@@ -0,0 +1,885 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#include <linux/bitmap.h>
+#include <linux/bsearch.h>
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+#include "vvsensor_i2c.h"
+
+static inline bool regs_follows(const struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *prev,
+		const struct vvcam_sccb_data_s *reg)
+{
+	return prev->addr != VVSENSOR_REG_DELAY &&
+	       reg->addr != VVSENSOR_REG_DELAY &&
+	       reg->addr == prev->addr + i2c->data_bytes;
+}
+
+static void regs_put(u8 *p, u32 val, u8 bytes)
+{
+	while (bytes--)
+		*p++ = val >> (8 * bytes);
+}
+
+static void regs_free(struct vvsensor_regs *regs)
+{
+	kfree(regs->buf);
+	kfree(regs->ops);
+	memset(regs, 0, sizeof(*regs));
+}
+
+/* two passes, the first sizes the message buffer and the op list */
+static int regs_compile(struct vvsensor_i2c *i2c, struct vvsensor_regs *regs,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	const u32 max_data = i2c->max_len - i2c->addr_bytes;
+	struct vvsensor_regs_op *op = NULL;
+	u32 pass, i, bytes, nops, run;
+
+	memset(regs, 0, sizeof(*regs));
+	regs->table = table;
+	regs->count = count;
+
+	for (pass = 0; pass < 2; ++pass) {
+		bytes = 0;
+		nops = 0;
+		run = 0;	/* data bytes in the open message */
+		for (i = 0; i < count; ++i) {
+			if (table[i].addr == VVSENSOR_REG_DELAY) {
+				if (pass) {
+					op = &regs->ops[nops];
+					op->offset = bytes;
+					op->len = 0;
+					op->delay_ms = table[i].data;
+				}
+				nops++;
+				run = 0;
+				continue;
+			}
+			if (!run || !regs_follows(i2c, &table[i - 1], &table[i]) ||
+			    run + i2c->data_bytes > max_data) {
+				if (pass) {
+					op = &regs->ops[nops];
+					op->offset = bytes;
+					op->len = i2c->addr_bytes;
+					op->delay_ms = 0;
+					regs_put(regs->buf + bytes, table[i].addr,
+						 i2c->addr_bytes);
+				}
+				nops++;
+				bytes += i2c->addr_bytes;
+				run = 0;
+			}
+			if (pass) {
+				regs_put(regs->buf + bytes, table[i].data,
+					 i2c->data_bytes);
+				op->len += i2c->data_bytes;
+			}
+			bytes += i2c->data_bytes;
+			run += i2c->data_bytes;
+		}
+		if (pass)
+			break;
+
+		regs->buf = kmalloc(max_t(u32, bytes, 1), GFP_KERNEL);
+		regs->ops = kcalloc(max_t(u32, nops, 1), sizeof(*regs->ops),
+				    GFP_KERNEL);
+		if (!regs->buf || !regs->ops) {
+			regs_free(regs);
+			return -ENOMEM;
+		}
+	}
+
+	regs->nops = nops;
+	regs->bytes = bytes;
+	return 0;
+}
+
+static int regs_write(struct vvsensor_i2c *i2c,
+		const struct vvsensor_regs *regs)
+{
+	struct i2c_client *client = i2c->client;
+	struct i2c_msg msg;
+	u32 i;
+	int ret;
+
+	msg.addr = client->addr;
+	msg.flags = client->flags;
+	for (i = 0; i < regs->nops; ++i) {
+		if (!regs->ops[i].len) {
+			msleep(regs->ops[i].delay_ms);
+			continue;
+		}
+		msg.buf = regs->buf + regs->ops[i].offset;
+		msg.len = regs->ops[i].len;
+		ret = i2c_transfer(client->adapter, &msg, 1);
+		if (ret < 0) {
+			dev_err(&client->dev, "%s: write 0x%x error %d\n",
+				__func__, (msg.buf[0] << 8) | msg.buf[1], ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static struct vvsensor_regs *regs_find(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < i2c->ntables; ++i)
+		if (i2c->tables[i].table == table &&
+		    i2c->tables[i].count == count)
+			return &i2c->tables[i];
+	return NULL;
+}
+
+static int regs_read(struct vvsensor_i2c *i2c, u32 addr, u32 *val)
+{
+	struct i2c_client *client = i2c->client;
+	u8 buf[2];
+	u32 i;
+
+	regs_put(buf, addr, i2c->addr_bytes);
+	if (i2c_master_send(client, buf, i2c->addr_bytes) != i2c->addr_bytes)
+		return -EIO;
+	if (i2c_master_recv(client, buf, i2c->data_bytes) != i2c->data_bytes)
+		return -EIO;
+
+	*val = 0;
+	for (i = 0; i < i2c->data_bytes; ++i)
+		*val = (*val << 8) | buf[i];
+	return 0;
+}
+
+static u32 regs_flags(const struct vvsensor_i2c *i2c, u32 addr)
+{
+	u32 i, flags = 0;
+
+	for (i = 0; i < i2c->nranges; ++i)
+		if (addr >= i2c->ranges[i].first && addr <= i2c->ranges[i].last)
+			flags |= i2c->ranges[i].flags;
+	return flags;
+}
+
+/* what a diff knows about one register */
+struct regs_state {
+	u32 addr;
+	u32 data;
+	u16 tables;	/* mode tables writing it */
+	u16 seen;	/* last of them, plus one */
+	u8 known;	/* data is the register value */
+	u8 from;	/* written by the old mode */
+	u8 to;		/* written by the new mode */
+};
+
+static int regs_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;	/* addr comes first */
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 regs_state_sort(struct regs_state *st, u32 n)
+{
+	u32 i, j = 0;
+
+	sort(st, n, sizeof(*st), regs_cmp, NULL);
+	for (i = 0; i < n; ++i)
+		if (!j || st[i].addr != st[j - 1].addr)
+			st[j++] = st[i];
+	return j;
+}
+
+static struct regs_state *regs_state_find(struct regs_state *st, u32 n,
+		u32 addr)
+{
+	return bsearch(&addr, st, n, sizeof(*st), regs_cmp);
+}
+
+static struct vvcam_sccb_data_s *regs_cache_find(struct vvsensor_i2c *i2c,
+		u32 addr)
+{
+	if (!i2c->ncache)
+		return NULL;
+	return bsearch(&addr, i2c->cache, i2c->ncache, sizeof(*i2c->cache),
+		       regs_cmp);
+}
+
+static void regs_cache_drop(struct vvsensor_i2c *i2c)
+{
+	if (i2c->ncache)
+		bitmap_zero(i2c->cache_valid, i2c->ncache);
+}
+
+static void regs_cache_set(struct vvsensor_i2c *i2c, u32 addr, u32 val)
+{
+	struct vvcam_sccb_data_s *slot = regs_cache_find(i2c, addr);
+
+	if (!slot)
+		return;
+	slot->data = val;
+	set_bit(slot - i2c->cache, i2c->cache_valid);
+}
+
+/* regs_write with the cache following the table, dropped on errors */
+static int regs_send(struct vvsensor_i2c *i2c,
+		const struct vvsensor_regs *regs)
+{
+	u32 i;
+	int ret;
+
+	ret = regs_write(i2c, regs);
+	if (ret) {
+		regs_cache_drop(i2c);
+		return ret;
+	}
+	for (i = 0; i < regs->count; ++i)
+		if (regs->table[i].addr != VVSENSOR_REG_DELAY)
+			regs_cache_set(i2c, regs->table[i].addr,
+				       regs->table[i].data);
+	return 0;
+}
+
+static const struct vvcam_sccb_data_s *regs_default(
+		const struct vvsensor_i2c *i2c, u32 addr)
+{
+	return bsearch(&addr, i2c->defaults, i2c->ndefaults,
+		       sizeof(*i2c->defaults), regs_cmp);
+}
+
+/*
+ * A diff starts from another mode instead of the reset state, so every
+ * register a mode leaves alone needs its reset value: read the ones some
+ * but not all mode tables write, the sensor has to be fresh from reset.
+ */
+static int regs_read_defaults(struct vvsensor_i2c *i2c)
+{
+	struct regs_state *st, *s;
+	const struct vvsensor_regs *t;
+	u32 i, k, n = 0, nmodes = 0, val;
+
+	for (k = 0; k < i2c->ntables; ++k)
+		if (i2c->tables[k].mode)
+			n += i2c->tables[k].count;
+	st = kcalloc(max_t(u32, n, 1), sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	n = 0;
+	for (k = 0; k < i2c->ntables; ++k) {
+		t = &i2c->tables[k];
+		if (!t->mode)
+			continue;
+		nmodes++;
+		for (i = 0; i < t->count; ++i)
+			if (t->table[i].addr != VVSENSOR_REG_DELAY)
+				st[n++].addr = t->table[i].addr;
+	}
+	n = regs_state_sort(st, n);
+
+	for (k = 0; k < i2c->ntables; ++k) {
+		t = &i2c->tables[k];
+		if (!t->mode)
+			continue;
+		for (i = 0; i < t->count; ++i) {
+			s = regs_state_find(st, n, t->table[i].addr);
+			if (s && s->seen != k + 1) {
+				s->seen = k + 1;
+				s->tables++;
+			}
+		}
+	}
+
+	kfree(i2c->defaults);
+	i2c->defaults = kcalloc(max_t(u32, n, 1), sizeof(*i2c->defaults),
+				GFP_KERNEL);
+	i2c->ndefaults = 0;
+	if (!i2c->defaults) {
+		kfree(st);
+		return -ENOMEM;
+	}
+	for (i = 0; i < n; ++i) {
+		if (st[i].tables == nmodes ||
+		    regs_flags(i2c, st[i].addr) & VVSENSOR_REG_TRIGGER)
+			continue;
+		if (regs_read(i2c, st[i].addr, &val)) {
+			dev_dbg(&i2c->client->dev, "%s: 0x%x unreadable\n",
+				__func__, st[i].addr);
+			continue;
+		}
+		i2c->defaults[i2c->ndefaults].addr = st[i].addr;
+		i2c->defaults[i2c->ndefaults++].data = val;
+	}
+	kfree(st);
+	return 0;
+}
+
+/*
+ * The diff writes, in order: the reset value of registers only the old
+ * mode sets, then the new table without the entries that already hold
+ * their value.  Switch registers are always written, triggers never,
+ * delays only after a written entry.  -EINVAL when the old mode sets a
+ * register whose reset value is unknown.
+ */
+static int regs_diff(struct vvsensor_i2c *i2c, struct vvsensor_regs_diff *diff,
+		const struct vvsensor_regs *from, const struct vvsensor_regs *to)
+{
+	const struct vvcam_sccb_data_s *reg, *def;
+	struct vvcam_sccb_data_s *out;
+	struct regs_state *st, *s;
+	u32 i, n = 0, nout = 0, flags;
+	bool written = false;
+	int ret;
+
+	st = kcalloc(i2c->ndefaults + from->count + to->count, sizeof(*st),
+		     GFP_KERNEL);
+	out = kcalloc(from->count + to->count, sizeof(*out), GFP_KERNEL);
+	if (!st || !out) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < i2c->ndefaults; ++i)
+		st[n++].addr = i2c->defaults[i].addr;
+	for (i = 0; i < from->count; ++i)
+		if (from->table[i].addr != VVSENSOR_REG_DELAY)
+			st[n++].addr = from->table[i].addr;
+	for (i = 0; i < to->count; ++i)
+		if (to->table[i].addr != VVSENSOR_REG_DELAY)
+			st[n++].addr = to->table[i].addr;
+	n = regs_state_sort(st, n);
+
+	for (i = 0; i < i2c->ndefaults; ++i) {
+		s = regs_state_find(st, n, i2c->defaults[i].addr);
+		s->data = i2c->defaults[i].data;
+		s->known = 1;
+	}
+	for (i = 0; i < from->count; ++i) {
+		reg = &from->table[i];
+		if (reg->addr == VVSENSOR_REG_DELAY)
+			continue;
+		s = regs_state_find(st, n, reg->addr);
+		s->data = reg->data;
+		s->known = 1;
+		s->from = 1;
+	}
+	for (i = 0; i < to->count; ++i)
+		if (to->table[i].addr != VVSENSOR_REG_DELAY)
+			regs_state_find(st, n, to->table[i].addr)->to = 1;
+
+	for (i = 0; i < n; ++i) {
+		s = &st[i];
+		if (!s->from || s->to ||
+		    regs_flags(i2c, s->addr) & VVSENSOR_REG_TRIGGER)
+			continue;
+		def = regs_default(i2c, s->addr);
+		if (!def) {
+			ret = -EINVAL;
+			goto err;
+		}
+		if (def->data != s->data)
+			out[nout++] = *def;
+	}
+
+	for (i = 0; i < to->count; ++i) {
+		reg = &to->table[i];
+		if (reg->addr == VVSENSOR_REG_DELAY) {
+			if (written)
+				out[nout++] = *reg;
+			continue;
+		}
+		flags = regs_flags(i2c, reg->addr);
+		s = regs_state_find(st, n, reg->addr);
+		written = !(flags & VVSENSOR_REG_TRIGGER) &&
+			  ((flags & VVSENSOR_REG_SWITCH) || !s->known ||
+			   s->data != reg->data);
+		if (!written)
+			continue;
+		out[nout++] = *reg;
+		s->data = reg->data;
+		s->known = 1;
+	}
+
+	ret = regs_compile(i2c, &diff->regs, out, nout);
+	if (ret)
+		goto err;
+	diff->from = from->table;
+	diff->to = to->table;
+	diff->table = out;
+	kfree(st);
+	return 0;
+
+err:
+	kfree(out);
+	kfree(st);
+	return ret;
+}
+
+static struct vvsensor_regs_diff *regs_diff_find(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *from,
+		const struct vvcam_sccb_data_s *to)
+{
+	u32 i;
+
+	for (i = 0; i < i2c->ndiffs; ++i)
+		if (i2c->diffs[i].from == from && i2c->diffs[i].to == to)
+			return &i2c->diffs[i];
+	return NULL;
+}
+
+int vvsensor_i2c_init(struct vvsensor_i2c *i2c, struct i2c_client *client,
+		u8 addr_bytes, u8 data_bytes)
+{
+	const struct i2c_adapter_quirks *q = client->adapter->quirks;
+
+	if (addr_bytes < 1 || addr_bytes > 2 ||
+	    data_bytes < 1 || data_bytes > 2)
+		return -EINVAL;
+
+	memset(i2c, 0, sizeof(*i2c));
+	mutex_init(&i2c->lock);
+	i2c->client = client;
+	i2c->addr_bytes = addr_bytes;
+	i2c->data_bytes = data_bytes;
+	i2c->max_len = VVSENSOR_I2C_MAX_LEN;
+	if (q && q->max_write_len)
+		i2c->max_len = min_t(u32, i2c->max_len, q->max_write_len);
+	if (i2c->max_len < addr_bytes + data_bytes)
+		return -EINVAL;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_init);
+
+void vvsensor_i2c_exit(struct vvsensor_i2c *i2c)
+{
+	u32 i;
+
+	for (i = 0; i < i2c->ntables; ++i)
+		regs_free(&i2c->tables[i]);
+	kfree(i2c->tables);
+	i2c->tables = NULL;
+	i2c->ntables = 0;
+
+	for (i = 0; i < i2c->ndiffs; ++i) {
+		regs_free(&i2c->diffs[i].regs);
+		kfree(i2c->diffs[i].table);
+	}
+	kfree(i2c->diffs);
+	i2c->diffs = NULL;
+	i2c->ndiffs = 0;
+	kfree(i2c->defaults);
+	i2c->defaults = NULL;
+	i2c->ndefaults = 0;
+	i2c->mode = NULL;
+	kfree(i2c->cache);
+	bitmap_free(i2c->cache_valid);
+	i2c->cache = NULL;
+	i2c->cache_valid = NULL;
+	i2c->ncache = 0;
+	mutex_destroy(&i2c->lock);
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_exit);
+
+/* caller holds i2c->lock */
+static int regs_add_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count, bool mode)
+{
+	struct vvsensor_regs *tables, *regs;
+	int ret;
+
+	if (!table || !count)
+		return 0;
+	regs = regs_find(i2c, table, count);
+	if (regs) {
+		regs->mode |= mode;
+		return 0;
+	}
+
+	tables = krealloc(i2c->tables, (i2c->ntables + 1) * sizeof(*tables),
+			  GFP_KERNEL);
+	if (!tables)
+		return -ENOMEM;
+	i2c->tables = tables;
+
+	ret = regs_compile(i2c, &tables[i2c->ntables], table, count);
+	if (ret)
+		return ret;
+	tables[i2c->ntables].mode = mode;
+	dev_dbg(&i2c->client->dev, "%s: %u registers, %u writes, %u bytes\n",
+		__func__, count, tables[i2c->ntables].nops,
+		tables[i2c->ntables].bytes);
+	i2c->ntables++;
+	return 0;
+}
+
+/* compiles a table for later vvsensor_i2c_write_table calls, call it at
+ * probe for each mode table */
+int vvsensor_i2c_add_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	ret = regs_add_table(i2c, table, count, false);
+	mutex_unlock(&i2c->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_add_table);
+
+/* as add_table, the table is also a mode for vvsensor_i2c_add_diffs */
+int vvsensor_i2c_add_mode(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	ret = regs_add_table(i2c, table, count, true);
+	mutex_unlock(&i2c->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_add_mode);
+
+/* a table that fails to compile here is compiled at each write instead */
+void vvsensor_i2c_add_modes(struct vvsensor_i2c *i2c,
+		const struct vvcam_mode_info_s *modes, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < count; ++i)
+		if (vvsensor_i2c_add_mode(i2c, modes[i].preg_data,
+					  modes[i].reg_data_count))
+			dev_warn(&i2c->client->dev,
+				 "%s: mode %u not precompiled\n",
+				 __func__, modes[i].index);
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_add_modes);
+
+/*
+ * Compiles a diff for every ordered pair of mode tables.  Call it at
+ * probe after the modes are added, with the sensor powered and fresh
+ * from reset: it reads the reset value of registers not every mode
+ * writes.  A pair needing a reset value it could not read keeps the
+ * full reset and table write.
+ */
+static int regs_add_diffs(struct vvsensor_i2c *i2c)
+{
+	struct vvsensor_regs_diff *diffs;
+	const struct vvsensor_regs *from, *to;
+	u32 i, j;
+	int ret;
+
+	ret = regs_read_defaults(i2c);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < i2c->ntables; ++i) {
+		for (j = 0; j < i2c->ntables; ++j) {
+			from = &i2c->tables[i];
+			to = &i2c->tables[j];
+			if (i == j || !from->mode || !to->mode ||
+			    regs_diff_find(i2c, from->table, to->table))
+				continue;
+
+			diffs = krealloc(i2c->diffs,
+					 (i2c->ndiffs + 1) * sizeof(*diffs),
+					 GFP_KERNEL);
+			if (!diffs)
+				return -ENOMEM;
+			i2c->diffs = diffs;
+
+			ret = regs_diff(i2c, &diffs[i2c->ndiffs], from, to);
+			if (ret == -EINVAL) {
+				dev_dbg(&i2c->client->dev,
+					"%s: table %u -> %u needs a reset\n",
+					__func__, i, j);
+				continue;
+			}
+			if (ret)
+				return ret;
+			dev_dbg(&i2c->client->dev,
+				"%s: table %u -> %u: %u writes, %u bytes, full %u writes, %u bytes\n",
+				__func__, i, j, diffs[i2c->ndiffs].regs.nops,
+				diffs[i2c->ndiffs].regs.bytes, to->nops,
+				to->bytes);
+			i2c->ndiffs++;
+		}
+	}
+	return 0;
+}
+
+int vvsensor_i2c_add_diffs(struct vvsensor_i2c *i2c)
+{
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	ret = regs_add_diffs(i2c);
+	mutex_unlock(&i2c->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_add_diffs);
+
+/* caller holds i2c->lock */
+static int regs_write_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	struct vvsensor_regs *regs, tmp;
+	int ret;
+
+	if (!table || !count)
+		return 0;
+
+	regs = regs_find(i2c, table, count);
+	if (regs)
+		return regs_send(i2c, regs);
+
+	ret = regs_compile(i2c, &tmp, table, count);
+	if (ret)
+		return ret;
+	ret = regs_send(i2c, &tmp);
+	regs_free(&tmp);
+	return ret;
+}
+
+/* writes a table, precompiled or compiled for this call */
+int vvsensor_i2c_write_table(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	ret = regs_write_table(i2c, table, count);
+	mutex_unlock(&i2c->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_write_table);
+
+/*
+ * Programs a mode table, the sensor out of streaming.  With a diff from
+ * the mode programmed last only the diff is written, otherwise reset
+ * (the soft reset sequence, may be NULL) and then the whole table.
+ */
+int vvsensor_i2c_write_mode(struct vvsensor_i2c *i2c,
+		const struct vvcam_sccb_data_s *reset, u32 reset_count,
+		const struct vvcam_sccb_data_s *table, u32 count)
+{
+	struct vvsensor_regs_diff *diff = NULL;
+	const struct vvsensor_regs *regs;
+	ktime_t start = ktime_get();
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	if (i2c->mode)
+		diff = regs_diff_find(i2c, i2c->mode, table);
+	i2c->mode = NULL;
+
+	if (diff) {
+		regs = &diff->regs;
+		ret = regs_send(i2c, regs);
+	} else {
+		/* the reset, in front of the table or in it, clears the sensor */
+		regs_cache_drop(i2c);
+		regs = regs_find(i2c, table, count);
+		ret = regs_write_table(i2c, reset, reset_count);
+		if (!ret)
+			ret = regs_write_table(i2c, table, count);
+	}
+	if (!ret)
+		i2c->mode = table;
+	mutex_unlock(&i2c->lock);
+	if (ret)
+		return ret;
+
+	dev_dbg(&i2c->client->dev, "%s: %s, %u writes, %u bytes, %lld us\n",
+		__func__, diff ? "diff" : "full", regs ? regs->nops : 0,
+		regs ? regs->bytes : 0, ktime_us_delta(ktime_get(), start));
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_write_mode);
+
+/* the sensor lost or may have lost its registers: power off, reset,
+ * raw register writes from user space */
+void vvsensor_i2c_invalidate(struct vvsensor_i2c *i2c)
+{
+	mutex_lock(&i2c->lock);
+	i2c->mode = NULL;
+	regs_cache_drop(i2c);
+	mutex_unlock(&i2c->lock);
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_invalidate);
+
+/*
+ * Gives every register of the added tables and of the non volatile
+ * ranges a cache slot, call it at probe after the tables and ranges.
+ * Other registers are always read from the sensor.
+ */
+static int regs_add_cache(struct vvsensor_i2c *i2c)
+{
+	const struct vvsensor_reg_range *r;
+	struct vvcam_sccb_data_s *cache;
+	u32 i, k, n = 0, addr;
+
+	for (k = 0; k < i2c->ntables; ++k)
+		n += i2c->tables[k].count;
+	for (k = 0; k < i2c->nranges; ++k)
+		n += i2c->ranges[k].last - i2c->ranges[k].first + 1;
+	cache = kcalloc(max_t(u32, n, 1), sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return -ENOMEM;
+
+	n = 0;
+	for (k = 0; k < i2c->ntables; ++k)
+		for (i = 0; i < i2c->tables[k].count; ++i)
+			if (i2c->tables[k].table[i].addr != VVSENSOR_REG_DELAY)
+				cache[n++].addr = i2c->tables[k].table[i].addr;
+	for (k = 0; k < i2c->nranges; ++k) {
+		r = &i2c->ranges[k];
+		for (addr = r->first; addr <= r->last; ++addr)
+			cache[n++].addr = addr;
+	}
+	sort(cache, n, sizeof(*cache), regs_cmp, NULL);
+
+	for (i = 0, k = 0; i < n; ++i) {
+		if (k && cache[i].addr == cache[k - 1].addr)
+			continue;
+		if (regs_flags(i2c, cache[i].addr) &
+		    (VVSENSOR_REG_TRIGGER | VVSENSOR_REG_VOLATILE))
+			continue;
+		cache[k++] = cache[i];
+	}
+
+	kfree(i2c->cache);
+	bitmap_free(i2c->cache_valid);
+	i2c->cache = cache;
+	i2c->ncache = k;
+	i2c->cache_valid = bitmap_zalloc(max_t(u32, k, 1), GFP_KERNEL);
+	if (!i2c->cache_valid) {
+		kfree(i2c->cache);
+		i2c->cache = NULL;
+		i2c->ncache = 0;
+		return -ENOMEM;
+	}
+	dev_dbg(&i2c->client->dev, "%s: %u registers\n", __func__, k);
+	return 0;
+}
+
+int vvsensor_i2c_add_cache(struct vvsensor_i2c *i2c)
+{
+	int ret;
+
+	mutex_lock(&i2c->lock);
+	ret = regs_add_cache(i2c);
+	mutex_unlock(&i2c->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_add_cache);
+
+int vvsensor_i2c_write(struct vvsensor_i2c *i2c, u32 addr, u32 val)
+{
+	struct i2c_client *client = i2c->client;
+	u8 buf[4];
+	int ret;
+
+	regs_put(buf, addr, i2c->addr_bytes);
+	regs_put(buf + i2c->addr_bytes, val, i2c->data_bytes);
+	mutex_lock(&i2c->lock);
+	ret = i2c_master_send(client, buf, i2c->addr_bytes + i2c->data_bytes);
+	if (ret < 0) {
+		regs_cache_drop(i2c);
+		mutex_unlock(&i2c->lock);
+		dev_err(&client->dev, "%s: reg=%x, val=%x error %d\n",
+			__func__, addr, val, ret);
+		return ret;
+	}
+	regs_cache_set(i2c, addr, val);
+	mutex_unlock(&i2c->lock);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_write);
+
+/* served from the cache when the register holds a known value */
+int vvsensor_i2c_read(struct vvsensor_i2c *i2c, u32 addr, u32 *val)
+{
+	struct vvcam_sccb_data_s *slot;
+	int ret = 0;
+
+	mutex_lock(&i2c->lock);
+	slot = regs_cache_find(i2c, addr);
+	if (slot && test_bit(slot - i2c->cache, i2c->cache_valid)) {
+		*val = slot->data;
+		goto out;
+	}
+
+	ret = regs_read(i2c, addr, val);
+	if (!ret && slot) {
+		slot->data = *val;
+		set_bit(slot - i2c->cache, i2c->cache_valid);
+	}
+out:
+	mutex_unlock(&i2c->lock);
+	if (ret)
+		dev_err(&i2c->client->dev, "%s: reg=%x error %d\n",
+			__func__, addr, ret);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(vvsensor_i2c_read);
+
+MODULE_DESCRIPTION("Verisilicon vvcam sensor helpers");
+MODULE_AUTHOR("Verisilicon ISP SW Team");
+MODULE_LICENSE("GPL");
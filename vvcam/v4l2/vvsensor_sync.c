@@ -0,0 +1,445 @@
+/****************************************************************************
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************
+ *
+ * The GPL License (GPL)
+ *
+ * Copyright (c) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program;
+ *
+ *****************************************************************************
+ *
+ * Note: This software is released under dual MIT and GPL licenses. A
+ * recipient may use this file under the terms of either the MIT license or
+ * GPL License. If you wish to use only one license not the other, you can
+ * indicate your decision by deleting one of the above license notices in your
+ * version of this file.
+ *
+ *****************************************************************************/
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/uaccess.h>
+
+#include "vvsensor_sync.h"
+
+static LIST_HEAD(sync_list);
+static DEFINE_SPINLOCK(sync_list_lock);
+
+static inline int sync_index(u32 cmd)
+{
+	if (cmd < VVSENSORIOC_S_LONG_EXP || cmd > VVSENSORIOC_S_FPS)
+		return -EINVAL;
+	return cmd - VVSENSORIOC_S_LONG_EXP;
+}
+
+/* caller holds sync->lock */
+static void sync_record(struct vvsensor_sync *sync, int idx,
+		u32 sequence, u32 value)
+{
+	struct vvsensor_sync_history *h = &sync->history[idx];
+	u32 pos = h->count % VVSENSOR_SYNC_HISTORY;
+
+	h->sequence[pos] = sequence;
+	h->value[pos] = value;
+	h->count++;
+}
+
+/* caller holds sync->lock, returns the latest value taking effect on or
+ * before sequence, the later write on equal frames */
+static u32 sync_lookup(struct vvsensor_sync *sync, int idx, u32 sequence)
+{
+	struct vvsensor_sync_history *h = &sync->history[idx];
+	u32 n = min_t(u32, h->count, VVSENSOR_SYNC_HISTORY);
+	u32 i, pos, value = 0;
+	s32 best = S32_MIN, d;
+
+	for (i = 0; i < n; ++i) {
+		pos = (h->count - n + i) % VVSENSOR_SYNC_HISTORY;
+		d = (s32)(h->sequence[pos] - sequence);
+		if (d <= 0 && d >= best) {
+			best = d;
+			value = h->value[pos];
+		}
+	}
+	return value;
+}
+
+/* caller holds sync->lock */
+static void sync_applied(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w)
+{
+	int idx = sync_index(w->cmd);
+	u32 frame = w->frame;
+
+	if (sync->synced && (s32)(sync->sequence - frame) > 0) {
+		if (sync->started)
+			sync->late++;
+		frame = sync->sequence;
+	}
+	sync_record(sync, idx, frame + sync->delay[idx], w->value);
+}
+
+/* caller holds sync->mutex; several writes go to the sensor as one group
+ * when the driver can, one by one otherwise */
+static int sync_apply(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w, u32 n)
+{
+	unsigned long flags;
+	u32 i;
+	int ret = 0, err;
+
+	if (n > 1 && sync->apply_group) {
+		ret = sync->apply_group(sync, w, n);
+		if (ret)
+			return ret;
+		spin_lock_irqsave(&sync->lock, flags);
+		for (i = 0; i < n; ++i)
+			sync_applied(sync, &w[i]);
+		spin_unlock_irqrestore(&sync->lock, flags);
+		return 0;
+	}
+
+	for (i = 0; i < n; ++i) {
+		err = sync->apply(sync, w[i].cmd, w[i].value);
+		if (err) {
+			ret = err;
+			continue;
+		}
+		spin_lock_irqsave(&sync->lock, flags);
+		sync_applied(sync, &w[i]);
+		spin_unlock_irqrestore(&sync->lock, flags);
+	}
+	return ret;
+}
+
+/* caller holds sync->lock, whether w belongs to the newest batch */
+static bool sync_in_batch(struct vvsensor_sync *sync,
+		const struct vvsensor_sync_write *w)
+{
+	return w->frame + sync->delay[sync_index(w->cmd)] == sync->target;
+}
+
+/* takes the writes due on frame, all of them if !due_only */
+static u32 sync_take(struct vvsensor_sync *sync, bool due_only,
+		struct vvsensor_sync_write *out)
+{
+	unsigned long flags;
+	u32 i, n = 0, left = 0;
+
+	spin_lock_irqsave(&sync->lock, flags);
+	for (i = 0; i < sync->nwrites; ++i) {
+		if (!due_only ||
+		    (s32)(sync->writes[i].frame - sync->sequence) <= 0) {
+			if (sync_in_batch(sync, &sync->writes[i]))
+				sync->open = false;
+			out[n++] = sync->writes[i];
+		} else {
+			sync->writes[left++] = sync->writes[i];
+		}
+	}
+	sync->nwrites = left;
+	if (!left)
+		sync->open = false;
+	spin_unlock_irqrestore(&sync->lock, flags);
+	return n;
+}
+
+static void sync_work(struct work_struct *work)
+{
+	struct vvsensor_sync *sync =
+		container_of(work, struct vvsensor_sync, work);
+	struct vvsensor_sync_write w[VVSENSOR_SYNC_WRITES];
+	u32 n;
+
+	mutex_lock(&sync->mutex);
+	n = sync_take(sync, true, w);
+	if (n)
+		sync_apply(sync, w, n);
+	mutex_unlock(&sync->mutex);
+}
+
+void vvsensor_sync_init(struct vvsensor_sync *sync, u32 isp_id,
+		vvsensor_sync_apply_t apply)
+{
+	memset(sync, 0, sizeof(*sync));
+	INIT_LIST_HEAD(&sync->list);
+	INIT_WORK(&sync->work, sync_work);
+	mutex_init(&sync->mutex);
+	spin_lock_init(&sync->lock);
+	sync->isp_id = isp_id;
+	sync->apply = apply;
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_init);
+
+void vvsensor_sync_start(struct vvsensor_sync *sync,
+		const vvcam_ae_info_t *ae_info)
+{
+	u8 int_delay = max_t(u8, ae_info->int_update_delay_frm, 1);
+	u8 gain_delay = max_t(u8, ae_info->gain_update_delay_frm, 1);
+	struct vvsensor_sync_history *h;
+	unsigned long flags;
+	u32 value;
+	int i;
+
+	spin_lock_irqsave(&sync->lock, flags);
+	/* frame numbers restart with the stream, what was written before
+	 * holds from its first frame */
+	for (i = 0; i < VVSENSOR_SYNC_NUM; ++i) {
+		sync->delay[i] = i >= VVSENSOR_SYNC_LONG_GAIN &&
+				 i <= VVSENSOR_SYNC_VSGAIN ?
+				gain_delay : int_delay;
+		h = &sync->history[i];
+		if (!h->count)
+			continue;
+		value = h->value[(h->count - 1) % VVSENSOR_SYNC_HISTORY];
+		h->count = 0;
+		sync_record(sync, i, 0, value);
+	}
+	sync->sequence = 0;
+	sync->nwrites = 0;
+	sync->late = 0;
+	sync->open = false;
+	sync->synced = false;
+	sync->started = true;
+	spin_unlock_irqrestore(&sync->lock, flags);
+
+	spin_lock_irqsave(&sync_list_lock, flags);
+	if (list_empty(&sync->list))
+		list_add_tail(&sync->list, &sync_list);
+	spin_unlock_irqrestore(&sync_list_lock, flags);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_start);
+
+/* may run with the sensor lock held, so it does not wait for the worker;
+ * the writes still queued go out now, after any the worker took */
+void vvsensor_sync_stop(struct vvsensor_sync *sync)
+{
+	struct vvsensor_sync_write w[VVSENSOR_SYNC_WRITES];
+	unsigned long flags;
+	u32 n;
+
+	spin_lock_irqsave(&sync_list_lock, flags);
+	list_del_init(&sync->list);
+	spin_unlock_irqrestore(&sync_list_lock, flags);
+
+	mutex_lock(&sync->mutex);
+	spin_lock_irqsave(&sync->lock, flags);
+	sync->started = false;
+	spin_unlock_irqrestore(&sync->lock, flags);
+	n = sync_take(sync, false, w);
+	if (n)
+		sync_apply(sync, w, n);
+	mutex_unlock(&sync->mutex);
+
+	if (sync->late)
+		pr_debug("%s: isp %u, %u ae writes after their frame\n",
+			 __func__, sync->isp_id, sync->late);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_stop);
+
+void vvsensor_sync_exit(struct vvsensor_sync *sync)
+{
+	vvsensor_sync_stop(sync);
+	cancel_work_sync(&sync->work);
+	mutex_destroy(&sync->mutex);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_exit);
+
+/* caller holds sync->lock, the slot of cmd in the open batch or nwrites */
+static u32 sync_slot(struct vvsensor_sync *sync, u32 cmd)
+{
+	u32 j;
+
+	if (!sync->open)
+		return sync->nwrites;
+	for (j = 0; j < sync->nwrites; ++j)
+		if (sync->writes[j].cmd == cmd &&
+		    sync_in_batch(sync, &sync->writes[j]))
+			break;
+	return j;
+}
+
+/* writes queued in one frame share a target frame, each register written
+ * its own update delay before it, so exposure and gain change together.
+ * Writes joining a batch of an earlier frame move it whole to the new
+ * target while none of it went out; a batch partly written keeps its
+ * frames and the new writes start the next one */
+int vvsensor_sync_set_group(struct vvsensor_sync *sync,
+		struct vvsensor_sync_write *w, u32 n)
+{
+	unsigned long flags;
+	u32 i, j, target, slots = 0;
+	u8 delay = 0;
+	int idx, ret;
+
+	if (!n || n > VVSENSOR_SYNC_NUM)
+		return -EINVAL;
+	for (i = 0; i < n; ++i)
+		if (sync_index(w[i].cmd) < 0)
+			return -EINVAL;
+
+	spin_lock_irqsave(&sync->lock, flags);
+	if (!sync->started || !sync->synced) {
+		for (i = 0; i < n; ++i)
+			w[i].frame = sync->sequence;
+		spin_unlock_irqrestore(&sync->lock, flags);
+
+		mutex_lock(&sync->mutex);
+		ret = sync_apply(sync, w, n);
+		mutex_unlock(&sync->mutex);
+		return ret;
+	}
+
+	for (i = 0; i < n; ++i)
+		if (sync_slot(sync, w[i].cmd) == sync->nwrites)
+			slots++;
+	if (sync->nwrites + slots > VVSENSOR_SYNC_WRITES) {
+		spin_unlock_irqrestore(&sync->lock, flags);
+		return -EBUSY;
+	}
+
+	if (!sync->open || sync->batch != sync->sequence) {
+		for (i = 0; i < VVSENSOR_SYNC_NUM; ++i)
+			delay = max(delay, sync->delay[i]);
+		target = sync->sequence + 1 + delay;
+		for (j = 0; sync->open && j < sync->nwrites; ++j) {
+			idx = sync_index(sync->writes[j].cmd);
+			if (sync_in_batch(sync, &sync->writes[j]))
+				sync->writes[j].frame = target - sync->delay[idx];
+		}
+		sync->batch = sync->sequence;
+		sync->target = target;
+		sync->open = true;
+	}
+	/* one slot per control and batch, a newer value replaces a queued one */
+	for (i = 0; i < n; ++i) {
+		w[i].frame = sync->target - sync->delay[sync_index(w[i].cmd)];
+		j = sync_slot(sync, w[i].cmd);
+		sync->writes[j] = w[i];
+		if (j == sync->nwrites)
+			sync->nwrites++;
+	}
+	spin_unlock_irqrestore(&sync->lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_set_group);
+
+int vvsensor_sync_set(struct vvsensor_sync *sync, u32 cmd, u32 value)
+{
+	struct vvsensor_sync_write w = { .cmd = cmd, .value = value };
+
+	return vvsensor_sync_set_group(sync, &w, 1);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_set);
+
+int vvsensor_sync_set_ae(struct vvsensor_sync *sync,
+		const struct vvcam_ae_group_s *ae)
+{
+	struct vvsensor_sync_write w[VVSENSOR_SYNC_NUM];
+	u32 n = 0;
+
+#define AE_GROUP_ADD(bit, ioc, val) \
+	do { \
+		if (ae->mask & (bit)) { \
+			w[n].cmd = (ioc); \
+			w[n++].value = (val); \
+		} \
+	} while (0)
+
+	AE_GROUP_ADD(VVCAM_AE_GROUP_EXP, VVSENSORIOC_S_EXP, ae->exp);
+	AE_GROUP_ADD(VVCAM_AE_GROUP_GAIN, VVSENSORIOC_S_GAIN, ae->gain);
+	AE_GROUP_ADD(VVCAM_AE_GROUP_VSEXP, VVSENSORIOC_S_VSEXP, ae->vsexp);
+	AE_GROUP_ADD(VVCAM_AE_GROUP_VSGAIN, VVSENSORIOC_S_VSGAIN, ae->vsgain);
+	AE_GROUP_ADD(VVCAM_AE_GROUP_FPS, VVSENSORIOC_S_FPS, ae->fps);
+#undef AE_GROUP_ADD
+
+	if (!n)
+		return 0;
+	return vvsensor_sync_set_group(sync, w, n);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_set_ae);
+
+int vvsensor_sync_get(struct vvsensor_sync *sync, void __user *arg)
+{
+	struct vvcam_ae_sync_s ae;
+	unsigned long flags;
+
+	if (copy_from_user(&ae, arg, sizeof(ae)))
+		return -EFAULT;
+
+	spin_lock_irqsave(&sync->lock, flags);
+	if (!sync->started || !sync->synced) {
+		spin_unlock_irqrestore(&sync->lock, flags);
+		return -ENODATA;
+	}
+	ae.long_exp = sync_lookup(sync, VVSENSOR_SYNC_LONG_EXP, ae.sequence);
+	ae.exp = sync_lookup(sync, VVSENSOR_SYNC_EXP, ae.sequence);
+	ae.vsexp = sync_lookup(sync, VVSENSOR_SYNC_VSEXP, ae.sequence);
+	ae.long_gain = sync_lookup(sync, VVSENSOR_SYNC_LONG_GAIN, ae.sequence);
+	ae.gain = sync_lookup(sync, VVSENSOR_SYNC_GAIN, ae.sequence);
+	ae.vsgain = sync_lookup(sync, VVSENSOR_SYNC_VSGAIN, ae.sequence);
+	spin_unlock_irqrestore(&sync->lock, flags);
+
+	if (copy_to_user(arg, &ae, sizeof(ae)))
+		return -EFAULT;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_get);
+
+void vvsensor_sync_frame(u32 isp_id, u32 sequence)
+{
+	struct vvsensor_sync *sync;
+	bool due;
+	u32 i;
+
+	spin_lock(&sync_list_lock);
+	list_for_each_entry(sync, &sync_list, list) {
+		if (sync->isp_id != isp_id)
+			continue;
+		spin_lock(&sync->lock);
+		sync->sequence = sequence;
+		sync->synced = true;
+		due = false;
+		for (i = 0; i < sync->nwrites; ++i)
+			due |= (s32)(sync->writes[i].frame - sequence) <= 0;
+		spin_unlock(&sync->lock);
+		if (due)
+			queue_work(system_highpri_wq, &sync->work);
+	}
+	spin_unlock(&sync_list_lock);
+}
+EXPORT_SYMBOL_GPL(vvsensor_sync_frame);
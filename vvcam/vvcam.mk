@@ -34,4 +34,5 @@ vvcam: $(VVCAM_KERNELENVSH) $(VVCAM_SRC_PATH)
 	cp $(VVCAM_SRC_PATH)/sensor/os08a20/os08a20.ko $(VVCAM_OUT);
 	cp $(VVCAM_SRC_PATH)/video/vvcam-video.ko $(VVCAM_OUT);
 	cp $(VVCAM_SRC_PATH)/vvcam-isp.ko $(VVCAM_OUT);
+	cp $(VVCAM_SRC_PATH)/vvcam-sensor.ko $(VVCAM_OUT);
 	cp $(VVCAM_SRC_PATH)/vvcam-dwe.ko $(VVCAM_OUT);